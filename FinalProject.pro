@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -24,6 +24,11 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 CONFIG += c++11
 
+# Eigen multithreaded products
+msvc: QMAKE_CXXFLAGS += -openmp
+gcc: QMAKE_CXXFLAGS += -fopenmp
+gcc: QMAKE_LFLAGS += -fopenmp
+
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
@@ -69,7 +74,27 @@ SOURCES += \
     openglwidget.cpp \
     residue.cpp \
     residueswindow.cpp \
-    trajectory.cpp
+    trajectory.cpp \
+    clustering.cpp \
+    neighbourgrid.cpp \
+    contactmap.cpp \
+    hbonds.cpp \
+    secondarystructure.cpp \
+    surfacearea.cpp \
+    observable.cpp \
+    timeserieswidget.cpp \
+    pca.cpp \
+    crosscorrelation.cpp \
+    heatmapwidget.cpp \
+    ligand.cpp \
+    normalmodes.cpp \
+    radialdistribution.cpp \
+    dihedrals.cpp \
+    electrostatics.cpp \
+    frameindex.cpp \
+    analysisgraph.cpp \
+    bonds.cpp \
+    densitymap.cpp
 
 HEADERS += \
         mainwindow.h \
@@ -116,7 +141,27 @@ HEADERS += \
     residue.h \
     residueswindow.h \
     trajectory.h \
-    utility.h
+    utility.h \
+    clustering.h \
+    neighbourgrid.h \
+    contactmap.h \
+    hbonds.h \
+    secondarystructure.h \
+    surfacearea.h \
+    observable.h \
+    timeserieswidget.h \
+    pca.h \
+    crosscorrelation.h \
+    heatmapwidget.h \
+    ligand.h \
+    normalmodes.h \
+    radialdistribution.h \
+    dihedrals.h \
+    electrostatics.h \
+    frameindex.h \
+    analysisgraph.h \
+    bonds.h \
+    densitymap.h
 
 FORMS += \
         mainwindow.ui \
@@ -254,4 +299,7 @@ DISTFILES += \
     shaders/SSAO_blur_vert.glsl \
     shaders/SSAO_occlusion_frag.glsl \
     shaders/SSAO_occlusion_geom.glsl \
-    shaders/SSAO_occlusion_vert.glsl
+    shaders/SSAO_occlusion_vert.glsl \
+    shaders/hbond_frag.glsl \
+    shaders/hbond_geom.glsl \
+    shaders/hbond_vert.glsl
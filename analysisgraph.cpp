@@ -0,0 +1,145 @@
+#include "analysisgraph.h"
+
+AnalysisGraph::AnalysisGraph()
+{
+
+}
+
+void AnalysisGraph::AddNode(QString name, QStringList upstream, std::function<void()> compute)
+{
+    Node &node = nodes[name];
+    node.upstream = upstream;
+    node.compute = compute;
+    node.valid = false;
+
+    for (auto parent : upstream)
+    {
+        if (!nodes.contains(parent))
+        {
+            qDebug() << "unknown upstream node" << parent << "of" << name;
+            continue;
+        }
+
+        if (!nodes[parent].downstream.contains(name))
+        {
+            nodes[parent].downstream += name;
+        }
+    }
+}
+
+bool AnalysisGraph::SetParameters(QString name, QString key, std::function<void()> compute)
+{
+    if (!nodes.contains(name))
+    {
+        qDebug() << "unknown node" << name;
+        return false;
+    }
+
+    Node &node = nodes[name];
+
+    // same parameters : the memoized product stands
+    if (node.compute && node.key == key)
+    {
+        return false;
+    }
+
+    node.key = key;
+    node.compute = compute;
+    Invalidate(name);
+
+    return true;
+}
+
+void AnalysisGraph::Invalidate(QString name)
+{
+    if (!nodes.contains(name))
+    {
+        return;
+    }
+
+    // depth-first over the downstream nodes, each one visited once
+    QStringList stack;
+    stack += name;
+
+    QSet<QString> visited;
+
+    while (!stack.isEmpty())
+    {
+        QString current = stack.takeLast();
+
+        if (visited.contains(current))
+        {
+            continue;
+        }
+        visited += current;
+
+        Node &node = nodes[current];
+        node.valid = false;
+        stack += node.downstream;
+    }
+}
+
+void AnalysisGraph::Validate(QString name)
+{
+    if (nodes.contains(name))
+    {
+        nodes[name].valid = true;
+    }
+}
+
+bool AnalysisGraph::Require(QString name)
+{
+    if (!nodes.contains(name))
+    {
+        return false;
+    }
+
+    if (nodes[name].valid)
+    {
+        return true;
+    }
+
+    for (auto parent : nodes[name].upstream)
+    {
+        if (!Require(parent))
+        {
+            return false;
+        }
+    }
+
+    // the upstream computations may have touched the map
+    Node &node = nodes[name];
+
+    if (!node.compute)
+    {
+        // sources are always up to date, the other nodes wait for their parameters
+        node.valid = node.upstream.isEmpty();
+        return node.valid;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    node.compute();
+    node.count += 1;
+    node.valid = true;
+
+    qDebug() << name << node.key << timer.elapsed() << "ms";
+
+    return true;
+}
+
+bool AnalysisGraph::isValid(QString name) const
+{
+    return nodes.value(name).valid;
+}
+
+QString AnalysisGraph::GetKey(QString name) const
+{
+    return nodes.value(name).key;
+}
+
+int AnalysisGraph::GetCount(QString name) const
+{
+    return nodes.value(name).count;
+}
@@ -0,0 +1,60 @@
+#ifndef ANALYSISGRAPH_H
+#define ANALYSISGRAPH_H
+
+#include <functional>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// dependency graph of the analysis products (statistics, contact map, SASA, ...)
+// a node is computed lazily on first use and memoized under the key of its parameters,
+// a change (new key, new models) invalidates the node and its downstream nodes only
+// (GUI thread only)
+class AnalysisGraph
+{
+public:
+    AnalysisGraph();
+
+    // upstream : nodes the product is derived from
+    // compute : fills the product, called with the upstream nodes up to date
+    // (a node without compute is a source, or waits for its parameters)
+    void AddNode(QString name, QStringList upstream, std::function<void()> compute = nullptr);
+
+    // parameters of a node as a key (e.g. "backbone;4.5"),
+    // compute bound to these parameters replaces the previous one when the key changes
+    // returns whether the node was invalidated
+    bool SetParameters(QString name, QString key, std::function<void()> compute);
+
+    // the node and its downstream are out of date (e.g. the models changed)
+    void Invalidate(QString name);
+    // the node is up to date (e.g. loaded with the cooked data)
+    void Validate(QString name);
+
+    // brings the node up to date, its stale upstream first
+    // returns whether the node is up to date (false : parameters never set)
+    bool Require(QString name);
+
+    bool isValid(QString name) const;
+    QString GetKey(QString name) const;
+    // number of computations of the node so far
+    int GetCount(QString name) const;
+
+private:
+    struct Node
+    {
+        QStringList upstream;
+        QStringList downstream;
+        std::function<void()> compute;
+        QString key;
+        bool valid = false;
+        int count = 0;
+    };
+
+    QMap<QString, Node> nodes;
+};
+
+#endif // ANALYSISGRAPH_H
@@ -2,7 +2,7 @@
 
 Atom::Atom()
 {
-
+    charge = 0;
 }
 
 std::ostream& operator<<(std::ostream& os, const Atom& atom)
@@ -23,6 +23,9 @@ public:
 
     int residue;
 
+    // partial charge (in e), see Trajectory::SetCharges
+    float charge;
+
     // QVector<Eigen::Vector3f> RMSDs;
     QVector<QVector3D> RMSDs;
     float MinRMSD;
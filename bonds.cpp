@@ -0,0 +1,482 @@
+#include "bonds.h"
+
+CovalentBonds::CovalentBonds(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+    tolerance = 0.45f;
+    MinDistance = 0.4f;
+
+    MissingBonds = 0;
+    ExtraBonds = 0;
+    HydrogenMismatches = 0;
+}
+
+float CovalentBonds::GetCovalentRadius(QString element)
+{
+    if (ChemicalElements.contains(element))
+    {
+        return ChemicalElements[element].covalent;
+    }
+
+    // upper case symbols (e.g. "CL")
+    QString symbol = element.left(1).toUpper() + element.mid(1).toLower();
+    if (ChemicalElements.contains(symbol))
+    {
+        return ChemicalElements[symbol].covalent;
+    }
+
+    return ChemicalElements["C"].covalent;
+}
+
+QVector<int> CovalentBonds::GetPairs(const QVector<QVector3D> &positions, const QVector<float> &radii, float tolerance, float MinDistance)
+{
+    int size = positions.size();
+
+    QVector<int> pairs;
+
+    float MaxRadius = 0;
+    for (auto radius : radii)
+    {
+        MaxRadius = qMax(MaxRadius, radius);
+    }
+
+    if (size < 2 || MaxRadius <= 0)
+    {
+        return pairs;
+    }
+
+    // the longest possible bond bounds the candidates
+    float cutoff = 2 * MaxRadius + tolerance;
+
+    NeighbourGrid grid;
+    grid.Build(positions, cutoff);
+
+    float MinSquared = MinDistance * MinDistance;
+
+    QVector<QPair<int, int>> bonds;
+    for (auto pair : grid.PairsQuery(cutoff))
+    {
+        int i = qMin(pair.first, pair.second);
+        int j = qMax(pair.first, pair.second);
+
+        if (radii[i] <= 0 || radii[j] <= 0)
+        {
+            continue;
+        }
+
+        float length = radii[i] + radii[j] + tolerance;
+        float squared = (positions[i] - positions[j]).lengthSquared();
+
+        if (squared >= MinSquared && squared <= length * length)
+        {
+            bonds += qMakePair(i, j);
+        }
+    }
+
+    // counting sort on the first index, then the few bonds of each atom sorted in place (linear overall)
+    QVector<int> starts(size + 1, 0);
+    for (auto bond : bonds)
+    {
+        starts[bond.first + 1] += 1;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        starts[i + 1] += starts[i];
+    }
+
+    QVector<int> seconds(bonds.size());
+    {
+        QVector<int> offsets = starts;
+        for (auto bond : bonds)
+        {
+            seconds[offsets[bond.first]++] = bond.second;
+        }
+    }
+
+    pairs.reserve(2 * bonds.size());
+    for (int i = 0; i < size; i++)
+    {
+        std::sort(seconds.begin() + starts[i], seconds.begin() + starts[i + 1]);
+
+        for (int k = starts[i]; k < starts[i + 1]; k++)
+        {
+            pairs += i;
+            pairs += seconds[k];
+        }
+    }
+
+    return pairs;
+}
+
+void CovalentBonds::Compute(int step)
+{
+    pairs.clear();
+    AtomNumbers.clear();
+    VertexIndices.clear();
+
+    if (trajectory->models.isEmpty())
+    {
+        SetAdjacency();
+        return;
+    }
+
+    const Trajectory::Model &model = trajectory->models.at(qBound(0, step, trajectory->models.size() - 1));
+
+    // ions are not bonded
+    QSet<int> ions;
+    for (const auto &residue : trajectory->residues)
+    {
+        if (residue.atoms.size() == 1)
+        {
+            ions += residue.atoms.first();
+        }
+    }
+
+    // vertex order : the models VAOs order
+    AtomNumbers = model.keys().toVector();
+
+    QVector<QVector3D> positions;
+    QVector<float> radii;
+
+    for (int i = 0; i < AtomNumbers.size(); i++)
+    {
+        int number = AtomNumbers[i];
+        VertexIndices[number] = i;
+
+        positions += model.value(number);
+        radii += ions.contains(number) ? 0 : GetCovalentRadius(trajectory->atoms.value(number).element);
+    }
+
+    pairs = GetPairs(positions, radii, tolerance, MinDistance);
+    SetAdjacency();
+
+    Validate();
+}
+
+void CovalentBonds::SetAdjacency()
+{
+    int size = AtomNumbers.size();
+
+    starts.fill(0, size + 1);
+    for (auto index : pairs)
+    {
+        starts[index + 1] += 1;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        starts[i + 1] += starts[i];
+    }
+
+    neighbours.resize(pairs.size());
+
+    QVector<int> offsets = starts;
+    for (int k = 0; k < pairs.size(); k += 2)
+    {
+        int i = pairs[k];
+        int j = pairs[k + 1];
+        neighbours[offsets[i]++] = j;
+        neighbours[offsets[j]++] = i;
+    }
+}
+
+bool CovalentBonds::isEmpty() const
+{
+    return pairs.isEmpty();
+}
+
+int CovalentBonds::size() const
+{
+    return pairs.size() / 2;
+}
+
+bool CovalentBonds::isBonded(int i, int j) const
+{
+    for (int k = starts[i]; k < starts[i + 1]; k++)
+    {
+        if (neighbours[k] == j)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+QVector<int> CovalentBonds::GetBondedAtoms(int AtomNumber) const
+{
+    QVector<int> bonded;
+
+    int i = VertexIndices.value(AtomNumber, -1);
+    if (i < 0)
+    {
+        return bonded;
+    }
+
+    for (int k = starts[i]; k < starts[i + 1]; k++)
+    {
+        bonded += AtomNumbers[neighbours[k]];
+    }
+
+    return bonded;
+}
+
+QVector<int> CovalentBonds::GetFragment(int AtomNumber) const
+{
+    QVector<int> fragment;
+
+    int first = VertexIndices.value(AtomNumber, -1);
+    if (first < 0)
+    {
+        return fragment;
+    }
+
+    // breadth-first over the bonds
+    QVector<bool> visited(AtomNumbers.size(), false);
+    QVector<int> queue;
+    queue += first;
+    visited[first] = true;
+
+    for (int q = 0; q < queue.size(); q++)
+    {
+        int i = queue[q];
+        fragment += AtomNumbers[i];
+
+        for (int k = starts[i]; k < starts[i + 1]; k++)
+        {
+            int j = neighbours[k];
+            if (!visited[j])
+            {
+                visited[j] = true;
+                queue += j;
+            }
+        }
+    }
+
+    std::sort(fragment.begin(), fragment.end());
+    return fragment;
+}
+
+QVector<unsigned int> CovalentBonds::GetLineIndices() const
+{
+    QVector<unsigned int> indices;
+    indices.reserve(pairs.size());
+
+    for (auto index : pairs)
+    {
+        indices += static_cast<unsigned int>(index);
+    }
+
+    return indices;
+}
+
+void CovalentBonds::Validate()
+{
+    MissingBonds = 0;
+    ExtraBonds = 0;
+    HydrogenMismatches = 0;
+
+    // map : residue name -> heavy atoms bonds of the side chain (backbone bonds are shared)
+    QMap<QString, QString> templates;
+    templates["ALA"] = "CA-CB";
+    templates["ARG"] = "CA-CB CB-CG CG-CD CD-NE NE-CZ CZ-NH1 CZ-NH2";
+    templates["ASN"] = "CA-CB CB-CG CG-OD1 CG-ND2";
+    templates["ASP"] = "CA-CB CB-CG CG-OD1 CG-OD2";
+    templates["CYS"] = "CA-CB CB-SG";
+    templates["CYX"] = "CA-CB CB-SG";
+    templates["GLN"] = "CA-CB CB-CG CG-CD CD-OE1 CD-NE2";
+    templates["GLU"] = "CA-CB CB-CG CG-CD CD-OE1 CD-OE2";
+    templates["GLY"] = "";
+    templates["HIS"] = "CA-CB CB-CG CG-ND1 CG-CD2 ND1-CE1 CD2-NE2 CE1-NE2";
+    templates["HID"] = templates["HIS"];
+    templates["HIE"] = templates["HIS"];
+    templates["HIP"] = templates["HIS"];
+    templates["ILE"] = "CA-CB CB-CG1 CB-CG2 CG1-CD1";
+    templates["LEU"] = "CA-CB CB-CG CG-CD1 CG-CD2";
+    templates["LYS"] = "CA-CB CB-CG CG-CD CD-CE CE-NZ";
+    templates["MET"] = "CA-CB CB-CG CG-SD SD-CE";
+    templates["PHE"] = "CA-CB CB-CG CG-CD1 CG-CD2 CD1-CE1 CD2-CE2 CE1-CZ CE2-CZ";
+    templates["PRO"] = "CA-CB CB-CG CG-CD CD-N";
+    templates["SER"] = "CA-CB CB-OG";
+    templates["THR"] = "CA-CB CB-OG1 CB-CG2";
+    templates["TRP"] = "CA-CB CB-CG CG-CD1 CG-CD2 CD1-NE1 NE1-CE2 CD2-CE2 CD2-CE3 CE2-CZ2 CE3-CZ3 CZ2-CH2 CZ3-CH2";
+    templates["TYR"] = "CA-CB CB-CG CG-CD1 CG-CD2 CD1-CE1 CD2-CE2 CE1-CZ CE2-CZ CZ-OH";
+    templates["VAL"] = "CA-CB CB-CG1 CB-CG2";
+
+    QString backbone = "N-CA CA-C C-O C-OXT";
+
+    // expected bonds, as sorted vertex pairs
+    QSet<QPair<int, int>> expected;
+    // heavy atoms and hydrogens of the template residues
+    QSet<int> heavy;
+    QVector<int> hydrogens;
+
+    QStringList issues;
+
+    auto Expect = [&] (int i, int j)
+    {
+        expected += qMakePair(qMin(i, j), qMax(i, j));
+    };
+
+    QMap<QString, int> PreviousNames;
+    QString PreviousChain;
+
+    for (const auto &residue : trajectory->residues)
+    {
+        // map : atom name -> vertex index
+        QMap<QString, int> names;
+        for (auto number : residue.atoms)
+        {
+            int index = VertexIndices.value(number, -1);
+            if (index >= 0)
+            {
+                names[trajectory->atoms.value(number).name] = index;
+            }
+        }
+
+        if (!templates.contains(residue.name))
+        {
+            PreviousNames.clear();
+            continue;
+        }
+
+        for (auto bond : (backbone + " " + templates[residue.name]).split(" ", QString::SkipEmptyParts))
+        {
+            auto ends = bond.split("-");
+            if (names.contains(ends[0]) && names.contains(ends[1]))
+            {
+                Expect(names[ends[0]], names[ends[1]]);
+            }
+        }
+
+        // peptide bond to the previous residue of the chain
+        if (residue.chain == PreviousChain && PreviousNames.contains("C") && names.contains("N"))
+        {
+            Expect(PreviousNames["C"], names["N"]);
+        }
+
+        for (auto number : residue.atoms)
+        {
+            int index = VertexIndices.value(number, -1);
+            if (index < 0)
+            {
+                continue;
+            }
+
+            if (trajectory->atoms.value(number).element == "H")
+            {
+                hydrogens += index;
+            }
+            else
+            {
+                heavy += index;
+            }
+        }
+
+        PreviousNames = names;
+        PreviousChain = residue.chain;
+    }
+
+    for (auto bond : expected)
+    {
+        if (!isBonded(bond.first, bond.second))
+        {
+            MissingBonds += 1;
+
+            if (issues.size() < 10)
+            {
+                issues += QString("missing %1-%2").arg(AtomNumbers[bond.first]).arg(AtomNumbers[bond.second]);
+            }
+        }
+    }
+
+    for (int k = 0; k < pairs.size(); k += 2)
+    {
+        int i = pairs[k];
+        int j = pairs[k + 1];
+
+        if (!heavy.contains(i) || !heavy.contains(j) || expected.contains(qMakePair(i, j)))
+        {
+            continue;
+        }
+
+        // disulfide bridges
+        if (trajectory->atoms.value(AtomNumbers[i]).name == "SG" && trajectory->atoms.value(AtomNumbers[j]).name == "SG")
+        {
+            continue;
+        }
+
+        ExtraBonds += 1;
+
+        if (issues.size() < 10)
+        {
+            issues += QString("extra %1-%2").arg(AtomNumbers[i]).arg(AtomNumbers[j]);
+        }
+    }
+
+    for (auto i : hydrogens)
+    {
+        HydrogenMismatches += (starts[i + 1] - starts[i] != 1) ? 1 : 0;
+    }
+
+    qDebug() << "covalent bonds" << size() << "template bonds" << expected.size()
+             << "missing" << MissingBonds << "extra" << ExtraBonds << "hydrogens mismatches" << HydrogenMismatches;
+
+    for (auto issue : issues)
+    {
+        qDebug() << "  " << issue;
+    }
+}
+
+void CovalentBonds::Benchmark(int MaxAtoms)
+{
+    // jittered simple cubic lattices of carbons 1.5 A apart : 6 bonds per inner atom,
+    // the face diagonals (2.12 A, no less than 1.98 A with the jitter) fall outside the 1.97 A bond length
+    QRandomGenerator generator(42);
+
+    float spacing = 1.5f;
+    float radius = GetCovalentRadius("C");
+
+    qDebug() << "CovalentBonds::Benchmark";
+
+    for (int edge : {20, 32, 50, 80, 126, 160, 200})
+    {
+        int size = edge * edge * edge;
+        if (size > MaxAtoms)
+        {
+            break;
+        }
+
+        QVector<QVector3D> positions;
+        positions.reserve(size);
+
+        for (int x = 0; x < edge; x++)
+        {
+            for (int y = 0; y < edge; y++)
+            {
+                for (int z = 0; z < edge; z++)
+                {
+                    QVector3D jitter(static_cast<float>(generator.bounded(0.1) - 0.05),
+                                     static_cast<float>(generator.bounded(0.1) - 0.05),
+                                     static_cast<float>(generator.bounded(0.1) - 0.05));
+                    positions += QVector3D(x, y, z) * spacing + jitter;
+                }
+            }
+        }
+
+        QVector<float> radii(size, radius);
+
+        QElapsedTimer timer;
+        timer.start();
+
+        auto pairs = GetPairs(positions, radii, 0.45f, 0.4f);
+
+        qint64 time = timer.nsecsElapsed();
+
+        // 3 bonds per atom less the lattice faces
+        qint64 expected = 3 * static_cast<qint64>(edge) * edge * (edge - 1);
+
+        qDebug() << "  " << size << "atoms" << pairs.size() / 2 << "bonds"
+                 << ((pairs.size() / 2 == expected) ? "match" : "MISMATCH")
+                 << QString("%1 ms").arg(time * 1e-6, 0, 'f', 3)
+                 << QString("%1 ns/atom").arg(static_cast<double>(time) / size, 0, 'f', 1);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef BONDS_H
+#define BONDS_H
+
+#include <QSet>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+
+#include "trajectory.h"
+#include "neighbourgrid.h"
+#include "utility.h"
+using namespace utility;
+
+// covalent bonds perceived on a model : two atoms are bonded when closer than the sum of their covalent radii
+// plus a tolerance, the candidate pairs come from a uniform grid in O(N)
+// the bonds are topology, perceived once and shared by all the frames
+class CovalentBonds
+{
+public:
+    CovalentBonds(Trajectory *trajectory);
+
+    // added to the covalent radii sum (in Angstrom)
+    float tolerance;
+    // closer atoms are overlapping duplicates, not bonds (in Angstrom)
+    float MinDistance;
+
+    // bonds as vertex indices (atoms order of the models VAOs), 2 per bond, first < second,
+    // sorted by first then second vertex
+    QVector<int> pairs;
+
+    // bonds perceived on the model of step, then checked against the residue templates
+    // (monoatomic residues, i.e. ions, are left unbonded)
+    void Compute(int step = 0);
+
+    bool isEmpty() const;
+    // bonds count
+    int size() const;
+
+    // atoms bonded to an atom
+    QVector<int> GetBondedAtoms(int AtomNumber) const;
+    // atoms connected to an atom through any number of bonds (itself included)
+    QVector<int> GetFragment(int AtomNumber) const;
+
+    // vertex indices of the bonds endpoints, the same for every step
+    QVector<unsigned int> GetLineIndices() const;
+
+    // residue templates check, standard amino acids heavy atoms and peptide bonds
+    // missing : template bonds not perceived, extra : perceived bonds between template atoms outside the templates,
+    // hydrogens : hydrogens of the template residues without exactly one bond
+    int MissingBonds;
+    int ExtraBonds;
+    int HydrogenMismatches;
+    void Validate();
+
+    // candidate pairs from the grid, filtered on the radii (radius 0 : never bonded)
+    // returns the bonds as sorted pairs of positions indices
+    static QVector<int> GetPairs(const QVector<QVector3D> &positions, const QVector<float> &radii, float tolerance, float MinDistance);
+
+    // covalent radius of an element symbol (carbon when unknown)
+    static float GetCovalentRadius(QString element);
+
+    // perception timings on jittered lattices up to MaxAtoms atoms, printed on debug output
+    static void Benchmark(int MaxAtoms);
+
+private:
+    Trajectory *trajectory;
+
+    // atom number of each vertex, and back
+    QVector<int> AtomNumbers;
+    QMap<int, int> VertexIndices;
+
+    // adjacency : vertex i is bonded to neighbours[starts[i]] ... neighbours[starts[i+1]-1]
+    QVector<int> starts;
+    QVector<int> neighbours;
+    void SetAdjacency();
+
+    bool isBonded(int i, int j) const;
+};
+
+#endif // BONDS_H
@@ -0,0 +1,306 @@
+#include "clustering.h"
+
+Clustering::Clustering(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+    cache.setMaxCost(MaxCacheSize);
+}
+
+void Clustering::SetSelection(QVector<int> selection)
+{
+    conformations = trajectory->GetConformations(selection);
+    clusters.clear();
+
+    QMutexLocker locker(&mutex);
+    cache.clear();
+}
+
+float Clustering::GetDistance(int i, int j)
+{
+    if (i == j)
+    {
+        return 0;
+    }
+
+    // the distance is symmetric
+    if (i > j)
+    {
+        std::swap(i, j);
+    }
+
+    quint64 key = static_cast<quint64>(i) * static_cast<quint64>(conformations.size()) + static_cast<quint64>(j);
+
+    {
+        QMutexLocker locker(&mutex);
+        if (float *distance = cache.object(key))
+        {
+            return *distance;
+        }
+    }
+
+    // the superposition runs outside the lock
+    float distance = ComputeDistance(i, j);
+
+    {
+        QMutexLocker locker(&mutex);
+        cache.insert(key, new float(distance));
+    }
+
+    return distance;
+}
+
+float Clustering::ComputeDistance(int i, int j)
+{
+    return trajectory->GetSuperpositionRMSD(conformations.at(i), conformations.at(j));
+}
+
+void Clustering::GROMOS(float cutoff)
+{
+    int size = conformations.size();
+
+    // neighbours : frames within cutoff
+    QVector<QVector<int>> neighbours(size);
+    auto data = neighbours.data();
+
+    // each row only computes the upper triangle, every pair once : the distances bypass the cache
+    auto lambda = [=] (int i)
+    {
+        for (int j = i + 1; j < size; j++)
+        {
+            if (ComputeDistance(i, j) <= cutoff)
+            {
+                data[i] += j;
+            }
+        }
+    };
+
+    auto indices = GetIndices(size);
+    QtConcurrent::blockingMap(indices, lambda);
+
+    // symmetrize
+    for (int i = 0; i < size; i++)
+    {
+        for (auto j : neighbours[i])
+        {
+            if (j > i)
+            {
+                neighbours[j] += i;
+            }
+        }
+    }
+
+    QVector<bool> assigned(size, false);
+
+    QVector<QVector<int>> groups;
+    QVector<int> representatives;
+
+    int remaining = size;
+
+    while (remaining > 0)
+    {
+        // the central frame has the largest number of unassigned neighbours
+        int center = -1;
+        int MaxCount = -1;
+
+        for (int i = 0; i < size; i++)
+        {
+            if (assigned[i])
+            {
+                continue;
+            }
+
+            int count = static_cast<int>(std::count_if(neighbours[i].begin(), neighbours[i].end(), [&] (int j) { return !assigned[j]; }));
+
+            if (count > MaxCount)
+            {
+                center = i;
+                MaxCount = count;
+            }
+        }
+
+        QVector<int> group;
+        group += center;
+
+        for (auto j : neighbours[center])
+        {
+            if (!assigned[j])
+            {
+                group += j;
+            }
+        }
+
+        for (auto i : group)
+        {
+            assigned[i] = true;
+        }
+        remaining -= group.size();
+
+        groups += group;
+        representatives += center;
+    }
+
+    SetClusters(groups, representatives);
+}
+
+void Clustering::KMedoids(int k, int iterations)
+{
+    int size = conformations.size();
+    k = qBound(1, k, size);
+
+    auto indices = GetIndices(size);
+
+    // initial medoids : farthest-first traversal starting from the first frame
+    QVector<int> medoids;
+    medoids += 0;
+
+    QVector<float> MinDistances(size, FLT_MAX);
+
+    while (medoids.size() < k)
+    {
+        auto data = MinDistances.data();
+        int last = medoids.last();
+
+        auto lambda = [=] (int i)
+        {
+            data[i] = qMin(data[i], GetDistance(i, last));
+        };
+        QtConcurrent::blockingMap(indices, lambda);
+
+        medoids += static_cast<int>(std::max_element(MinDistances.begin(), MinDistances.end()) - MinDistances.begin());
+    }
+
+    QVector<int> labels(size, 0);
+
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        // assignment step : each frame goes to its nearest medoid
+        {
+            auto data = labels.data();
+
+            auto lambda = [=] (int i)
+            {
+                int label = 0;
+                float MinDistance = FLT_MAX;
+
+                for (int c = 0; c < medoids.size(); c++)
+                {
+                    float distance = GetDistance(i, medoids[c]);
+
+                    if (distance < MinDistance)
+                    {
+                        label = c;
+                        MinDistance = distance;
+                    }
+                }
+
+                data[i] = label;
+            };
+            QtConcurrent::blockingMap(indices, lambda);
+        }
+
+        QVector<QVector<int>> groups(k);
+        for (int i = 0; i < size; i++)
+        {
+            groups[labels[i]] += i;
+        }
+
+        // update step : the medoid minimizes the sum of distances within its cluster
+        QVector<int> updated(k);
+        {
+            auto data = updated.data();
+
+            auto lambda = [=] (int c)
+            {
+                auto group = groups[c];
+
+                int medoid = medoids[c];
+                float MinCost = FLT_MAX;
+
+                for (auto i : group)
+                {
+                    float cost = 0;
+                    for (auto j : group)
+                    {
+                        cost += GetDistance(i, j);
+                    }
+
+                    if (cost < MinCost)
+                    {
+                        medoid = i;
+                        MinCost = cost;
+                    }
+                }
+
+                data[c] = medoid;
+            };
+
+            auto numbers = GetIndices(k);
+            QtConcurrent::blockingMap(numbers, lambda);
+        }
+
+        bool converged = (updated == medoids);
+        medoids = updated;
+
+        if (converged)
+        {
+            SetClusters(groups, medoids);
+            return;
+        }
+    }
+
+    QVector<QVector<int>> groups(k);
+    for (int i = 0; i < size; i++)
+    {
+        groups[labels[i]] += i;
+    }
+
+    SetClusters(groups, medoids);
+}
+
+void Clustering::SetClusters(QVector<QVector<int>> groups, QVector<int> representatives)
+{
+    clusters.clear();
+
+    for (int i = 0; i < groups.size(); i++)
+    {
+        if (groups[i].isEmpty())
+        {
+            continue;
+        }
+
+        Cluster cluster;
+        cluster.representative = representatives[i];
+        cluster.frames = groups[i];
+        std::sort(cluster.frames.begin(), cluster.frames.end());
+
+        clusters += cluster;
+    }
+
+    auto lambda = [] (Cluster a, Cluster b) { return a.frames.size() > b.frames.size(); };
+    std::stable_sort(clusters.begin(), clusters.end(), lambda);
+
+    for (int i = 0; i < clusters.size(); i++)
+    {
+        clusters[i].number = i + 1;
+    }
+}
+
+QVector<int> Clustering::GetPlaybackOrder()
+{
+    QVector<int> order;
+    for (auto cluster : clusters)
+    {
+        order += cluster.frames;
+    }
+    return order;
+}
+
+QVector<int> Clustering::GetRepresentatives()
+{
+    QVector<int> representatives;
+    for (auto cluster : clusters)
+    {
+        representatives += cluster.representative;
+    }
+    return representatives;
+}
@@ -0,0 +1,65 @@
+#ifndef CLUSTERING_H
+#define CLUSTERING_H
+
+#include <QCache>
+#include <QMutex>
+#include <QtConcurrent>
+
+#include <Eigen/Dense>
+
+#include "trajectory.h"
+#include "utility.h"
+using namespace utility;
+
+enum ClusteringMethod { GROMOS, K_MEDOIDS };
+
+struct Cluster
+{
+    int number;
+    int representative; // central (medoid) frame
+    QVector<int> frames;
+};
+
+class Clustering
+{
+public:
+    Clustering(Trajectory *trajectory);
+
+    // conformational states of the trajectory frames,
+    // sorted by decreasing size
+    QVector<Cluster> clusters;
+
+    // superposition RMSD between the selection atoms is the distance between frames
+    void SetSelection(QVector<int> selection);
+
+    // GROMOS : cutoff (in Angstrom) clustering
+    void GROMOS(float cutoff);
+    // k-medoids : alternating assignment and medoid update
+    void KMedoids(int k, int iterations = 100);
+
+    // distance between frames i and j, cached (k-medoids reuses the distances to the medoids)
+    float GetDistance(int i, int j);
+
+    // frames grouped cluster by cluster
+    QVector<int> GetPlaybackOrder();
+    // representatives in clusters order
+    QVector<int> GetRepresentatives();
+
+private:
+    Trajectory *trajectory;
+
+    QVector<QVector<Eigen::Vector3f>> conformations;
+
+    // distances are computed lazily and kept in a bounded cache
+    // map : (i, j) -> distance
+    QCache<quint64, float> cache;
+    QMutex mutex;
+    const int MaxCacheSize = 1 << 22;
+
+    // distance between frames i and j, not cached (each pair evaluated once, no lock)
+    float ComputeDistance(int i, int j);
+
+    void SetClusters(QVector<QVector<int>> groups, QVector<int> representatives);
+};
+
+#endif // CLUSTERING_H
@@ -0,0 +1,217 @@
+#include "contactmap.h"
+
+ContactMap::ContactMap(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+    cutoff = 0;
+    frames = 0;
+}
+
+int ContactMap::GetPairIndex(int i, int j) const
+{
+    if (i > j)
+    {
+        std::swap(i, j);
+    }
+
+    int size = ResidueNumbers.size();
+    return i * size - i * (i + 1) / 2 + (j - i - 1);
+}
+
+void ContactMap::Compute(QVector<int> selection, float cutoff)
+{
+    this->cutoff = cutoff;
+    frames = trajectory->models.size();
+
+    ResidueIndices.clear();
+    ResidueNumbers.clear();
+
+    // matrix index of the residue of each selection atom
+    QVector<int> AtomResidues;
+    for (auto AtomNumber : selection)
+    {
+        int ResidueNumber = trajectory->atoms.value(AtomNumber).residue;
+
+        if (!ResidueIndices.contains(ResidueNumber))
+        {
+            ResidueIndices[ResidueNumber] = 0;
+        }
+    }
+
+    for (auto ResidueNumber : ResidueIndices.keys())
+    {
+        ResidueIndices[ResidueNumber] = ResidueNumbers.size();
+        ResidueNumbers += ResidueNumber;
+    }
+
+    for (auto AtomNumber : selection)
+    {
+        AtomResidues += ResidueIndices.value(trajectory->atoms.value(AtomNumber).residue);
+    }
+
+    int size = ResidueNumbers.size();
+    int PairsCount = size * (size - 1) / 2;
+
+    // each worker owns a contiguous chunk of frames and its own counts
+    struct Worker
+    {
+        int begin;
+        int end;
+        QVector<int> counts;
+    };
+
+    QVector<Worker> workers;
+    for (auto chunk : GetChunks(frames))
+    {
+        Worker worker;
+        worker.begin = chunk.first;
+        worker.end = chunk.second;
+        workers += worker;
+    }
+
+    auto lambda = [&] (Worker &worker)
+    {
+        worker.counts.fill(0, PairsCount);
+
+        // residues pairs already in contact in the current frame
+        QBitArray contacts(PairsCount, false);
+        QVector<int> touched;
+
+        NeighbourGrid grid;
+        grid.parallel = false;
+
+        for (int step = worker.begin; step < worker.end; step++)
+        {
+            auto positions = trajectory->GetPositions(step, selection);
+
+            if (step == worker.begin)
+            {
+                grid.Build(positions, cutoff);
+            }
+            else
+            {
+                grid.Update(positions);
+            }
+
+            for (auto pair : grid.PairsQuery(cutoff))
+            {
+                int i = AtomResidues[pair.first];
+                int j = AtomResidues[pair.second];
+
+                if (i == j)
+                {
+                    continue;
+                }
+
+                int index = GetPairIndex(i, j);
+
+                if (!contacts.testBit(index))
+                {
+                    contacts.setBit(index);
+                    touched += index;
+                }
+            }
+
+            for (auto index : touched)
+            {
+                worker.counts[index] += 1;
+                contacts.clearBit(index);
+            }
+            touched.clear();
+        }
+    };
+
+    QtConcurrent::blockingMap(workers, lambda);
+
+    // merge counts
+    counts.fill(0, PairsCount);
+    for (auto worker : workers)
+    {
+        for (int index = 0; index < PairsCount; index++)
+        {
+            counts[index] += worker.counts[index];
+        }
+    }
+
+    ContactsNumbers.fill(0, size);
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = i + 1; j < size; j++)
+        {
+            float frequency = counts[GetPairIndex(i, j)] / static_cast<float>(frames);
+            ContactsNumbers[i] += frequency;
+            ContactsNumbers[j] += frequency;
+        }
+    }
+}
+
+bool ContactMap::isEmpty() const
+{
+    return counts.isEmpty() || frames == 0;
+}
+
+float ContactMap::GetFrequency(int a, int b) const
+{
+    if (isEmpty() || !ResidueIndices.contains(a) || !ResidueIndices.contains(b))
+    {
+        return NAN;
+    }
+
+    int i = ResidueIndices.value(a);
+    int j = ResidueIndices.value(b);
+
+    if (i == j)
+    {
+        return 1;
+    }
+
+    return counts[GetPairIndex(i, j)] / static_cast<float>(frames);
+}
+
+float ContactMap::GetContactsNumber(int ResidueNumber) const
+{
+    if (isEmpty() || !ResidueIndices.contains(ResidueNumber))
+    {
+        return NAN;
+    }
+
+    return ContactsNumbers[ResidueIndices.value(ResidueNumber)];
+}
+
+float ContactMap::GetMaxContactsNumber() const
+{
+    if (ContactsNumbers.isEmpty())
+    {
+        return 0;
+    }
+
+    return *std::max_element(ContactsNumbers.begin(), ContactsNumbers.end());
+}
+
+void ContactMap::Export(QString path) const
+{
+    QFile file(path);
+    assert(file.open(QIODevice::Text | QIODevice::WriteOnly));
+
+    QTextStream stream(&file);
+
+    stream << "CUTOFF " << cutoff << "\n";
+    stream << "FRAMES " << frames << "\n";
+
+    int size = ResidueNumbers.size();
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = i + 1; j < size; j++)
+        {
+            int count = counts[GetPairIndex(i, j)];
+
+            if (count > 0)
+            {
+                float frequency = count / static_cast<float>(frames);
+                stream << "CONTACT " << ResidueNumbers[i] << " " << ResidueNumbers[j] << " " << frequency << "\n";
+            }
+        }
+    }
+
+    file.close();
+}
@@ -0,0 +1,52 @@
+#ifndef CONTACTMAP_H
+#define CONTACTMAP_H
+
+#include <QBitArray>
+#include <QFile>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include "trajectory.h"
+#include "neighbourgrid.h"
+#include "utility.h"
+using namespace utility;
+
+// residue x residue contact frequencies : fraction of frames in which
+// any pair of selection atoms of the two residues is within cutoff
+class ContactMap
+{
+public:
+    ContactMap(Trajectory *trajectory);
+
+    float cutoff;
+    // number of frames the frequencies are computed on
+    int frames;
+
+    void Compute(QVector<int> selection, float cutoff);
+
+    bool isEmpty() const;
+
+    // frequency of contact between two residues (residues numbers)
+    float GetFrequency(int a, int b) const;
+    // sum of the frequencies with all the other residues (mean number of contacts)
+    float GetContactsNumber(int ResidueNumber) const;
+    float GetMaxContactsNumber() const;
+
+    // non-zero frequencies, one "CONTACT a b frequency" line per residues pair
+    void Export(QString path) const;
+
+private:
+    Trajectory *trajectory;
+
+    // map : residue number -> matrix index
+    QMap<int, int> ResidueIndices;
+    QVector<int> ResidueNumbers;
+
+    // contact counts, strictly upper triangle stored row by row
+    QVector<int> counts;
+    QVector<float> ContactsNumbers;
+
+    int GetPairIndex(int i, int j) const;
+};
+
+#endif // CONTACTMAP_H
@@ -0,0 +1,243 @@
+#include "crosscorrelation.h"
+
+CrossCorrelation::CrossCorrelation(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+}
+
+void CrossCorrelation::Compute(QVector<int> selection, bool AtomLevel)
+{
+    atoms.clear();
+    ResidueNumbers.clear();
+    ResidueIndices.clear();
+    ResiduesMatrix.resize(0, 0);
+    AtomsMatrix.resize(0, 0);
+
+    int frames = trajectory->models.size();
+
+    QSet<int> set;
+    for (auto number : selection)
+    {
+        set.insert(number);
+    }
+
+    // atoms grouped by residue, residue starts in atoms
+    QVector<int> ResidueStarts;
+
+    for (auto residue : trajectory->residues)
+    {
+        int start = atoms.size();
+
+        for (auto number : residue.atoms)
+        {
+            // the RMSDs history is not stored in online statistics mode,
+            // it is derived from the residues superpositions in compact RMSDs mode
+            bool history = (trajectory->atoms[number].RMSDs.size() == frames) || (residue.alignments.size() == 12 * frames);
+
+            if (set.contains(number) && history)
+            {
+                atoms += number;
+            }
+        }
+
+        if (atoms.size() > start)
+        {
+            ResidueIndices[residue.number] = ResidueNumbers.size();
+            ResidueNumbers += residue.number;
+            ResidueStarts += start;
+        }
+    }
+    ResidueStarts += atoms.size();
+
+    if (atoms.isEmpty() || frames < 2)
+    {
+        qDebug() << "empty cross-correlation (no RMSDs history for the selection)";
+        atoms.clear();
+        ResidueNumbers.clear();
+        ResidueIndices.clear();
+        return;
+    }
+
+    int size = atoms.size();
+
+    // fluctuations : frames x 3N, one column per atom coordinate
+    Eigen::MatrixXf X(frames, 3 * size);
+    // atoms fluctuations norms, sqrt(<dr^2>)
+    Eigen::VectorXf norms(size);
+    {
+        // derived RMSDs are reconstructed a frame at a time
+        if (trajectory->CompactRMSDs)
+        {
+            auto keys = trajectory->atoms.keys().toVector();
+
+            QVector<int> indices;
+            for (auto number : atoms)
+            {
+                indices += static_cast<int>(std::lower_bound(keys.begin(), keys.end(), number) - keys.begin());
+            }
+
+            for (int f = 0; f < frames; f++)
+            {
+                auto RMSDs = trajectory->GetAtomsRMSDs(f);
+
+                for (int i = 0; i < size; i++)
+                {
+                    X(f, 3 * i + 0) = RMSDs.at(indices[i]).x();
+                    X(f, 3 * i + 1) = RMSDs.at(indices[i]).y();
+                    X(f, 3 * i + 2) = RMSDs.at(indices[i]).z();
+                }
+            }
+        }
+
+        auto lambda = [&] (int i)
+        {
+            if (!trajectory->CompactRMSDs)
+            {
+                const auto &RMSDs = trajectory->atoms.value(atoms.at(i)).RMSDs;
+
+                for (int f = 0; f < frames; f++)
+                {
+                    X(f, 3 * i + 0) = RMSDs.at(f).x();
+                    X(f, 3 * i + 1) = RMSDs.at(f).y();
+                    X(f, 3 * i + 2) = RMSDs.at(f).z();
+                }
+            }
+
+            auto columns = X.middleCols(3 * i, 3);
+            columns.rowwise() -= columns.colwise().mean();
+
+            norms(i) = std::sqrt(columns.squaredNorm() / frames);
+        };
+
+        auto indices = GetIndices(size);
+        QtConcurrent::blockingMap(indices, lambda);
+    }
+
+    // tiles : runs of whole residues of about TileSize atoms,
+    // so that each residues pair is owned by a single tiles pair
+    QVector<int> TileStarts; // in residues
+    TileStarts += 0;
+    for (int r = 0; r < ResidueNumbers.size(); r++)
+    {
+        if (ResidueStarts[r + 1] - ResidueStarts[TileStarts.last()] >= TileSize)
+        {
+            TileStarts += r + 1;
+        }
+    }
+    if (TileStarts.last() != ResidueNumbers.size())
+    {
+        TileStarts += ResidueNumbers.size();
+    }
+
+    int tiles = TileStarts.size() - 1;
+
+    QVector<QPair<int, int>> pairs;
+    for (int I = 0; I < tiles; I++)
+    {
+        for (int J = I; J < tiles; J++)
+        {
+            pairs += qMakePair(I, J);
+        }
+    }
+
+    int residues = ResidueNumbers.size();
+    ResiduesMatrix = Eigen::MatrixXf::Zero(residues, residues);
+    if (AtomLevel)
+    {
+        AtomsMatrix = Eigen::MatrixXf::Zero(size, size);
+    }
+
+    // tiles products run in parallel, one thread each
+    Eigen::setNbThreads(1);
+
+    auto lambda = [&] (QPair<int, int> pair)
+    {
+        int FirstResidueI = TileStarts[pair.first], LastResidueI = TileStarts[pair.first + 1];
+        int FirstResidueJ = TileStarts[pair.second], LastResidueJ = TileStarts[pair.second + 1];
+
+        int FirstAtomI = ResidueStarts[FirstResidueI], SizeI = ResidueStarts[LastResidueI] - FirstAtomI;
+        int FirstAtomJ = ResidueStarts[FirstResidueJ], SizeJ = ResidueStarts[LastResidueJ] - FirstAtomJ;
+
+        // covariances of the tiles coordinates, (3 SizeI) x (3 SizeJ) summed over frames
+        Eigen::MatrixXf G;
+        G.noalias() = X.middleCols(3 * FirstAtomI, 3 * SizeI).transpose() * X.middleCols(3 * FirstAtomJ, 3 * SizeJ);
+        G /= frames;
+
+        // atoms correlations : traces of the 3 x 3 blocks
+        Eigen::MatrixXf C(SizeI, SizeJ);
+        for (int j = 0; j < SizeJ; j++)
+        {
+            for (int i = 0; i < SizeI; i++)
+            {
+                float norm = norms(FirstAtomI + i) * norms(FirstAtomJ + j);
+                float trace = G(3 * i, 3 * j) + G(3 * i + 1, 3 * j + 1) + G(3 * i + 2, 3 * j + 2);
+                C(i, j) = (norm > 0) ? trace / norm : 0;
+            }
+        }
+
+        if (AtomLevel)
+        {
+            AtomsMatrix.block(FirstAtomI, FirstAtomJ, SizeI, SizeJ) = C;
+            AtomsMatrix.block(FirstAtomJ, FirstAtomI, SizeJ, SizeI) = C.transpose();
+        }
+
+        // residues summary
+        for (int a = FirstResidueI; a < LastResidueI; a++)
+        {
+            for (int b = FirstResidueJ; b < LastResidueJ; b++)
+            {
+                int i = ResidueStarts[a] - FirstAtomI, m = ResidueStarts[a + 1] - ResidueStarts[a];
+                int j = ResidueStarts[b] - FirstAtomJ, n = ResidueStarts[b + 1] - ResidueStarts[b];
+
+                float value = C.block(i, j, m, n).mean();
+                ResiduesMatrix(a, b) = value;
+                ResiduesMatrix(b, a) = value;
+            }
+        }
+    };
+    QtConcurrent::blockingMap(pairs, lambda);
+
+    Eigen::setNbThreads(QThread::idealThreadCount());
+}
+
+bool CrossCorrelation::isEmpty() const
+{
+    return ResidueNumbers.isEmpty();
+}
+
+float CrossCorrelation::GetCorrelation(int a, int b) const
+{
+    int i = GetResidueIndex(a);
+    int j = GetResidueIndex(b);
+
+    if (i < 0 || j < 0)
+    {
+        return NAN;
+    }
+
+    return ResiduesMatrix(i, j);
+}
+
+int CrossCorrelation::GetResidueIndex(int ResidueNumber) const
+{
+    return ResidueIndices.value(ResidueNumber, -1);
+}
+
+void CrossCorrelation::Export(QString path) const
+{
+    QFile file(path);
+    assert(file.open(QIODevice::Text | QIODevice::WriteOnly));
+
+    QTextStream stream(&file);
+
+    int size = ResidueNumbers.size();
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = i; j < size; j++)
+        {
+            stream << "DCCM " << ResidueNumbers[i] << " " << ResidueNumbers[j] << " " << ResiduesMatrix(i, j) << "\n";
+        }
+    }
+
+    file.close();
+}
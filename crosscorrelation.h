@@ -0,0 +1,55 @@
+#ifndef CROSSCORRELATION_H
+#define CROSSCORRELATION_H
+
+#include <QFile>
+#include <QSet>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include <Eigen/Dense>
+
+#include "trajectory.h"
+#include "utility.h"
+using namespace utility;
+
+// dynamic cross-correlation of the atoms fluctuations (DCCM),
+// C(i, j) = <dri . drj> / sqrt(<dri^2> <drj^2>), with dr the RMSD vectors minus their average
+// (the RMSD vectors are taken in the frame of their own residue superposition)
+class CrossCorrelation
+{
+public:
+    CrossCorrelation(Trajectory *trajectory);
+
+    // selection atoms grouped by residue, in matrix order
+    QVector<int> atoms;
+    // selection residues, in matrix order
+    QVector<int> ResidueNumbers;
+
+    // residue x residue summary : mean correlation over the atoms pairs of two residues
+    Eigen::MatrixXf ResiduesMatrix;
+    // atom x atom matrix, only kept on request
+    Eigen::MatrixXf AtomsMatrix;
+
+    // atoms per tile, the product of two tiles stays in cache
+    int TileSize = 96;
+
+    void Compute(QVector<int> selection, bool AtomLevel = false);
+
+    bool isEmpty() const;
+
+    // correlation between two residues (residues numbers), NAN outside the selection
+    float GetCorrelation(int a, int b) const;
+    // matrix index of a residue, -1 outside the selection
+    int GetResidueIndex(int ResidueNumber) const;
+
+    // one "DCCM a b correlation" line per residues pair (a <= b)
+    void Export(QString path) const;
+
+private:
+    Trajectory *trajectory;
+
+    // map : residue number -> matrix index
+    QMap<int, int> ResidueIndices;
+};
+
+#endif // CROSSCORRELATION_H
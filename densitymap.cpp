@@ -0,0 +1,398 @@
+#include "densitymap.h"
+
+DensityMap::DensityMap(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+    spacing = 1.0f;
+    sigma = 1.0f;
+    MaxValue = 0;
+    dims[0] = dims[1] = dims[2] = 0;
+    reference = Eigen::Vector3f::Zero();
+}
+
+void DensityMap::Align(QVector<int> FitSelection)
+{
+    rotations.clear();
+    centroids.clear();
+
+    int frames = trajectory->models.size();
+
+    if (frames == 0 || FitSelection.isEmpty())
+    {
+        return;
+    }
+
+    rotations.resize(frames);
+    centroids.resize(frames);
+
+    // fit atoms of a frame, centered with respect to their centroid
+    auto GetConformation = [=] (int step, Eigen::Vector3f &centroid)
+    {
+        QVector<Eigen::Vector3f> x;
+        for (auto p : trajectory->GetPositions(step, FitSelection))
+        {
+            x += FromQVector3DToVector3f(p);
+        }
+
+        centroid = Eigen::Vector3f::Zero();
+        for (const auto &v : x)
+        {
+            centroid += v;
+        }
+        centroid /= x.size();
+
+        for (auto &v : x)
+        {
+            v -= centroid;
+        }
+
+        return x;
+    };
+
+    auto a = GetConformation(0, reference);
+
+    auto R = rotations.data();
+    auto c = centroids.data();
+
+    auto lambda = [=] (int step)
+    {
+        auto b = GetConformation(step, c[step]);
+        R[step] = trajectory->GetRotateMatrix(a, b);
+    };
+
+    auto steps = GetIndices(frames);
+    QtConcurrent::blockingMap(steps, lambda);
+}
+
+int DensityMap::GetCellIndex(int x, int y, int z) const
+{
+    return (z * dims[1] + y) * dims[0] + x;
+}
+
+void DensityMap::Accumulate(QVector<int> selection, float spacing, float sigma)
+{
+    values.clear();
+    MaxValue = 0;
+    dims[0] = dims[1] = dims[2] = 0;
+
+    int frames = trajectory->models.size();
+
+    if (selection.isEmpty() || frames == 0 || rotations.size() != frames)
+    {
+        return;
+    }
+
+    this->spacing = spacing;
+    this->sigma = sigma;
+
+    int count = selection.size();
+
+    // selection positions of a frame, superposed on the first model
+    auto GetAligned = [=] (int step, QVector<Eigen::Vector3f> &aligned)
+    {
+        const Trajectory::Model &model = trajectory->models.at(step);
+        const Eigen::Matrix3f &R = rotations.at(step);
+        const Eigen::Vector3f &c = centroids.at(step);
+
+        aligned.resize(count);
+        for (int i = 0; i < count; i++)
+        {
+            aligned[i] = R * (FromQVector3DToVector3f(model.value(selection.at(i))) - c) + reference;
+        }
+    };
+
+    // bounding box of the aligned positions (min and max are order independent)
+    struct Worker
+    {
+        int begin;
+        int end;
+        Eigen::Vector3f min;
+        Eigen::Vector3f max;
+        QVector<quint64> grid;
+    };
+
+    QVector<Worker> workers;
+    for (auto chunk : GetChunks(frames))
+    {
+        Worker worker;
+        worker.begin = chunk.first;
+        worker.end = chunk.second;
+        worker.min = Eigen::Vector3f::Constant(FLT_MAX);
+        worker.max = Eigen::Vector3f::Constant(-FLT_MAX);
+        workers += worker;
+    }
+
+    {
+        auto lambda = [&] (Worker &worker)
+        {
+            QVector<Eigen::Vector3f> aligned;
+
+            for (int step = worker.begin; step < worker.end; step++)
+            {
+                GetAligned(step, aligned);
+
+                for (const auto &p : aligned)
+                {
+                    worker.min = worker.min.cwiseMin(p);
+                    worker.max = worker.max.cwiseMax(p);
+                }
+            }
+        };
+        QtConcurrent::blockingMap(workers, lambda);
+    }
+
+    Eigen::Vector3f min = workers.first().min;
+    Eigen::Vector3f max = workers.first().max;
+    for (const auto &worker : workers)
+    {
+        min = min.cwiseMin(worker.min);
+        max = max.cwiseMax(worker.max);
+    }
+
+    // the splats reach 3 sigma around the positions
+    float padding = 3 * sigma + spacing;
+    min -= Eigen::Vector3f::Constant(padding);
+    max += Eigen::Vector3f::Constant(padding);
+
+    Eigen::Vector3f extent = max - min;
+
+    // coarser cells when the grid would exceed the cells bound
+    double volume = static_cast<double>(extent.x()) * extent.y() * extent.z();
+    if (volume / (spacing * spacing * spacing) > MaxCells)
+    {
+        this->spacing = spacing = static_cast<float>(std::cbrt(volume / MaxCells)) * 1.01f;
+        qDebug() << "density spacing raised to" << spacing << "A";
+    }
+
+    origin = FromVector3fToQVector3D(min);
+    for (int i = 0; i < 3; i++)
+    {
+        dims[i] = qMax(1, static_cast<int>(std::ceil(extent[i] / spacing)));
+    }
+
+    int cells = dims[0] * dims[1] * dims[2];
+
+    // separable Gaussian : the weights along each axis, normalized so that each position adds 1 in total
+    int reach = (sigma > 0) ? qMax(1, static_cast<int>(std::ceil(3 * sigma / spacing))) : 0;
+    float factor = (sigma > 0) ? -0.5f / (sigma * sigma) : 0;
+
+    {
+        auto lambda = [&] (Worker &worker)
+        {
+            worker.grid.fill(0, cells);
+            quint64 *grid = worker.grid.data();
+
+            QVector<Eigen::Vector3f> aligned;
+            float weights[3][64];
+
+            for (int step = worker.begin; step < worker.end; step++)
+            {
+                GetAligned(step, aligned);
+
+                for (const auto &p : aligned)
+                {
+                    Eigen::Vector3f s = (p - min) / spacing;
+
+                    int cell[3];
+                    for (int i = 0; i < 3; i++)
+                    {
+                        cell[i] = qBound(0, static_cast<int>(s[i]), dims[i] - 1);
+                    }
+
+                    if (reach == 0)
+                    {
+                        grid[GetCellIndex(cell[0], cell[1], cell[2])] += static_cast<quint64>(WeightScale);
+                        continue;
+                    }
+
+                    int first[3];
+                    int last[3];
+                    float sums[3];
+
+                    for (int i = 0; i < 3; i++)
+                    {
+                        first[i] = qMax(0, cell[i] - reach);
+                        last[i] = qMin(dims[i] - 1, qMin(cell[i] + reach, first[i] + 63));
+                        sums[i] = 0;
+
+                        for (int k = first[i]; k <= last[i]; k++)
+                        {
+                            // distance from the cell center
+                            float d = (k + 0.5f - s[i]) * spacing;
+                            weights[i][k - first[i]] = std::exp(factor * d * d);
+                            sums[i] += weights[i][k - first[i]];
+                        }
+                    }
+
+                    float norm = WeightScale / (sums[0] * sums[1] * sums[2]);
+
+                    for (int z = first[2]; z <= last[2]; z++)
+                    {
+                        float wz = weights[2][z - first[2]] * norm;
+
+                        for (int y = first[1]; y <= last[1]; y++)
+                        {
+                            float wyz = weights[1][y - first[1]] * wz;
+                            quint64 *row = grid + GetCellIndex(0, y, z);
+
+                            for (int x = first[0]; x <= last[0]; x++)
+                            {
+                                row[x] += static_cast<quint64>(weights[0][x - first[0]] * wyz + 0.5f);
+                            }
+                        }
+                    }
+                }
+            }
+        };
+        QtConcurrent::blockingMap(workers, lambda);
+    }
+
+    // merge the threads grids (integer sums, exact in any order)
+    auto merge = [cells] (Worker &a, const Worker &b)
+    {
+        for (int i = 0; i < cells; i++)
+        {
+            a.grid[i] += b.grid[i];
+        }
+    };
+    PairwiseMerge(workers, merge);
+
+    const QVector<quint64> &grid = workers.first().grid;
+
+    // atoms per cubic Angstrom, averaged over the frames
+    double scale = 1.0 / (static_cast<double>(WeightScale) * frames * spacing * spacing * spacing);
+
+    values.resize(cells);
+    for (int i = 0; i < cells; i++)
+    {
+        values[i] = static_cast<float>(grid[i] * scale);
+        MaxValue = qMax(MaxValue, values[i]);
+    }
+}
+
+bool DensityMap::isEmpty() const
+{
+    return values.isEmpty();
+}
+
+float DensityMap::GetValue(QVector3D position) const
+{
+    if (isEmpty())
+    {
+        return 0;
+    }
+
+    QVector3D s = (position - origin) / spacing;
+
+    int x = static_cast<int>(std::floor(s.x()));
+    int y = static_cast<int>(std::floor(s.y()));
+    int z = static_cast<int>(std::floor(s.z()));
+
+    if (x < 0 || y < 0 || z < 0 || x >= dims[0] || y >= dims[1] || z >= dims[2])
+    {
+        return 0;
+    }
+
+    return values[GetCellIndex(x, y, z)];
+}
+
+ModelData DensityMap::GetVertices(float level, bool surface) const
+{
+    ModelData data;
+
+    if (isEmpty() || trajectory->models.isEmpty() || level <= 0)
+    {
+        return data;
+    }
+
+    // the rendered models are centered on their centroid
+    QVector3D centroid = GetCentroid(trajectory->models.first().values().toVector());
+
+    QVector3D light = FromQColorToQVector3D("#aaddff");
+    QVector3D dark = FromQColorToQVector3D("#0055ff");
+
+    auto Above = [&] (int x, int y, int z)
+    {
+        if (x < 0 || y < 0 || z < 0 || x >= dims[0] || y >= dims[1] || z >= dims[2])
+        {
+            return false;
+        }
+        return values[GetCellIndex(x, y, z)] >= level;
+    };
+
+    for (int z = 0; z < dims[2]; z++)
+    {
+        for (int y = 0; y < dims[1]; y++)
+        {
+            for (int x = 0; x < dims[0]; x++)
+            {
+                float value = values[GetCellIndex(x, y, z)];
+
+                if (value < level)
+                {
+                    continue;
+                }
+
+                if (surface && Above(x - 1, y, z) && Above(x + 1, y, z) && Above(x, y - 1, z) && Above(x, y + 1, z) && Above(x, y, z - 1) && Above(x, y, z + 1))
+                {
+                    continue;
+                }
+
+                float t = (MaxValue > level) ? (value - level) / (MaxValue - level) : 1;
+
+                VertexData vertex;
+                vertex.center = origin + QVector3D(x + 0.5f, y + 0.5f, z + 0.5f) * spacing - centroid;
+                // the surface cells overlap into a closed shell, the volume cells grow with the density
+                vertex.radius = spacing * (surface ? 0.75f : 0.25f + 0.35f * t);
+                vertex.albedo = light * (1 - t) + dark * t;
+                // no atom number : the density is not hovered
+                vertex.number = QVector2D(0, 0);
+
+                data += vertex;
+            }
+        }
+    }
+
+    return data;
+}
+
+void DensityMap::Export(QString path) const
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        qDebug() << "cannot open" << path;
+        return;
+    }
+
+    QTextStream stream(&file);
+
+    // OpenDX : z fastest
+    stream << QString("object 1 class gridpositions counts %1 %2 %3\n").arg(dims[0]).arg(dims[1]).arg(dims[2]);
+    stream << QString("origin %1 %2 %3\n").arg(origin.x() + 0.5f * spacing).arg(origin.y() + 0.5f * spacing).arg(origin.z() + 0.5f * spacing);
+    stream << QString("delta %1 0 0\n").arg(spacing);
+    stream << QString("delta 0 %1 0\n").arg(spacing);
+    stream << QString("delta 0 0 %1\n").arg(spacing);
+    stream << QString("object 2 class gridconnections counts %1 %2 %3\n").arg(dims[0]).arg(dims[1]).arg(dims[2]);
+    stream << QString("object 3 class array type double rank 0 items %1 data follows\n").arg(values.size());
+
+    int column = 0;
+    for (int x = 0; x < dims[0]; x++)
+    {
+        for (int y = 0; y < dims[1]; y++)
+        {
+            for (int z = 0; z < dims[2]; z++)
+            {
+                stream << values[GetCellIndex(x, y, z)];
+                stream << ((++column % 3 == 0) ? "\n" : " ");
+            }
+        }
+    }
+    if (column % 3 != 0)
+    {
+        stream << "\n";
+    }
+
+    stream << "object \"density\" class field\n";
+}
@@ -0,0 +1,67 @@
+#ifndef DENSITYMAP_H
+#define DENSITYMAP_H
+
+#include <QFile>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include <Eigen/Dense>
+
+#include "trajectory.h"
+#include "utility.h"
+using namespace utility;
+
+// occupancy density of the selection atoms over the trajectory, on a uniform grid in the frame of the first model
+// (every frame superposed on the first one on the fit selection atoms)
+class DensityMap
+{
+public:
+    DensityMap(Trajectory *trajectory);
+
+    // cell edge (in Angstrom)
+    float spacing;
+    // Gaussian splatting width (in Angstrom), 0 : each position counts in its own cell
+    float sigma;
+
+    // mean number of selection atoms per cubic Angstrom in each cell, x fastest
+    QVector<float> values;
+    float MaxValue;
+    // corner of the first cell and cells count along each axis
+    QVector3D origin;
+    int dims[3];
+
+    // superposition of every frame on the first model, kept for the following accumulations
+    void Align(QVector<int> FitSelection);
+    // density of the selection over the aligned frames,
+    // each thread splats a contiguous range of frames in its own grid, the grids are merged at the end
+    void Accumulate(QVector<int> selection, float spacing, float sigma);
+
+    bool isEmpty() const;
+
+    // density of the cell holding position (0 outside the grid)
+    float GetValue(QVector3D position) const;
+
+    // cells at or above level, as impostors centered like the first model VAO
+    // surface : the cells with a neighbour below level only (isosurface shell), otherwise all of them (volume)
+    ModelData GetVertices(float level, bool surface) const;
+
+    // OpenDX scalar field
+    void Export(QString path) const;
+
+private:
+    Trajectory *trajectory;
+
+    // frame superposition : x -> rotations[m] * (x - centroids[m]) + reference
+    QVector<Eigen::Matrix3f> rotations;
+    QVector<Eigen::Vector3f> centroids;
+    Eigen::Vector3f reference;
+
+    // the grids hold fixed-point weights, so that the merge is exact whatever the threads count
+    const float WeightScale = 1024;
+    // cells bound of a grid, the spacing grows beyond
+    const qint64 MaxCells = 1 << 22;
+
+    int GetCellIndex(int x, int y, int z) const;
+};
+
+#endif // DENSITYMAP_H
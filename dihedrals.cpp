@@ -0,0 +1,380 @@
+#include "dihedrals.h"
+
+// out-of-class definition : the constant is bound to references (QVector::fill)
+const qint16 Dihedrals::Undefined;
+
+// branch-free atan2, vectorizable (absolute error below 1e-5 radians)
+static inline float FastAtan2(float y, float x)
+{
+    float ax = std::abs(x);
+    float ay = std::abs(y);
+
+    float a = qMin(ax, ay) / qMax(qMax(ax, ay), FLT_MIN);
+    float s = a * a;
+
+    // minimax polynomial of atan on [0, 1]
+    float r = ((((-0.0117212f * s + 0.05265332f) * s - 0.11643287f) * s + 0.19354346f) * s - 0.33262347f) * s + 0.99997726f;
+    r *= a;
+
+    r = (ay > ax) ? 1.57079637f - r : r;
+    r = (x < 0) ? 3.14159274f - r : r;
+    r = (y < 0) ? -r : r;
+
+    return r;
+}
+
+Dihedrals::Dihedrals(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+    frames = 0;
+}
+
+QVector<Dihedrals::Quadruple> Dihedrals::GetQuadruples() const
+{
+    // side-chain atoms of each chi angle, after N and CA
+    QMap<QString, QStringList> chains;
+    chains["ARG"] = QStringList({"CB", "CG", "CD", "NE", "CZ"});
+    chains["ASN"] = QStringList({"CB", "CG", "OD1"});
+    chains["ASP"] = QStringList({"CB", "CG", "OD1"});
+    chains["CYS"] = QStringList({"CB", "SG"});
+    chains["GLN"] = QStringList({"CB", "CG", "CD", "OE1"});
+    chains["GLU"] = QStringList({"CB", "CG", "CD", "OE1"});
+    chains["HIS"] = QStringList({"CB", "CG", "ND1"});
+    chains["ILE"] = QStringList({"CB", "CG1", "CD1"});
+    chains["LEU"] = QStringList({"CB", "CG", "CD1"});
+    chains["LYS"] = QStringList({"CB", "CG", "CD", "CE", "NZ"});
+    chains["MET"] = QStringList({"CB", "CG", "SD", "CE"});
+    chains["PHE"] = QStringList({"CB", "CG", "CD1"});
+    chains["PRO"] = QStringList({"CB", "CG", "CD"});
+    chains["SER"] = QStringList({"CB", "OG"});
+    chains["THR"] = QStringList({"CB", "OG1"});
+    chains["TRP"] = QStringList({"CB", "CG", "CD1"});
+    chains["TYR"] = QStringList({"CB", "CG", "CD1"});
+    chains["VAL"] = QStringList({"CB", "CG1"});
+
+    // force fields protonation states (AMBER, CHARMM) and disulfide bonded cysteines
+    chains["HID"] = chains["HIE"] = chains["HIP"] = chains["HSD"] = chains["HSE"] = chains["HSP"] = chains["HIS"];
+    chains["CYX"] = chains["CYM"] = chains["CYS"];
+
+    // map : residue number -> (atom name -> atom number)
+    QMap<int, QMap<QString, int>> names;
+    for (auto residue : trajectory->residues)
+    {
+        for (auto number : residue.atoms)
+        {
+            names[residue.number][trajectory->atoms.value(number).name] = number;
+        }
+    }
+
+    const Trajectory::Model &FirstModel = trajectory->models.first();
+
+    // consecutive residues are bonded through C(i) - N(i+1)
+    auto Bonded = [&] (int a, int b)
+    {
+        Residue x = trajectory->residues.value(a);
+        Residue y = trajectory->residues.value(b);
+
+        if (x.chain != y.chain || !names[a].contains("C") || !names[b].contains("N"))
+        {
+            return false;
+        }
+
+        return FirstModel.value(names[a]["C"]).distanceToPoint(FirstModel.value(names[b]["N"])) < 2.0f;
+    };
+
+    QVector<Quadruple> quadruples;
+
+    auto Add = [&] (int r, DihedralAngle angle, QVector<int> atoms)
+    {
+        Quadruple quadruple;
+        quadruple.index = r * DihedralAnglesCount + angle;
+        for (int i = 0; i < 4; i++)
+        {
+            quadruple.atoms[i] = atoms[i];
+        }
+        quadruples += quadruple;
+    };
+
+    for (int r = 0; r < ResidueNumbers.size(); r++)
+    {
+        int number = ResidueNumbers[r];
+        auto atoms = names[number];
+
+        if (!atoms.contains("N") || !atoms.contains("CA") || !atoms.contains("C"))
+        {
+            continue;
+        }
+
+        bool previous = (r > 0) && Bonded(ResidueNumbers[r - 1], number);
+        bool next = (r + 1 < ResidueNumbers.size()) && Bonded(number, ResidueNumbers[r + 1]);
+
+        if (previous)
+        {
+            Add(r, PHI, {names[ResidueNumbers[r - 1]]["C"], atoms["N"], atoms["CA"], atoms["C"]});
+        }
+
+        if (next)
+        {
+            auto following = names[ResidueNumbers[r + 1]];
+            Add(r, PSI, {atoms["N"], atoms["CA"], atoms["C"], following["N"]});
+
+            if (following.contains("CA"))
+            {
+                Add(r, OMEGA, {atoms["CA"], atoms["C"], following["N"], following["CA"]});
+            }
+        }
+
+        // chi angles along the side chain
+        QStringList chain = QStringList({"N", "CA"}) + chains.value(trajectory->residues.value(number).name);
+
+        for (int i = 0; i + 3 < chain.size() && i < 4; i++)
+        {
+            if (!atoms.contains(chain[i]) || !atoms.contains(chain[i + 1]) || !atoms.contains(chain[i + 2]) || !atoms.contains(chain[i + 3]))
+            {
+                break;
+            }
+
+            Add(r, static_cast<DihedralAngle>(CHI1 + i), {atoms[chain[i]], atoms[chain[i + 1]], atoms[chain[i + 2]], atoms[chain[i + 3]]});
+        }
+    }
+
+    return quadruples;
+}
+
+void Dihedrals::Compute()
+{
+    ResidueIndices.clear();
+    ResidueNumbers.clear();
+
+    for (auto number : trajectory->residues.keys())
+    {
+        ResidueIndices[number] = ResidueNumbers.size();
+        ResidueNumbers += number;
+    }
+
+    frames = trajectory->models.size();
+
+    if (frames == 0)
+    {
+        table.clear();
+        return;
+    }
+
+    auto quadruples = GetQuadruples();
+    int count = quadruples.size();
+    int stride = ResidueNumbers.size() * DihedralAnglesCount;
+
+    table.fill(Undefined, frames * stride);
+
+    // the atoms of the quadruples, read once per frame
+    QVector<int> selection;
+    QMap<int, int> SelectionIndices;
+    QVector<int> AtomSlots(4 * count);
+
+    for (int q = 0; q < count; q++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            int number = quadruples[q].atoms[i];
+
+            if (!SelectionIndices.contains(number))
+            {
+                SelectionIndices[number] = selection.size();
+                selection += number;
+            }
+
+            AtomSlots[4 * q + i] = SelectionIndices[number];
+        }
+    }
+
+    qint16 *data = table.data();
+
+    auto lambda = [&] (QPair<int, int> chunk)
+    {
+        // bond vectors in SoA layout, so that the dihedral loop vectorizes
+        QVector<float> b1x(count), b1y(count), b1z(count);
+        QVector<float> b2x(count), b2y(count), b2z(count);
+        QVector<float> b3x(count), b3y(count), b3z(count);
+        QVector<float> angles(count);
+
+        for (int step = chunk.first; step < chunk.second; step++)
+        {
+            auto positions = trajectory->GetPositions(step, selection);
+
+            for (int q = 0; q < count; q++)
+            {
+                QVector3D p0 = positions[AtomSlots[4 * q + 0]];
+                QVector3D p1 = positions[AtomSlots[4 * q + 1]];
+                QVector3D p2 = positions[AtomSlots[4 * q + 2]];
+                QVector3D p3 = positions[AtomSlots[4 * q + 3]];
+
+                b1x[q] = p1.x() - p0.x(); b1y[q] = p1.y() - p0.y(); b1z[q] = p1.z() - p0.z();
+                b2x[q] = p2.x() - p1.x(); b2y[q] = p2.y() - p1.y(); b2z[q] = p2.z() - p1.z();
+                b3x[q] = p3.x() - p2.x(); b3y[q] = p3.y() - p2.y(); b3z[q] = p3.z() - p2.z();
+            }
+
+            const float *B1x = b1x.constData(), *B1y = b1y.constData(), *B1z = b1z.constData();
+            const float *B2x = b2x.constData(), *B2y = b2y.constData(), *B2z = b2z.constData();
+            const float *B3x = b3x.constData(), *B3y = b3y.constData(), *B3z = b3z.constData();
+            float *A = angles.data();
+
+            // angle = atan2(|b2| b1 . (b2 x b3), (b1 x b2) . (b2 x b3))
+            for (int q = 0; q < count; q++)
+            {
+                // n1 = b1 x b2, n2 = b2 x b3
+                float n1x = B1y[q] * B2z[q] - B1z[q] * B2y[q];
+                float n1y = B1z[q] * B2x[q] - B1x[q] * B2z[q];
+                float n1z = B1x[q] * B2y[q] - B1y[q] * B2x[q];
+
+                float n2x = B2y[q] * B3z[q] - B2z[q] * B3y[q];
+                float n2y = B2z[q] * B3x[q] - B2x[q] * B3z[q];
+                float n2z = B2x[q] * B3y[q] - B2y[q] * B3x[q];
+
+                float length = std::sqrt(B2x[q] * B2x[q] + B2y[q] * B2y[q] + B2z[q] * B2z[q]);
+
+                float x = n1x * n2x + n1y * n2y + n1z * n2z;
+                float y = length * (B1x[q] * n2x + B1y[q] * n2y + B1z[q] * n2z);
+
+                A[q] = FastAtan2(y, x) * 5729.5779513f;
+            }
+
+            qint16 *row = data + static_cast<qint64>(step) * stride;
+            for (int q = 0; q < count; q++)
+            {
+                row[quadruples[q].index] = static_cast<qint16>(qBound(-18000, qRound(A[q]), 18000));
+            }
+        }
+    };
+
+    auto chunks = GetChunks(frames);
+    QtConcurrent::blockingMap(chunks, lambda);
+}
+
+bool Dihedrals::isEmpty() const
+{
+    return table.isEmpty();
+}
+
+float Dihedrals::GetAngle(int step, int ResidueNumber, DihedralAngle angle) const
+{
+    int index = ResidueIndices.value(ResidueNumber, -1);
+
+    if (isEmpty() || index < 0 || step < 0 || step >= frames)
+    {
+        return NAN;
+    }
+
+    qint16 value = table[(step * ResidueNumbers.size() + index) * DihedralAnglesCount + angle];
+    return (value == Undefined) ? NAN : value * 0.01f;
+}
+
+QPair<int, int> Dihedrals::GetWindow(int step, int window) const
+{
+    int begin = qBound(0, step - window / 2, frames - 1);
+    int end = qBound(begin + 1, begin + window, frames);
+    // shift the window back when it exceeds the last frame
+    begin = qMax(0, end - window);
+
+    return qMakePair(begin, end);
+}
+
+float Dihedrals::GetWindowVariance(int step, int ResidueNumber, DihedralAngle angle, int window) const
+{
+    if (isEmpty())
+    {
+        return NAN;
+    }
+
+    auto bounds = GetWindow(step, window);
+
+    double c = 0;
+    double s = 0;
+    int count = 0;
+
+    for (int i = bounds.first; i < bounds.second; i++)
+    {
+        float value = GetAngle(i, ResidueNumber, angle);
+
+        if (!std::isnan(value))
+        {
+            c += std::cos(qDegreesToRadians(value));
+            s += std::sin(qDegreesToRadians(value));
+            count += 1;
+        }
+    }
+
+    if (count == 0)
+    {
+        return NAN;
+    }
+
+    // 1 - length of the mean direction
+    return static_cast<float>(1.0 - std::sqrt(c * c + s * s) / count);
+}
+
+Eigen::MatrixXf Dihedrals::GetRamachandran(int step, int window, int bins) const
+{
+    Eigen::MatrixXf density = Eigen::MatrixXf::Zero(bins, bins);
+
+    if (isEmpty())
+    {
+        return density;
+    }
+
+    auto bounds = GetWindow(step, window);
+    int stride = ResidueNumbers.size() * DihedralAnglesCount;
+
+    auto GetBin = [=] (qint16 value)
+    {
+        return qBound(0, (value + 18000) * bins / 36000, bins - 1);
+    };
+
+    for (int i = bounds.first; i < bounds.second; i++)
+    {
+        const qint16 *row = table.constData() + static_cast<qint64>(i) * stride;
+
+        for (int r = 0; r < ResidueNumbers.size(); r++)
+        {
+            qint16 phi = row[r * DihedralAnglesCount + PHI];
+            qint16 psi = row[r * DihedralAnglesCount + PSI];
+
+            if (phi != Undefined && psi != Undefined)
+            {
+                // phi along the columns, psi upwards
+                density(bins - 1 - GetBin(psi), GetBin(phi)) += 1;
+            }
+        }
+    }
+
+    return density;
+}
+
+void Dihedrals::Export(QString path) const
+{
+    QFile file(path);
+    assert(file.open(QIODevice::Text | QIODevice::WriteOnly));
+
+    QTextStream stream(&file);
+
+    for (auto number : ResidueNumbers)
+    {
+        for (int a = 0; a < DihedralAnglesCount; a++)
+        {
+            auto angle = static_cast<DihedralAngle>(a);
+
+            if (std::isnan(GetAngle(0, number, angle)))
+            {
+                continue;
+            }
+
+            stream << "DIHEDRAL " << number << " " << DihedralAnglesNames[a];
+            for (int step = 0; step < frames; step++)
+            {
+                stream << " " << GetAngle(step, number, angle);
+            }
+            stream << "\n";
+        }
+    }
+
+    file.close();
+}
@@ -0,0 +1,64 @@
+#ifndef DIHEDRALS_H
+#define DIHEDRALS_H
+
+#include <QFile>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include <Eigen/Dense>
+
+#include "trajectory.h"
+#include "utility.h"
+using namespace utility;
+
+enum DihedralAngle { PHI, PSI, OMEGA, CHI1, CHI2, CHI3, CHI4 };
+static const int DihedralAnglesCount = 7;
+static const QStringList DihedralAnglesNames = {"phi", "psi", "omega", "chi1", "chi2", "chi3", "chi4"};
+
+// backbone and side-chain dihedral angles of every residue in every frame
+class Dihedrals
+{
+public:
+    Dihedrals(Trajectory *trajectory);
+
+    void Compute();
+
+    bool isEmpty() const;
+
+    // angle (in degrees, -180 to 180) of a residue (residue number) in step, NAN when undefined
+    float GetAngle(int step, int ResidueNumber, DihedralAngle angle) const;
+    // circular variance (0 to 1) of the angle over the window of frames centered in step
+    float GetWindowVariance(int step, int ResidueNumber, DihedralAngle angle, int window) const;
+
+    // phi / psi density over the window of frames centered in step (bins x bins, psi rows top to bottom)
+    Eigen::MatrixXf GetRamachandran(int step, int window, int bins = 72) const;
+
+    // one "DIHEDRAL residue angle value value ..." line per defined angle, one value per frame
+    void Export(QString path) const;
+
+private:
+    Trajectory *trajectory;
+
+    // map : residue number -> residue index
+    QMap<int, int> ResidueIndices;
+    QVector<int> ResidueNumbers;
+
+    int frames;
+
+    // frames x residues x angles, in hundredths of degree (Undefined : no angle)
+    QVector<qint16> table;
+    static const qint16 Undefined = std::numeric_limits<qint16>::min();
+
+    // atoms (residue, angle) quadruples
+    struct Quadruple
+    {
+        int index; // table index within a frame
+        int atoms[4];
+    };
+    QVector<Quadruple> GetQuadruples() const;
+
+    // frames window [begin, end) centered in step
+    QPair<int, int> GetWindow(int step, int window) const;
+};
+
+#endif // DIHEDRALS_H
@@ -0,0 +1,186 @@
+#include "electrostatics.h"
+
+// Coulomb constant (in kcal/mol * Angstrom / e^2)
+static const float CoulombConstant = 332.0636f;
+
+Electrostatics::Electrostatics(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+    cutoff = 12.0f;
+    dielectric = 4.0f;
+    range = 10.0f;
+    CachedStep = -1;
+    GridBuilt = false;
+}
+
+void Electrostatics::SetParameters(float cutoff, float dielectric)
+{
+    this->cutoff = cutoff;
+    this->dielectric = dielectric;
+
+    // the cells size follows the cutoff
+    CachedStep = -1;
+    GridBuilt = false;
+}
+
+void Electrostatics::SetChargedAtoms()
+{
+    charged.clear();
+    charges.clear();
+    residues.clear();
+    AtomIndices.clear();
+
+    int index = 0;
+    for (const auto &atom : trajectory->atoms)
+    {
+        AtomIndices[atom.number] = index;
+        residues += atom.residue;
+
+        if (atom.charge != 0)
+        {
+            charged += index;
+            charges += atom.charge;
+        }
+
+        index += 1;
+    }
+
+    GridBuilt = false;
+}
+
+const QVector<float> &Electrostatics::GetPotentials(int step)
+{
+    if (step == CachedStep && !potentials.isEmpty())
+    {
+        return potentials;
+    }
+
+    if (AtomIndices.size() != trajectory->atoms.size())
+    {
+        SetChargedAtoms();
+    }
+
+    int size = AtomIndices.size();
+    potentials.fill(0, size);
+    CachedStep = step;
+
+    if (step < 0 || step >= trajectory->models.size() || charged.isEmpty())
+    {
+        return potentials;
+    }
+
+    // atoms positions in atoms order
+    const Trajectory::Model &model = trajectory->models.at(step);
+    QVector<QVector3D> positions;
+    positions.reserve(size);
+    for (auto number : trajectory->atoms.keys())
+    {
+        positions += model.value(number);
+    }
+
+    QVector<QVector3D> sources;
+    sources.reserve(charged.size());
+    for (auto i : charged)
+    {
+        sources += positions[i];
+    }
+
+    // the grid geometry is reused from step to step
+    if (GridBuilt)
+    {
+        grid.Update(sources);
+    }
+    else
+    {
+        grid.Build(sources, cutoff);
+        GridBuilt = true;
+    }
+
+    // charges in cell order (SoA), so that the inner loop streams contiguous memory
+    int count = sources.size();
+    QVector<float> x(count), y(count), z(count), q(count);
+    QVector<int> r(count);
+    for (int slot = 0; slot < count; slot++)
+    {
+        int j = grid.GetSortedIndex(slot);
+        x[slot] = sources[j].x();
+        y[slot] = sources[j].y();
+        z[slot] = sources[j].z();
+        q[slot] = charges[j];
+        r[slot] = residues[charged[j]];
+    }
+
+    const float *X = x.constData(), *Y = y.constData(), *Z = z.constData(), *Q = q.constData();
+    const int *R = r.constData();
+
+    float r2 = cutoff * cutoff;
+    float shift = 1.0f / cutoff;
+    float factor = CoulombConstant / dielectric;
+
+    float *data = potentials.data();
+
+    auto lambda = [&] (QPair<int, int> chunk)
+    {
+        QVector<QPair<int, int>> ranges;
+
+        for (int i = chunk.first; i < chunk.second; i++)
+        {
+            QVector3D p = positions[i];
+            float px = p.x(), py = p.y(), pz = p.z();
+            int residue = residues[i];
+
+            grid.GetCellRanges(p, cutoff, ranges);
+
+            float sum = 0;
+
+            for (auto range : ranges)
+            {
+                // branch-free, vectorizable
+                for (int j = range.first; j < range.second; j++)
+                {
+                    float dx = X[j] - px;
+                    float dy = Y[j] - py;
+                    float dz = Z[j] - pz;
+                    float d2 = qMax(dx * dx + dy * dy + dz * dz, 0.01f);
+
+                    float term = Q[j] * (1.0f / std::sqrt(d2) - shift);
+                    sum += (d2 < r2 && R[j] != residue) ? term : 0.0f;
+                }
+            }
+
+            data[i] = factor * sum;
+        }
+    };
+
+    auto chunks = GetChunks(size);
+    QtConcurrent::blockingMap(chunks, lambda);
+
+    return potentials;
+}
+
+float Electrostatics::GetAtomPotential(int step, int AtomNumber)
+{
+    const auto &values = GetPotentials(step);
+    int index = AtomIndices.value(AtomNumber, -1);
+
+    return (index < 0) ? NAN : values.value(index, NAN);
+}
+
+float Electrostatics::GetResiduePotential(int step, int ResidueNumber)
+{
+    const auto &values = GetPotentials(step);
+    auto atoms = trajectory->residues.value(ResidueNumber).atoms;
+
+    if (atoms.isEmpty())
+    {
+        return NAN;
+    }
+
+    float sum = 0;
+    for (auto number : atoms)
+    {
+        sum += values.value(AtomIndices.value(number, -1), 0);
+    }
+
+    return sum / atoms.size();
+}
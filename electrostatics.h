@@ -0,0 +1,50 @@
+#ifndef ELECTROSTATICS_H
+#define ELECTROSTATICS_H
+
+#include <QtConcurrent>
+
+#include "trajectory.h"
+#include "neighbourgrid.h"
+#include "utility.h"
+using namespace utility;
+
+// Coulomb potential (in kcal/mol/e) at each atom from the charges of the other residues,
+// shifted to zero at the cutoff and summed over a cell list of the charged atoms
+class Electrostatics
+{
+public:
+    Electrostatics(Trajectory *trajectory);
+
+    float cutoff; // in Angstrom
+    float dielectric;
+    // colour scale bound (in kcal/mol/e)
+    float range;
+
+    void SetParameters(float cutoff, float dielectric);
+
+    // potentials of the atoms of step, in atoms order
+    // (computed on demand, the last step is kept for the following queries)
+    const QVector<float> &GetPotentials(int step);
+
+    float GetAtomPotential(int step, int AtomNumber);
+    // mean potential of the residue atoms
+    float GetResiduePotential(int step, int ResidueNumber);
+
+private:
+    Trajectory *trajectory;
+
+    int CachedStep;
+    QVector<float> potentials;
+
+    // charged atoms indices (in atoms order), rebuilt when the atoms change
+    QVector<int> charged;
+    QVector<float> charges;
+    QVector<int> residues; // residue number of each atom
+    QMap<int, int> AtomIndices;
+    void SetChargedAtoms();
+
+    NeighbourGrid grid;
+    bool GridBuilt;
+};
+
+#endif // ELECTROSTATICS_H
@@ -0,0 +1,216 @@
+#include "frameindex.h"
+
+FrameIndex::FrameIndex(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+}
+
+float FrameIndex::GetDistance(int i, int j) const
+{
+    if (i == j)
+    {
+        return 0;
+    }
+
+    return trajectory->GetSuperpositionRMSD(conformations.at(i), conformations.at(j));
+}
+
+void FrameIndex::Build(QVector<QVector<Eigen::Vector3f>> conformations)
+{
+    this->conformations = conformations;
+
+    nodes.clear();
+    items.clear();
+
+    int size = conformations.size();
+
+    if (size == 0 || trajectory == nullptr)
+    {
+        return;
+    }
+
+    for (int i = 0; i < size; i++)
+    {
+        items += i;
+    }
+
+    // root
+    nodes += Node{-1, 0, -1, -1, 0, size};
+
+    std::mt19937 generator(0);
+
+    // distance of each item slot to the vantage of its node
+    QVector<float> distances(size, 0);
+
+    QVector<int> level;
+    level += 0;
+
+    while (!level.isEmpty())
+    {
+        // vantage points : random item of each internal node, moved to its first slot
+        QVector<int> pending;
+        QVector<int> vantages(size, -1);
+
+        for (auto n : level)
+        {
+            Node &node = nodes[n];
+
+            if (node.end - node.begin <= LeafSize)
+            {
+                continue;
+            }
+
+            std::uniform_int_distribution<int> distribution(node.begin, node.end - 1);
+            std::swap(items[node.begin], items[distribution(generator)]);
+            node.vantage = items[node.begin];
+
+            for (int s = node.begin + 1; s < node.end; s++)
+            {
+                pending += s;
+                vantages[s] = node.vantage;
+            }
+        }
+
+        // the whole level in a single parallel pass
+        {
+            auto lambda = [&] (QPair<int, int> chunk)
+            {
+                for (int i = chunk.first; i < chunk.second; i++)
+                {
+                    int s = pending[i];
+                    distances[s] = GetDistance(items[s], vantages[s]);
+                }
+            };
+
+            auto chunks = GetChunks(pending.size());
+            QtConcurrent::blockingMap(chunks, lambda);
+        }
+
+        // median split of each internal node
+        QVector<int> next;
+
+        for (auto n : level)
+        {
+            if (nodes[n].vantage < 0)
+            {
+                continue;
+            }
+
+            int begin = nodes[n].begin + 1;
+            int end = nodes[n].end;
+            int middle = begin + (end - begin) / 2;
+
+            QVector<QPair<float, int>> pairs;
+            for (int s = begin; s < end; s++)
+            {
+                pairs += qMakePair(distances[s], items[s]);
+            }
+            std::nth_element(pairs.begin(), pairs.begin() + (middle - begin), pairs.end());
+            for (int s = begin; s < end; s++)
+            {
+                items[s] = pairs[s - begin].second;
+            }
+
+            nodes[n].radius = pairs[middle - begin].first;
+
+            // inner : [begin, middle), outer : [middle, end)
+            nodes[n].inner = nodes.size();
+            nodes += Node{-1, 0, -1, -1, begin, middle};
+            next += nodes.size() - 1;
+
+            nodes[n].outer = nodes.size();
+            nodes += Node{-1, 0, -1, -1, middle, end};
+            next += nodes.size() - 1;
+        }
+
+        level = next;
+    }
+}
+
+bool FrameIndex::isEmpty() const
+{
+    return nodes.isEmpty();
+}
+
+void FrameIndex::Search(int node, int frame, int k, int exclusion, std::vector<QPair<float, int>> &heap) const
+{
+    const Node &n = nodes.at(node);
+
+    auto consider = [&] (int other, float distance)
+    {
+        if (std::abs(other - frame) < qMax(1, exclusion))
+        {
+            return;
+        }
+
+        if (static_cast<int>(heap.size()) < k)
+        {
+            heap.push_back(qMakePair(distance, other));
+            std::push_heap(heap.begin(), heap.end());
+        }
+        else if (distance < heap.front().first)
+        {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = qMakePair(distance, other);
+            std::push_heap(heap.begin(), heap.end());
+        }
+    };
+
+    // current k-th distance
+    auto tau = [&] ()
+    {
+        return (static_cast<int>(heap.size()) < k) ? FLT_MAX : heap.front().first;
+    };
+
+    if (n.vantage < 0)
+    {
+        for (int s = n.begin; s < n.end; s++)
+        {
+            consider(items[s], GetDistance(frame, items[s]));
+        }
+        return;
+    }
+
+    float d = GetDistance(frame, n.vantage);
+    consider(n.vantage, d);
+
+    // the subtree on the query side first, the other one only when the ball crosses the radius
+    if (d < n.radius)
+    {
+        Search(n.inner, frame, k, exclusion, heap);
+        if (d + tau() >= n.radius)
+        {
+            Search(n.outer, frame, k, exclusion, heap);
+        }
+    }
+    else
+    {
+        Search(n.outer, frame, k, exclusion, heap);
+        if (d - tau() <= n.radius)
+        {
+            Search(n.inner, frame, k, exclusion, heap);
+        }
+    }
+}
+
+QVector<QPair<int, float>> FrameIndex::GetNearest(int frame, int k, int exclusion) const
+{
+    QVector<QPair<int, float>> result;
+
+    if (isEmpty() || frame < 0 || frame >= conformations.size() || k <= 0)
+    {
+        return result;
+    }
+
+    std::vector<QPair<float, int>> heap;
+
+    Search(0, frame, k, exclusion, heap);
+
+    std::sort_heap(heap.begin(), heap.end());
+    for (auto pair : heap)
+    {
+        result += qMakePair(pair.second, pair.first);
+    }
+
+    return result;
+}
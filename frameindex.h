@@ -0,0 +1,59 @@
+#ifndef FRAMEINDEX_H
+#define FRAMEINDEX_H
+
+#include <random>
+
+#include <QtConcurrent>
+
+#include <Eigen/Dense>
+
+#include "trajectory.h"
+#include "utility.h"
+using namespace utility;
+
+// vantage-point tree over the trajectory frames, with the superposition RMSD
+// of a selection (a metric) as the distance between frames
+class FrameIndex
+{
+public:
+    FrameIndex(Trajectory *trajectory = nullptr);
+
+    // conformations : selection atoms positions of each frame, centered (see Trajectory::GetConformations)
+    // built breadth-first, the distances of each tree level are computed in parallel
+    void Build(QVector<QVector<Eigen::Vector3f>> conformations);
+
+    bool isEmpty() const;
+
+    // k nearest frames to frame with their RMSD (in Angstrom), sorted by RMSD,
+    // skipping the frames closer in time than exclusion (trivially similar neighbours)
+    QVector<QPair<int, float>> GetNearest(int frame, int k, int exclusion) const;
+
+private:
+    Trajectory *trajectory;
+
+    QVector<QVector<Eigen::Vector3f>> conformations;
+
+    // node : vantage frame and median distance of its items,
+    // inner items (closer than radius) and outer items (farther) in the children subtrees,
+    // leaves own the items [begin, end)
+    struct Node
+    {
+        int vantage;
+        float radius;
+        int inner;
+        int outer;
+        int begin;
+        int end;
+    };
+    QVector<Node> nodes;
+    QVector<int> items;
+
+    static const int LeafSize = 8;
+
+    float GetDistance(int i, int j) const;
+
+    // heap : (distance, frame) max-heap of the best k candidates
+    void Search(int node, int frame, int k, int exclusion, std::vector<QPair<float, int>> &heap) const;
+};
+
+#endif // FRAMEINDEX_H
@@ -0,0 +1,265 @@
+#include "hbonds.h"
+
+HydrogenBonds::HydrogenBonds(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+    distance = 3.5f;
+    angle = 120.0f;
+}
+
+void HydrogenBonds::SetDonorsAndAcceptors(QVector<int> selection)
+{
+    donors.clear();
+    acceptors.clear();
+
+    // covalent donor-hydrogen distance
+    float MaxBondLength = 1.2f;
+
+    QVector<int> polar;
+    QVector<int> hydrogens;
+
+    for (auto AtomNumber : selection)
+    {
+        QString element = trajectory->atoms.value(AtomNumber).element;
+
+        if (element == "N" || element == "O")
+        {
+            polar += AtomNumber;
+        }
+        else if (element == "H")
+        {
+            hydrogens += AtomNumber;
+        }
+    }
+
+    // hydrogens are bound to the nearest polar atom of the first model
+    QMap<int, int> HydrogensCount;
+
+    if (!hydrogens.isEmpty() && !polar.isEmpty())
+    {
+        NeighbourGrid grid;
+        grid.Build(trajectory->GetPositions(0, polar), MaxBondLength);
+
+        auto positions = trajectory->GetPositions(0, hydrogens);
+
+        for (int i = 0; i < hydrogens.size(); i++)
+        {
+            auto nearest = grid.NearestQuery(positions[i], 1);
+
+            if (nearest.isEmpty() || (grid.position(nearest.first()) - positions[i]).length() > MaxBondLength)
+            {
+                continue;
+            }
+
+            int donor = polar[nearest.first()];
+            donors += qMakePair(donor, hydrogens[i]);
+            HydrogensCount[donor] += 1;
+        }
+    }
+    else
+    {
+        // no hydrogens : every polar atom is a donor, the angle is not checked
+        for (auto AtomNumber : polar)
+        {
+            donors += qMakePair(AtomNumber, -1);
+        }
+    }
+
+    // acceptors : oxygens, and nitrogens without hydrogens (except the backbone amide)
+    for (auto AtomNumber : polar)
+    {
+        Atom atom = trajectory->atoms.value(AtomNumber);
+
+        if (atom.element == "O" || (HydrogensCount.value(AtomNumber) == 0 && atom.name != "N"))
+        {
+            acceptors += AtomNumber;
+        }
+    }
+}
+
+void HydrogenBonds::Compute(QVector<int> selection, float distance, float angle)
+{
+    this->distance = distance;
+    this->angle = angle;
+
+    bonds.clear();
+    FrameBonds.clear();
+
+    VertexIndices.clear();
+    if (!trajectory->models.isEmpty())
+    {
+        auto keys = trajectory->models.first().keys();
+        for (int i = 0; i < keys.size(); i++)
+        {
+            VertexIndices[keys[i]] = i;
+        }
+    }
+
+    SetDonorsAndAcceptors(selection);
+
+    int size = trajectory->models.size();
+
+    if (donors.isEmpty() || acceptors.isEmpty() || size == 0)
+    {
+        return;
+    }
+
+    QVector<int> DonorAtoms;
+    QVector<int> HydrogenAtoms;
+    for (auto donor : donors)
+    {
+        DonorAtoms += donor.first;
+        HydrogenAtoms += qMax(donor.second, donor.first);
+    }
+
+    bool hydrogens = (donors.first().second >= 0);
+    float MaxCosine = std::cos(qDegreesToRadians(angle));
+
+    // bonds of each frame as (donor index, acceptor index) couples
+    QVector<QVector<QPair<int, int>>> couples(size);
+    auto data = couples.data();
+
+    auto lambda = [&] (QPair<int, int> chunk)
+    {
+        NeighbourGrid grid;
+        grid.parallel = false;
+
+        for (int step = chunk.first; step < chunk.second; step++)
+        {
+            auto AcceptorPositions = trajectory->GetPositions(step, acceptors);
+
+            if (step == chunk.first)
+            {
+                grid.Build(AcceptorPositions, distance);
+            }
+            else
+            {
+                grid.Update(AcceptorPositions);
+            }
+
+            auto DonorPositions = trajectory->GetPositions(step, DonorAtoms);
+            auto HydrogenPositions = trajectory->GetPositions(step, HydrogenAtoms);
+
+            for (int i = 0; i < DonorAtoms.size(); i++)
+            {
+                QVector3D D = DonorPositions[i];
+                QVector3D H = HydrogenPositions[i];
+
+                for (auto j : grid.RadiusQuery(D, distance))
+                {
+                    if (acceptors[j] == DonorAtoms[i])
+                    {
+                        continue;
+                    }
+
+                    // donor-hydrogen-acceptor angle
+                    if (hydrogens)
+                    {
+                        QVector3D A = AcceptorPositions[j];
+                        QVector3D u = (D - H).normalized();
+                        QVector3D v = (A - H).normalized();
+
+                        if (QVector3D::dotProduct(u, v) > MaxCosine)
+                        {
+                            continue;
+                        }
+                    }
+
+                    data[step] += qMakePair(i, j);
+                }
+            }
+        }
+    };
+
+    auto chunks = GetChunks(size);
+    QtConcurrent::blockingMap(chunks, lambda);
+
+    // bonds ids in order of first appearance
+    // map : (donor index, acceptor index) -> bond index
+    QHash<quint64, int> ids;
+    QVector<int> counts;
+
+    FrameBonds.resize(size);
+
+    for (int step = 0; step < size; step++)
+    {
+        for (auto couple : couples[step])
+        {
+            quint64 key = (static_cast<quint64>(couple.first) << 32) | static_cast<quint64>(couple.second);
+
+            if (!ids.contains(key))
+            {
+                HydrogenBond bond;
+                bond.donor = donors[couple.first].first;
+                bond.hydrogen = donors[couple.first].second;
+                bond.acceptor = acceptors[couple.second];
+                bond.occupancy = 0;
+
+                ids[key] = bonds.size();
+                bonds += bond;
+                counts += 0;
+            }
+
+            int index = ids.value(key);
+            counts[index] += 1;
+            FrameBonds[step] += index;
+        }
+    }
+
+    for (int i = 0; i < bonds.size(); i++)
+    {
+        bonds[i].occupancy = counts[i] / static_cast<float>(size);
+    }
+}
+
+bool HydrogenBonds::isEmpty() const
+{
+    return FrameBonds.isEmpty();
+}
+
+QVector<unsigned int> HydrogenBonds::GetLineIndices(int step) const
+{
+    QVector<unsigned int> indices;
+
+    if (step < 0 || step >= FrameBonds.size())
+    {
+        return indices;
+    }
+
+    for (auto index : FrameBonds[step])
+    {
+        const HydrogenBond &bond = bonds[index];
+
+        // lines start from the hydrogen when known
+        int first = (bond.hydrogen >= 0) ? bond.hydrogen : bond.donor;
+
+        indices += static_cast<unsigned int>(VertexIndices.value(first));
+        indices += static_cast<unsigned int>(VertexIndices.value(bond.acceptor));
+    }
+
+    return indices;
+}
+
+void HydrogenBonds::Export(QString path) const
+{
+    QFile file(path);
+    assert(file.open(QIODevice::Text | QIODevice::WriteOnly));
+
+    QTextStream stream(&file);
+
+    stream << "DISTANCE " << distance << "\n";
+    stream << "ANGLE " << angle << "\n";
+    stream << "FRAMES " << FrameBonds.size() << "\n";
+
+    // most persistent bonds first
+    auto sorted = bonds;
+    auto lambda = [] (HydrogenBond a, HydrogenBond b) { return a.occupancy > b.occupancy; };
+    std::stable_sort(sorted.begin(), sorted.end(), lambda);
+
+    for (auto bond : sorted)
+    {
+        stream << "HBOND " << bond.donor << " " << bond.hydrogen << " " << bond.acceptor << " " << bond.occupancy << "\n";
+    }
+
+    file.close();
+}
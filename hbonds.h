@@ -0,0 +1,63 @@
+#ifndef HBONDS_H
+#define HBONDS_H
+
+#include <QHash>
+#include <QFile>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include "trajectory.h"
+#include "neighbourgrid.h"
+#include "utility.h"
+using namespace utility;
+
+struct HydrogenBond
+{
+    int donor;
+    int hydrogen; // -1 : no hydrogen atoms in the trajectory
+    int acceptor;
+    // fraction of frames the bond is formed in
+    float occupancy;
+};
+
+// geometric hydrogen bonds : donor-acceptor distance and donor-hydrogen-acceptor angle
+class HydrogenBonds
+{
+public:
+    HydrogenBonds(Trajectory *trajectory);
+
+    // donor-acceptor distance (in Angstrom)
+    float distance;
+    // min donor-hydrogen-acceptor angle (in degrees)
+    float angle;
+
+    // bonds formed in at least one frame
+    QVector<HydrogenBond> bonds;
+    // bonds indices formed in each frame
+    QVector<QVector<int>> FrameBonds;
+
+    // donors and acceptors are taken among the selection atoms
+    void Compute(QVector<int> selection, float distance, float angle);
+
+    bool isEmpty() const;
+
+    // vertex indices (atoms order of the models VAOs) of the bonds endpoints formed in step
+    QVector<unsigned int> GetLineIndices(int step) const;
+
+    // one "HBOND donor hydrogen acceptor occupancy" line per bond
+    void Export(QString path) const;
+
+private:
+    Trajectory *trajectory;
+
+    // map : atom number -> vertex index
+    QMap<int, int> VertexIndices;
+
+    // donor-hydrogen couples, from the first model
+    QVector<QPair<int, int>> donors;
+    QVector<int> acceptors;
+
+    void SetDonorsAndAcceptors(QVector<int> selection);
+};
+
+#endif // HBONDS_H
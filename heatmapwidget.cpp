@@ -0,0 +1,94 @@
+#include "heatmapwidget.h"
+
+HeatMapWidget::HeatMapWidget(QWidget *parent) : QWidget(parent)
+{
+    marker = -1;
+
+    setMinimumSize(160, 160);
+}
+
+void HeatMapWidget::SetMatrix(const Eigen::MatrixXf &matrix, float min, float max, bool diverging)
+{
+    if (matrix.size() == 0)
+    {
+        image = QImage();
+        update();
+        return;
+    }
+
+    image = QImage(static_cast<int>(matrix.cols()), static_cast<int>(matrix.rows()), QImage::Format_RGB32);
+
+    // sequential : the middle is moved to min
+    float middle = diverging ? 0.5f * (min + max) : min;
+    float span = (max > min) ? (diverging ? 0.5f : 1.0f) * (max - min) : 1;
+
+    for (int i = 0; i < matrix.rows(); i++)
+    {
+        auto line = reinterpret_cast<QRgb *>(image.scanLine(i));
+
+        for (int j = 0; j < matrix.cols(); j++)
+        {
+            float t = qBound(-1.0f, (matrix(i, j) - middle) / span, 1.0f);
+            int fade = static_cast<int>(255 * (1 - std::abs(t)));
+
+            line[j] = (t < 0) ? qRgb(fade, fade, 255) : qRgb(255, fade, fade);
+        }
+    }
+
+    update();
+}
+
+void HeatMapWidget::SetMarker(int index)
+{
+    marker = index;
+    update();
+}
+
+QRect HeatMapWidget::GetTarget() const
+{
+    // square, centered
+    int side = qMin(width(), height());
+    return QRect((width() - side) / 2, (height() - side) / 2, side, side);
+}
+
+void HeatMapWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::GlobalColor::black);
+
+    if (image.isNull())
+    {
+        return;
+    }
+
+    QRect target = GetTarget();
+    painter.drawImage(target, image);
+
+    // marker row and column
+    if (0 <= marker && marker < image.width())
+    {
+        float cell = target.width() / static_cast<float>(image.width());
+        int position = static_cast<int>((marker + 0.5f) * cell);
+
+        painter.setPen(QColor("#55ff7f"));
+        painter.drawLine(target.left() + position, target.top(), target.left() + position, target.bottom());
+        painter.drawLine(target.left(), target.top() + position, target.right(), target.top() + position);
+    }
+}
+
+void HeatMapWidget::mousePressEvent(QMouseEvent *event)
+{
+    QRect target = GetTarget();
+
+    if (image.isNull() || !target.contains(event->pos()))
+    {
+        return;
+    }
+
+    int column = (event->pos().x() - target.left()) * image.width() / target.width();
+    int row = (event->pos().y() - target.top()) * image.height() / target.height();
+
+    emit CellSignal(qBound(0, row, image.height() - 1), qBound(0, column, image.width() - 1));
+}
@@ -0,0 +1,42 @@
+#ifndef HEATMAPWIDGET_H
+#define HEATMAPWIDGET_H
+
+#include <QWidget>
+#include <QPainter>
+#include <QImage>
+#include <QMouseEvent>
+
+#include "utility.h"
+using namespace utility;
+
+// matrix drawn as a heat map (blue : min, white : middle, red : max),
+// or sequential (white : min, red : max) for densities,
+// with a cross marker on a row and column
+class HeatMapWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit HeatMapWidget(QWidget *parent = nullptr);
+
+    void SetMatrix(const Eigen::MatrixXf &matrix, float min, float max, bool diverging = true);
+    // -1 : no marker
+    void SetMarker(int index);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+
+private:
+    // one pixel per matrix cell, scaled on paint
+    QImage image;
+    int marker;
+
+    QRect GetTarget() const;
+
+signals:
+    // clicked cell
+    void CellSignal(int row, int column);
+};
+
+#endif // HEATMAPWIDGET_H
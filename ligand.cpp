@@ -0,0 +1,221 @@
+#include "ligand.h"
+
+LigandBinding::LigandBinding(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+    chain = "L";
+    cutoff = 4.5f;
+    MaxRMSD = 0;
+}
+
+void LigandBinding::Compute(QString chain, float cutoff)
+{
+    this->chain = chain;
+    this->cutoff = cutoff;
+
+    LigandResidues.clear();
+    ResidueIndices.clear();
+    ResidueNumbers.clear();
+    RMSDs.clear();
+    distances.clear();
+    occupancies.clear();
+    ResidenceTimes.clear();
+    MaxRMSD = 0;
+
+    auto ligand = trajectory->GetSelection(QString("chain %1").arg(chain));
+    auto protein = trajectory->GetSelection(QString("not chain %1").arg(chain));
+    auto backbone = trajectory->GetSelection(QString("backbone and not chain %1").arg(chain));
+
+    if (ligand.isEmpty() || protein.isEmpty() || backbone.size() < 3)
+    {
+        qDebug() << "no ligand (chain" << chain << ") or protein backbone";
+        return;
+    }
+
+    for (auto residue : trajectory->residues)
+    {
+        if (residue.chain == chain)
+        {
+            LigandResidues += residue.number;
+        }
+
+        ResidueIndices[residue.number] = ResidueNumbers.size();
+        ResidueNumbers += residue.number;
+    }
+
+    QVector<int> AtomResidues;
+    for (auto number : protein)
+    {
+        AtomResidues += ResidueIndices.value(trajectory->atoms.value(number).residue);
+    }
+
+    int frames = trajectory->models.size();
+    int size = ResidueNumbers.size();
+
+    // reference : backbone (centered) and ligand of the 1st model
+    auto ReferenceBackbone = trajectory->GetPositions(0, backbone);
+    QVector3D ReferenceCentroid = GetCentroid(ReferenceBackbone);
+
+    QVector<Eigen::Vector3f> a;
+    for (auto v : ReferenceBackbone)
+    {
+        a += FromQVector3DToVector3f(v - ReferenceCentroid);
+    }
+
+    QVector<Eigen::Vector3f> ReferenceLigand;
+    for (auto v : trajectory->GetPositions(0, ligand))
+    {
+        ReferenceLigand += FromQVector3DToVector3f(v);
+    }
+
+    RMSDs.fill(0, frames);
+    // residues without ligand atoms nearby keep an infinite distance
+    distances.fill(FLT_MAX, frames * size);
+
+    float *RMSDsData = RMSDs.data();
+    float *DistancesData = distances.data();
+
+    auto lambda = [&] (QPair<int, int> chunk)
+    {
+        NeighbourGrid grid;
+        grid.parallel = false;
+
+        for (int step = chunk.first; step < chunk.second; step++)
+        {
+            // protein backbone superposition on the reference
+            auto y = trajectory->GetPositions(step, backbone);
+            QVector3D c = GetCentroid(y);
+
+            QVector<Eigen::Vector3f> b;
+            for (auto v : y)
+            {
+                b += FromQVector3DToVector3f(v - c);
+            }
+
+            Eigen::Matrix3f R = trajectory->GetRotateMatrix(a, b);
+            Eigen::Vector3f t = FromQVector3DToVector3f(ReferenceCentroid);
+            Eigen::Vector3f s = FromQVector3DToVector3f(c);
+
+            // ligand RMSD in the protein frame
+            auto positions = trajectory->GetPositions(step, ligand);
+
+            float deviation = 0;
+            for (int i = 0; i < positions.size(); i++)
+            {
+                Eigen::Vector3f p = R * (FromQVector3DToVector3f(positions[i]) - s) + t;
+                deviation += (p - ReferenceLigand[i]).squaredNorm();
+            }
+            RMSDsData[step] = std::sqrt(deviation / positions.size());
+
+            // closest ligand atom of each protein atom (distances do not depend on the superposition)
+            grid.Build(positions, cutoff);
+
+            float *row = DistancesData + static_cast<qint64>(step) * size;
+
+            for (int i = 0; i < protein.size(); i++)
+            {
+                QVector3D p = trajectory->models.at(step).value(protein.at(i));
+                auto nearest = grid.NearestQuery(p, 1);
+
+                if (!nearest.isEmpty())
+                {
+                    float distance = p.distanceToPoint(grid.position(nearest.first()));
+                    float &value = row[AtomResidues.at(i)];
+                    value = qMin(value, distance);
+                }
+            }
+        }
+    };
+
+    auto chunks = GetChunks(frames);
+    QtConcurrent::blockingMap(chunks, lambda);
+
+    MaxRMSD = *std::max_element(RMSDs.begin(), RMSDs.end());
+
+    // contacts residence : occupancy and mean length of the contacts runs
+    occupancies.fill(0, size);
+    ResidenceTimes.fill(0, size);
+
+    for (int r = 0; r < size; r++)
+    {
+        int contacts = 0;
+        int runs = 0;
+        bool previous = false;
+
+        for (int step = 0; step < frames; step++)
+        {
+            bool contact = distances[step * size + r] <= cutoff;
+
+            contacts += contact;
+            runs += (contact && !previous);
+            previous = contact;
+        }
+
+        occupancies[r] = contacts / static_cast<float>(frames);
+        ResidenceTimes[r] = (runs > 0) ? contacts / static_cast<float>(runs) : 0;
+    }
+}
+
+bool LigandBinding::isEmpty() const
+{
+    return RMSDs.isEmpty();
+}
+
+bool LigandBinding::isLigand(int ResidueNumber) const
+{
+    return LigandResidues.contains(ResidueNumber);
+}
+
+float LigandBinding::GetDistance(int step, int ResidueNumber) const
+{
+    int index = ResidueIndices.value(ResidueNumber, -1);
+
+    if (isEmpty() || index < 0 || isLigand(ResidueNumber))
+    {
+        return NAN;
+    }
+
+    return distances.value(step * ResidueNumbers.size() + index, NAN);
+}
+
+float LigandBinding::GetOccupancy(int ResidueNumber) const
+{
+    int index = ResidueIndices.value(ResidueNumber, -1);
+    return (index < 0 || isLigand(ResidueNumber)) ? NAN : occupancies.value(index, NAN);
+}
+
+float LigandBinding::GetResidenceTime(int ResidueNumber) const
+{
+    int index = ResidueIndices.value(ResidueNumber, -1);
+    return (index < 0 || isLigand(ResidueNumber)) ? NAN : ResidenceTimes.value(index, NAN);
+}
+
+float LigandBinding::GetMaxResidenceTime() const
+{
+    return ResidenceTimes.isEmpty() ? 0 : *std::max_element(ResidenceTimes.begin(), ResidenceTimes.end());
+}
+
+void LigandBinding::Export(QString path) const
+{
+    QFile file(path);
+    assert(file.open(QIODevice::Text | QIODevice::WriteOnly));
+
+    QTextStream stream(&file);
+
+    stream << "LIGAND_RMSD";
+    for (auto value : RMSDs)
+    {
+        stream << " " << value;
+    }
+    stream << "\n";
+
+    for (int r = 0; r < ResidueNumbers.size(); r++)
+    {
+        if (occupancies[r] > 0 && !isLigand(ResidueNumbers[r]))
+        {
+            stream << "RESIDENCE " << ResidueNumbers[r] << " " << occupancies[r] << " " << ResidenceTimes[r] << "\n";
+        }
+    }
+
+    file.close();
+}
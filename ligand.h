@@ -0,0 +1,64 @@
+#ifndef LIGAND_H
+#define LIGAND_H
+
+#include <QFile>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include <Eigen/Dense>
+
+#include "trajectory.h"
+#include "neighbourgrid.h"
+#include "utility.h"
+using namespace utility;
+
+// ligand binding : every frame is superposed on the 1st model by the protein backbone,
+// then the ligand RMSD, the closest ligand atom distance of each residue
+// and the ligand-residue contacts residence are computed
+class LigandBinding
+{
+public:
+    LigandBinding(Trajectory *trajectory);
+
+    // ligand chain identifier
+    QString chain;
+    // contact distance (in Angstrom)
+    float cutoff;
+
+    // ligand residues numbers
+    QVector<int> LigandResidues;
+
+    // ligand RMSD (in Angstrom) of each frame, without ligand refitting
+    QVector<float> RMSDs;
+    float MaxRMSD;
+
+    void Compute(QString chain = "L", float cutoff = 4.5f);
+
+    bool isEmpty() const;
+    bool isLigand(int ResidueNumber) const;
+
+    // distance (in Angstrom) between a residue and its closest ligand atom in step
+    float GetDistance(int step, int ResidueNumber) const;
+    // fraction of frames with the residue in contact
+    float GetOccupancy(int ResidueNumber) const;
+    // mean length (in frames) of the uninterrupted contacts of the residue
+    float GetResidenceTime(int ResidueNumber) const;
+    float GetMaxResidenceTime() const;
+
+    // "LIGAND_RMSD value value ..." then one "RESIDENCE residue occupancy time" line per contacting residue
+    void Export(QString path) const;
+
+private:
+    Trajectory *trajectory;
+
+    // map : residue number -> residue index
+    QMap<int, int> ResidueIndices;
+    QVector<int> ResidueNumbers;
+
+    // frames x residues
+    QVector<float> distances;
+    QVector<float> occupancies;
+    QVector<float> ResidenceTimes;
+};
+
+#endif // LIGAND_H
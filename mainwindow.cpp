@@ -13,6 +13,9 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
 
 MainWindow::~MainWindow()
 {
+    // frames index builds still running read the trajectory
+    QThreadPool::globalInstance()->waitForDone();
+
     delete ui;
 }
 
@@ -23,11 +26,29 @@ void MainWindow::InitUI()
     AtomGroup();
     ResidueGroup();
     TrajectoryGroup();
+    ReferenceGroup();
+    SmoothingGroup();
 
     OutlineGroup();
     // progress();
     playback();
+    FrameSearchGroup();
     framerate();
+    ObservableGroup();
+
+    ClusterTab();
+    ContactTab();
+    HydrogenBondTab();
+    SurfaceTab();
+    ObservableTab();
+    PrincipalComponentTab();
+    CrossCorrelationTab();
+    LigandTab();
+    NormalModeTab();
+    RadialDistributionTab();
+    DihedralTab();
+    ElectrostaticsTab();
+    DensityTab();
 
     SSAOTab();
     LightTab();
@@ -130,7 +151,8 @@ void MainWindow::AtomGroup()
             labels += ui->AtomRMSF;
 
             auto element = ChemicalElements[atom.element];
-            auto RMSD = atom.RMSDs[gl->playback.step];
+            // stored, derived (compact RMSDs) or missing (online statistics mode) RMSDs history
+            auto RMSD = gl->trajectory.GetAtomRMSD(gl->playback.step, atom.number);
 
             int precision = 7;
             int width = precision + 3;
@@ -204,7 +226,7 @@ void MainWindow::ResidueGroup()
             auto residue = gl->trajectory.residues[atom.residue];
 
             auto aminoacid = AminoAcids[residue.name];
-            auto RMSD = residue.RMSDs[gl->playback.step];
+            auto RMSD = residue.RMSDs.isEmpty() ? NAN : residue.RMSDs[gl->playback.step];
 
             int precision = 7;
             int width = precision + 3;
@@ -283,6 +305,200 @@ void MainWindow::TrajectoryGroup()
     }
 }
 
+void MainWindow::ReferenceGroup()
+{
+    auto combobox = ui->ReferenceComboBox;
+
+    combobox->setCurrentIndex(gl->trajectory.AverageReference ? 1 : 0);
+
+    auto lambda = [=] (int index)
+    {
+        // RMSD and RMSF against the new reference
+        gl->SetStatisticsParameters(index == 1, gl->trajectory.CompactRMSDs, gl->trajectory.OnlineStatistics);
+        gl->analyses.Require("statistics");
+
+        TrajectoryGroup();
+        gl->SetOutlineColor();
+    };
+    connect(combobox, QOverload<int>::of(&QComboBox::currentIndexChanged), lambda);
+
+    // compact RMSDs checkbox
+    {
+        auto checkbox = ui->CompactRMSDsCheckBox;
+        checkbox->setChecked(gl->trajectory.CompactRMSDs);
+
+        auto lambda = [=] (int state)
+        {
+            // residues superpositions instead of the atoms RMSDs histories
+            gl->SetStatisticsParameters(gl->trajectory.AverageReference, state == Qt::Checked, gl->trajectory.OnlineStatistics);
+            gl->analyses.Require("statistics");
+
+            TrajectoryGroup();
+            gl->SetOutlineColor();
+        };
+        connect(checkbox, &QCheckBox::stateChanged, lambda);
+    }
+
+    // online statistics checkbox
+    {
+        auto checkbox = ui->OnlineStatisticsCheckBox;
+        checkbox->setChecked(gl->trajectory.OnlineStatistics);
+
+        auto lambda = [=] (int state)
+        {
+            // streaming Min, Max RMSD and RMSF, the RMSDs histories are not kept
+            gl->SetStatisticsParameters(gl->trajectory.AverageReference, gl->trajectory.CompactRMSDs, state == Qt::Checked);
+            gl->analyses.Require("statistics");
+
+            TrajectoryGroup();
+            gl->SetOutlineColor();
+        };
+        connect(checkbox, &QCheckBox::stateChanged, lambda);
+    }
+}
+
+void MainWindow::SmoothingGroup()
+{
+    auto combobox = ui->SmoothingComboBox;
+    auto spinbox = ui->SmoothingWindowSpinBox;
+
+    combobox->setCurrentIndex(gl->trajectory.smoothing);
+    spinbox->setValue(gl->trajectory.SmoothingWindow);
+
+    auto lambda = [=] ()
+    {
+        // odd window, centered on the smoothed model
+        int window = spinbox->value() | 1;
+        gl->trajectory.SetSmoothing(static_cast<SmoothingFilter>(combobox->currentIndex()), window);
+
+        // every analysis is out of date, the statistics and observables on display are recomputed now,
+        // the other products when next used (the tabs clear or recompute what they show)
+        gl->analyses.Invalidate("models");
+        gl->analyses.Require("statistics");
+        gl->analyses.Require("observables");
+        emit gl->ModelsChangedSignal();
+
+        // the rendered models follow
+        gl->makeCurrent();
+        gl->SetModelVAOs();
+        gl->doneCurrent();
+
+        TrajectoryGroup();
+        gl->SetOutlineColor();
+
+        BuildFrameIndex();
+    };
+    connect(combobox, QOverload<int>::of(&QComboBox::currentIndexChanged), lambda);
+    connect(spinbox, &QSpinBox::editingFinished, lambda);
+}
+
+void MainWindow::FrameSearchGroup()
+{
+    auto combobox = ui->SimilarFramesComboBox;
+    auto slider = ui->StepSlider;
+
+    // index built : swapped in
+    {
+        auto lambda = [=] ()
+        {
+            auto result = FrameIndexWatcher.result();
+
+            // built over models replaced since
+            if (result.first != FrameIndexGeneration)
+            {
+                return;
+            }
+
+            gl->neighbours = result.second;
+            UpdateFrameTargets();
+        };
+        connect(&FrameIndexWatcher, &QFutureWatcher<QPair<int, FrameIndex>>::finished, this, lambda);
+    }
+
+    // step changed
+    {
+        auto lambda = [=] (int)
+        {
+            UpdateFrameTargets();
+        };
+        connect(slider, &QSlider::valueChanged, lambda);
+    }
+
+    // target activated : jump to frame
+    {
+        auto lambda = [=] (int index)
+        {
+            int step = combobox->itemData(index).toInt();
+
+            if (step >= 0)
+            {
+                slider->setSliderPosition(step);
+            }
+        };
+        connect(combobox, QOverload<int>::of(&QComboBox::activated), lambda);
+    }
+
+    BuildFrameIndex();
+}
+
+void MainWindow::BuildFrameIndex()
+{
+    // a running build is not waited for, its result is dropped
+    FrameIndexGeneration += 1;
+    int generation = FrameIndexGeneration;
+
+    // no targets from the previous models meanwhile
+    gl->neighbours = FrameIndex(&gl->trajectory);
+    UpdateFrameTargets();
+
+    // the models are implicitly shared : the snapshot holds while the models are replaced
+    auto selection = gl->trajectory.GetSelection("name CA");
+    auto models = gl->trajectory.models;
+    Trajectory *trajectory = &gl->trajectory;
+
+    auto lambda = [=] ()
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        auto conformations = Trajectory::GetConformations(models, selection);
+
+        FrameIndex index(trajectory);
+        index.Build(conformations);
+
+        qDebug() << "frames index" << conformations.size() << "frames" << timer.elapsed() << "ms";
+
+        return qMakePair(generation, index);
+    };
+
+    FrameIndexWatcher.setFuture(QtConcurrent::run(lambda));
+}
+
+void MainWindow::UpdateFrameTargets()
+{
+    auto combobox = ui->SimilarFramesComboBox;
+
+    combobox->blockSignals(true);
+    combobox->clear();
+
+    if (gl->neighbours.isEmpty())
+    {
+        combobox->addItem("similar frames...", -1);
+    }
+    else
+    {
+        auto nearest = gl->neighbours.GetNearest(gl->playback.step, 5, 10);
+
+        combobox->addItem(QString("%1 similar frames").arg(nearest.size()), -1);
+        for (auto pair : nearest)
+        {
+            combobox->addItem(QString("%1 : %2 A").arg(pair.first + 1).arg(pair.second, 0, 'f', 2), pair.first);
+        }
+    }
+
+    combobox->blockSignals(false);
+}
+
 void MainWindow::OutlineGroup()
 {
     // outline checkbox
@@ -366,11 +582,24 @@ void MainWindow::OutlineGroup()
         modes["Residue RMSD"] = OutlineMode::RESIDUE_RMSD;
         modes["Atom RMSF"] = OutlineMode::ATOM_RMSF;
         modes["Atom RMSD"] = OutlineMode::ATOM_RMSD;
+        modes["Residue window RMSF"] = OutlineMode::RESIDUE_WINDOW_RMSF;
+        modes["Atom window RMSF"] = OutlineMode::ATOM_WINDOW_RMSF;
+        modes["Residue contacts"] = OutlineMode::RESIDUE_CONTACTS;
+        modes["Residue secondary structure"] = OutlineMode::RESIDUE_SECONDARY_STRUCTURE;
+        modes["Residue SASA"] = OutlineMode::RESIDUE_SASA;
+        modes["Residue cross-correlation"] = OutlineMode::RESIDUE_CROSS_CORRELATION;
+        modes["Residue ligand distance"] = OutlineMode::RESIDUE_LIGAND_DISTANCE;
+        modes["Residue ligand residence"] = OutlineMode::RESIDUE_LIGAND_RESIDENCE;
+        modes["Residue dihedral"] = OutlineMode::RESIDUE_DIHEDRAL;
+        modes["Residue dihedral window variance"] = OutlineMode::RESIDUE_DIHEDRAL_VARIANCE;
+        modes["Residue Coulomb potential"] = OutlineMode::RESIDUE_POTENTIAL;
+        modes["Atom Coulomb potential"] = OutlineMode::ATOM_POTENTIAL;
 
         combobox->setCurrentText(modes.key(gl->outline.mode));
 
         auto lambda = [=] (const QString &text)
         {
+            // the product behind the mode is computed on first use
             gl->outline.mode = modes[text];
             gl->SetOutlineColor();
         };
@@ -440,6 +669,23 @@ void MainWindow::OutlineGroup()
         connect(combobox, &QComboBox::currentTextChanged, lambda);
     }
 
+    // sliding window size
+    {
+        auto spinbox = ui->OutlineWindowSpinBox;
+
+        spinbox->setMinimum(1);
+        spinbox->setMaximum(qMax(1, gl->playback.size));
+        spinbox->setValue(gl->outline.window);
+
+        // the window RMSF comes from prefix sums : no trajectory rescan
+        auto lambda = [=] (int value)
+        {
+            gl->outline.window = value;
+            gl->SetOutlineColor();
+        };
+        connect(spinbox, QOverload<int>::of(&QSpinBox::valueChanged), lambda);
+    }
+
     // Thickness Slider
     {
         auto slider = ui->ThicknessSlider;
@@ -754,16 +1000,14 @@ void MainWindow::OutlineGroup()
                 }
                 else
                 {
-                    switch (gl->outline.mode)
+                    switch (GetOutlineLevel(gl->outline.mode))
                     {
-                    case RESIDUE_RMSF:
-                    case RESIDUE_RMSD:
+                    case RESIDUE_LEVEL:
                     {
                         number = atom.residue;
                         break;
                     }
-                    case ATOM_RMSF:
-                    case ATOM_RMSD:
+                    case ATOM_LEVEL:
                     {
                         number = atom.number;
                         break;
@@ -990,7 +1234,7 @@ void MainWindow::playback()
         auto lambda = [=] ()
         {
             // update step
-            gl->playback.step = (gl->playback.step == 0) ? (gl->playback.size - 1) : (gl->playback.step - 1);
+            gl->playback.step = GetNextStep(gl->playback, -1);
             // update slider
             slider->setSliderPosition(gl->playback.step);
             /*
@@ -1013,7 +1257,7 @@ void MainWindow::playback()
         auto lambda = [=] ()
         {
             // update step
-            gl->playback.step = (gl->playback.step + 1) % gl->playback.size;
+            gl->playback.step = GetNextStep(gl->playback, +1);
             // update slider
             slider->setSliderPosition(gl->playback.step);
             /*
@@ -1028,137 +1272,1331 @@ void MainWindow::playback()
     }
 }
 
-void MainWindow::ColorLerp()
+void MainWindow::ClusterTab()
 {
-    QColor albedo = Qt::GlobalColor::red;
-
-    auto label = ui->ColorLerpLabel;
-
-    auto slider = ui->ColorLerpSlider;
-    float size = 10;
-    slider->setMinimum(-size);
-    slider->setMaximum(+size);
-    slider->setSliderPosition(0);
+    auto method = ui->ClusterMethodComboBox;
+    auto parameter = ui->ClusterParameterSpinBox;
+    auto combobox = ui->ClusterComboBox;
+    auto checkbox = ui->ClusterPlaybackCheckbox;
+    auto slider = ui->StepSlider;
 
-    auto lerp = [] (float a, float b, float t)
+    // method : the parameter is the cutoff (GROMOS) or the number of clusters (k-medoids)
     {
-        t = qBound(0.0f, t, 1.0f);
-        return a * (1 - t) + b * t;
-    };
+        auto lambda = [=] (const QString &text)
+        {
+            if (text == "GROMOS")
+            {
+                parameter->setDecimals(2);
+                parameter->setRange(0.01, 100.0);
+                parameter->setSingleStep(0.1);
+                parameter->setValue(1.5);
+                parameter->setSuffix(" A");
+            }
+            else
+            {
+                parameter->setDecimals(0);
+                parameter->setRange(1, qMax(1, gl->playback.size));
+                parameter->setSingleStep(1);
+                parameter->setValue(qMin(5, gl->playback.size));
+                parameter->setSuffix(QString());
+            }
+        };
+        connect(method, &QComboBox::currentTextChanged, lambda);
 
-    auto LerpQColor = [=] (QColor a, QColor b, float t)
-    {
-        QColor c;
-        c.setRedF(lerp(a.redF(), b.redF(), t));
-        c.setGreenF(lerp(a.greenF(), b.greenF(), t));
-        c.setBlueF(lerp(a.blueF(), b.blueF(), t));
-        return c;
-    };
+        lambda(method->currentText());
+    }
 
-    auto lambda = [=] (int value)
+    // cluster button
     {
-        QColor colour = albedo;
+        auto button = ui->ClusterButton;
 
-        if (value < 0)
+        auto lambda = [=] ()
         {
-            float t = (size + value) / size;
-            colour = LerpQColor(Qt::GlobalColor::black, albedo, t);
-        }
+            auto selection = gl->trajectory.GetSelection(ui->ClusterSelectionLineEdit->text());
 
-        if (value > 0)
-        {
-            float t = (size - value) / size;
-            colour = LerpQColor(Qt::GlobalColor::white, albedo, t);
-        }
+            if (selection.isEmpty())
+            {
+                qDebug() << "empty selection";
+                return;
+            }
 
-        QStringList rules;
-        rules += QString("background-color: %1").arg(colour.name());
-        label->setStyleSheet(rules.join("; "));
+            // memoized : clustered again only for new parameters or new models
+            QString name = method->currentText();
+            double value = parameter->value();
 
-        label->setText(colour.name());
-    };
-    connect(slider, &QSlider::valueChanged, lambda);
+            auto compute = [=] ()
+            {
+                gl->clustering.SetSelection(selection);
 
-}
+                if (name == "GROMOS")
+                {
+                    gl->clustering.GROMOS(static_cast<float>(value));
+                }
+                else
+                {
+                    gl->clustering.KMedoids(static_cast<int>(value));
+                }
+            };
 
-void MainWindow::SSAOTab()
-{
-    // active checkbox
-    {
-        auto checkbox = ui->SSAOActive;
-        checkbox->setChecked(gl->SSAO.active);
+            QString key = QString("%1;%2;%3").arg(ui->ClusterSelectionLineEdit->text()).arg(name).arg(value);
+            gl->analyses.SetParameters("clustering", key, compute);
+            gl->analyses.Require("clustering");
 
-        auto lambda = [=] (int state)
+            // fill clusters combobox
+            combobox->blockSignals(true);
+            combobox->clear();
+            combobox->addItem("all frames");
+            for (auto cluster : gl->clustering.clusters)
+            {
+                QString text = QString("#%1 : %2 frames (%3)").arg(cluster.number).arg(cluster.frames.size()).arg(cluster.representative + 1);
+                combobox->addItem(text);
+            }
+            combobox->blockSignals(false);
+
+            checkbox->setChecked(false);
+            gl->playback.order.clear();
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+
+    // clusters combobox : jump to representative
+    {
+        auto lambda = [=] (int index)
         {
-            // update value
-            gl->SSAO.active = (state == Qt::Checked);
+            if (index <= 0)
+            {
+                return;
+            }
+
+            auto cluster = gl->clustering.clusters[index - 1];
+            gl->playback.step = cluster.representative;
+            slider->setSliderPosition(gl->playback.step);
         };
-        connect(checkbox, &QCheckBox::stateChanged, lambda);
+        connect(combobox, QOverload<int>::of(&QComboBox::currentIndexChanged), lambda);
     }
 
-    // blur checkbox
+    // previous and next cluster buttons
     {
-        auto checkbox = ui->SSAOBlur;
-        checkbox->setChecked(gl->SSAO.blur);
+        auto lambda = [=] (int increment)
+        {
+            int size = combobox->count() - 1;
 
-        qDebug() << checkbox;
+            if (size <= 0)
+            {
+                return;
+            }
+
+            int index = qMax(combobox->currentIndex(), 1) - 1;
+            index = (index + size + increment) % size;
+            combobox->setCurrentIndex(index + 1);
+        };
+        connect(ui->PreviousClusterButton, &QPushButton::clicked, [=] () { lambda(-1); });
+        connect(ui->NextClusterButton, &QPushButton::clicked, [=] () { lambda(+1); });
+    }
 
+    // play cluster by cluster
+    {
         auto lambda = [=] (int state)
         {
-            // update value
-            gl->SSAO.blur = (state == Qt::Checked);
+            if (state == Qt::Checked)
+            {
+                gl->playback.order = gl->clustering.GetPlaybackOrder();
+            }
+            else
+            {
+                gl->playback.order.clear();
+            }
         };
         connect(checkbox, &QCheckBox::stateChanged, lambda);
     }
 
-    // kernel size
+    // models changed : the clusters are cleared until clustered again
     {
-        int size = gl->SSAO.KernelSize;
-
-        auto label = ui->SSAOKernelSizeLabel;
-        QString caption = label->text().split(" :").first();
-        label->setText(QString("%1 : %2").arg(caption).arg(size, 2));
+        auto lambda = [=] ()
+        {
+            combobox->blockSignals(true);
+            combobox->clear();
+            combobox->addItem("all frames");
+            combobox->blockSignals(false);
 
-        auto slider = ui->SSAOKernelSizeSlider;
-        slider->setMinimum(1);
-        slider->setMaximum(30);
+            checkbox->setChecked(false);
+        };
+        connect(gl, &OpenGLWidget::ModelsChangedSignal, this, lambda);
+    }
+}
 
-        // update value
-        slider->setSliderPosition(size);
+void MainWindow::ContactTab()
+{
+    // compute button
+    {
+        auto button = ui->ContactButton;
 
-        // value changed event
-        auto lambda = [=] (int value)
+        auto lambda = [=] ()
         {
-            // update value
-            gl->SSAO.KernelSize = value;
-            gl->SSAO.SetKernel();
-            // gl->KernelTextureFlag = true;
-            // update label
-            QString caption = label->text().split(" :").first();
-            label->setText(QString("%1 : %2").arg(caption).arg(value, 2));
+            auto selection = gl->trajectory.GetSelection(ui->ContactSelectionLineEdit->text());
+
+            if (selection.isEmpty())
+            {
+                qDebug() << "empty selection";
+                return;
+            }
+
+            float cutoff = static_cast<float>(ui->ContactCutoffSpinBox->value());
+
+            QString key = QString("%1;%2").arg(ui->ContactSelectionLineEdit->text()).arg(cutoff);
+            gl->analyses.SetParameters("contacts", key, [=] () { gl->contacts.Compute(selection, cutoff); });
+            gl->analyses.Require("contacts");
+
+            gl->SetOutlineColor();
         };
-        connect(slider, &QSlider::valueChanged, lambda);
+        connect(button, &QPushButton::clicked, lambda);
     }
 
-    // noise size
+    // reference residue
     {
-        int size = gl->SSAO.NoiseSize;
-
-        auto label = ui->SSAONoiseSizeLabel;
-        QString caption = label->text().split(" :").first();
-        label->setText(QString("%1 : %2").arg(caption).arg(size, 2));
+        auto spinbox = ui->ContactReferenceSpinBox;
 
-        auto slider = ui->SSAONoiseSizeSlider;
-        slider->setMinimum(1);
-        slider->setMaximum(30);
-
-        // update value
-        slider->setSliderPosition(size * 0.5f);
+        auto list = gl->trajectory.residues.keys();
+        spinbox->setRange(0, list.isEmpty() ? 0 : *std::max_element(list.begin(), list.end()));
+        spinbox->setValue(gl->outline.reference);
 
-        // value changed event
         auto lambda = [=] (int value)
         {
-            int w = gl->geometry().width();
+            gl->outline.reference = value;
+            gl->SetOutlineColor();
+        };
+        connect(spinbox, QOverload<int>::of(&QSpinBox::valueChanged), lambda);
+    }
+
+    // export button
+    {
+        auto button = ui->ContactExportButton;
+
+        auto lambda = [=] ()
+        {
+            if (gl->contacts.isEmpty())
+            {
+                qDebug() << "empty contact map";
+                return;
+            }
+
+            gl->contacts.Export("../../contacts.txt");
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+}
+
+void MainWindow::HydrogenBondTab()
+{
+    // compute button
+    {
+        auto button = ui->HydrogenBondButton;
+
+        auto lambda = [=] ()
+        {
+            auto selection = gl->trajectory.GetSelection(ui->HydrogenBondSelectionLineEdit->text());
+
+            if (selection.isEmpty())
+            {
+                qDebug() << "empty selection";
+                return;
+            }
+
+            float distance = static_cast<float>(ui->HydrogenBondDistanceSpinBox->value());
+            float angle = static_cast<float>(ui->HydrogenBondAngleSpinBox->value());
+
+            QString key = QString("%1;%2;%3").arg(ui->HydrogenBondSelectionLineEdit->text()).arg(distance).arg(angle);
+            gl->analyses.SetParameters("hbonds", key, [=] () { gl->hbonds.Compute(selection, distance, angle); });
+            gl->analyses.Require("hbonds");
+
+            qDebug() << "hydrogen bonds" << gl->hbonds.bonds.size();
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+
+    // show bonds
+    {
+        auto checkbox = ui->HydrogenBondCheckbox;
+        checkbox->setChecked(gl->HydrogenBondsVisible);
+
+        auto lambda = [=] (int state)
+        {
+            gl->HydrogenBondsVisible = (state == Qt::Checked);
+
+            // recomputed with the last parameters when the models changed since
+            if (gl->HydrogenBondsVisible)
+            {
+                gl->analyses.Require("hbonds");
+            }
+        };
+        connect(checkbox, &QCheckBox::stateChanged, lambda);
+    }
+
+    // models changed : the bonds on display follow
+    {
+        auto lambda = [=] ()
+        {
+            if (gl->HydrogenBondsVisible)
+            {
+                gl->analyses.Require("hbonds");
+            }
+        };
+        connect(gl, &OpenGLWidget::ModelsChangedSignal, this, lambda);
+    }
+
+    // show covalent bonds, perceived on first use
+    {
+        auto checkbox = ui->CovalentBondCheckbox;
+        checkbox->setChecked(gl->BondsVisible);
+
+        auto lambda = [=] (int state)
+        {
+            gl->BondsVisible = (state == Qt::Checked);
+
+            if (gl->BondsVisible)
+            {
+                gl->analyses.Require("bonds");
+            }
+        };
+        connect(checkbox, &QCheckBox::stateChanged, lambda);
+    }
+
+    // export button
+    {
+        auto button = ui->HydrogenBondExportButton;
+
+        auto lambda = [=] ()
+        {
+            if (gl->hbonds.isEmpty())
+            {
+                qDebug() << "no hydrogen bonds";
+                return;
+            }
+
+            gl->hbonds.Export("../../hbonds.txt");
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+}
+
+void MainWindow::SurfaceTab()
+{
+    // compute button
+    {
+        auto button = ui->SurfaceButton;
+
+        auto lambda = [=] ()
+        {
+            float probe = static_cast<float>(ui->SurfaceProbeSpinBox->value());
+            int points = ui->SurfacePointsSpinBox->value();
+
+            QString key = QString("%1;%2").arg(probe).arg(points);
+            gl->analyses.SetParameters("surface", key, [=] () { gl->surface.Compute(probe, points); });
+            gl->analyses.Require("surface");
+
+            gl->SetOutlineColor();
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+
+    // export button
+    {
+        auto button = ui->SurfaceExportButton;
+
+        auto lambda = [=] ()
+        {
+            if (gl->surface.isEmpty())
+            {
+                qDebug() << "empty SASA";
+                return;
+            }
+
+            gl->surface.Export("../../sasa.txt");
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+}
+
+void MainWindow::ObservableGroup()
+{
+    auto combobox = ui->ObservableComboBox;
+    auto plot = ui->ObservablePlot;
+    auto label = ui->ObservableValueLabel;
+    auto slider = ui->StepSlider;
+
+    auto UpdateLabel = [=] ()
+    {
+        int index = combobox->currentIndex();
+
+        if (index < 0 || index >= gl->trajectory.observables.size())
+        {
+            label->setText(QString());
+            return;
+        }
+
+        auto observable = gl->trajectory.observables[index];
+        float value = observable.values.value(gl->playback.step, NAN);
+        label->setText(QString("%1 A").arg(value, 8, 'f', 3));
+    };
+
+    // observable combobox
+    {
+        auto lambda = [=] (int index)
+        {
+            if (index < 0 || index >= gl->trajectory.observables.size())
+            {
+                plot->SetValues(QVector<float>(), 0, 0);
+                UpdateLabel();
+                return;
+            }
+
+            auto observable = gl->trajectory.observables[index];
+            plot->SetValues(observable.values, observable.MinValue, observable.MaxValue);
+            plot->SetStep(gl->playback.step);
+            UpdateLabel();
+        };
+        connect(combobox, QOverload<int>::of(&QComboBox::currentIndexChanged), lambda);
+    }
+
+    // step changed
+    {
+        auto lambda = [=] (int value)
+        {
+            plot->SetStep(value);
+            UpdateLabel();
+        };
+        connect(slider, &QSlider::valueChanged, lambda);
+    }
+
+    // plot clicked : jump to step
+    {
+        auto lambda = [=] (int step)
+        {
+            slider->setSliderPosition(step);
+        };
+        connect(plot, &TimeSeriesWidget::StepSignal, lambda);
+    }
+
+    UpdateObservables();
+}
+
+void MainWindow::UpdateObservables()
+{
+    auto combobox = ui->ObservableComboBox;
+    int index = combobox->currentIndex();
+
+    combobox->blockSignals(true);
+    combobox->clear();
+    for (auto observable : gl->trajectory.observables)
+    {
+        combobox->addItem(observable.name);
+    }
+    combobox->blockSignals(false);
+
+    index = qBound(0, index, combobox->count() - 1);
+    combobox->setCurrentIndex(-1);
+    combobox->setCurrentIndex(index);
+}
+
+void MainWindow::ObservableTab()
+{
+    auto type = ui->ObservableTypeComboBox;
+    auto second = ui->ObservableSecondLineEdit;
+
+    // type : the radius of gyration needs one group only
+    {
+        auto lambda = [=] (const QString &text)
+        {
+            second->setEnabled(text != "Radius of gyration");
+        };
+        connect(type, &QComboBox::currentTextChanged, lambda);
+
+        lambda(type->currentText());
+    }
+
+    // add button
+    {
+        auto button = ui->ObservableAddButton;
+
+        QMap<QString, ObservableType> types;
+        types["Radius of gyration"] = ObservableType::RADIUS_OF_GYRATION;
+        types["Centroids distance"] = ObservableType::CENTROIDS_DISTANCE;
+        types["Min distance"] = ObservableType::MIN_DISTANCE;
+
+        auto lambda = [=] ()
+        {
+            ObservableType t = types[type->currentText()];
+
+            QVector<QVector<int>> groups;
+            groups += gl->trajectory.GetSelection(ui->ObservableFirstLineEdit->text());
+            if (t != RADIUS_OF_GYRATION)
+            {
+                groups += gl->trajectory.GetSelection(second->text());
+            }
+
+            for (auto group : groups)
+            {
+                if (group.isEmpty())
+                {
+                    qDebug() << "empty selection";
+                    return;
+                }
+            }
+
+            QString name = ui->ObservableNameLineEdit->text().trimmed();
+            if (name.isEmpty())
+            {
+                name = QString("%1 #%2").arg(type->currentText()).arg(gl->trajectory.observables.size() + 1);
+            }
+
+            gl->trajectory.AddObservable(name, t, groups);
+            gl->analyses.Invalidate("observables");
+            gl->analyses.Require("observables");
+
+            UpdateObservables();
+            ui->ObservableComboBox->setCurrentIndex(gl->trajectory.observables.size() - 1);
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+}
+
+void MainWindow::PrincipalComponentTab()
+{
+    auto combobox = ui->PrincipalComponentComboBox;
+    auto plot = ui->PrincipalComponentPlot;
+    auto slider = ui->StepSlider;
+
+    // compute button
+    {
+        auto button = ui->PrincipalComponentButton;
+
+        auto lambda = [=] ()
+        {
+            auto selection = gl->trajectory.GetSelection(ui->PrincipalComponentSelectionLineEdit->text());
+
+            if (selection.isEmpty())
+            {
+                qDebug() << "empty selection";
+                return;
+            }
+
+            int components = ui->PrincipalComponentNumberSpinBox->value();
+
+            QString key = QString("%1;%2").arg(ui->PrincipalComponentSelectionLineEdit->text()).arg(components);
+            gl->analyses.SetParameters("pca", key, [=] () { gl->pca.Compute(selection, components); });
+            gl->analyses.Require("pca");
+
+            combobox->blockSignals(true);
+            combobox->clear();
+            for (int i = 0; i < gl->pca.variances.size(); i++)
+            {
+                combobox->addItem(QString("PC %1 : %2 % variance").arg(i + 1).arg(100.0f * gl->pca.GetExplainedVariance(i), 0, 'f', 1));
+            }
+            combobox->blockSignals(false);
+
+            combobox->setCurrentIndex(-1);
+            combobox->setCurrentIndex(0);
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+
+    // mode combobox
+    {
+        auto lambda = [=] (int index)
+        {
+            if (index < 0 || gl->pca.isEmpty())
+            {
+                plot->SetValues(QVector<float>(), 0, 0);
+                return;
+            }
+
+            auto values = gl->pca.GetProjection(index);
+            auto minmax = std::minmax_element(values.begin(), values.end());
+            plot->SetValues(values, *minmax.first, *minmax.second);
+            plot->SetStep(gl->playback.step);
+
+            if (gl->animation.source == PRINCIPAL_COMPONENTS)
+            {
+                gl->animation.mode = index;
+                gl->animation.UpdateFlag = true;
+            }
+        };
+        connect(combobox, QOverload<int>::of(&QComboBox::currentIndexChanged), lambda);
+    }
+
+    // step changed
+    {
+        auto lambda = [=] (int value)
+        {
+            plot->SetStep(value);
+        };
+        connect(slider, &QSlider::valueChanged, lambda);
+    }
+
+    // plot clicked : jump to step
+    {
+        auto lambda = [=] (int step)
+        {
+            slider->setSliderPosition(step);
+        };
+        connect(plot, &TimeSeriesWidget::StepSignal, lambda);
+    }
+
+    // animation checkbox
+    {
+        auto checkbox = ui->PrincipalComponentAnimationCheckBox;
+
+        auto lambda = [=] (int state)
+        {
+            if (state == Qt::Checked)
+            {
+                gl->animation.source = PRINCIPAL_COMPONENTS;
+                gl->animation.mode = qMax(0, combobox->currentIndex());
+                gl->animation.active = !gl->pca.isEmpty() && gl->analyses.isValid("pca");
+            }
+            else if (gl->animation.source == PRINCIPAL_COMPONENTS)
+            {
+                gl->animation.active = false;
+            }
+            gl->animation.UpdateFlag = true;
+            gl->animation.time.restart();
+        };
+        connect(checkbox, &QCheckBox::stateChanged, lambda);
+    }
+
+    // models changed : the projections and modes are cleared until computed again
+    {
+        auto lambda = [=] ()
+        {
+            ui->PrincipalComponentAnimationCheckBox->setChecked(false);
+            combobox->clear();
+        };
+        connect(gl, &OpenGLWidget::ModelsChangedSignal, this, lambda);
+    }
+
+    // amplitude spinbox
+    {
+        auto spinbox = ui->PrincipalComponentAmplitudeSpinBox;
+
+        auto lambda = [=] (double value)
+        {
+            gl->animation.amplitude = static_cast<float>(value);
+        };
+        connect(spinbox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), lambda);
+    }
+}
+
+void MainWindow::CrossCorrelationTab()
+{
+    auto heatmap = ui->CrossCorrelationHeatMap;
+    // the reference residue is shared with the contacts outline
+    auto reference = ui->ContactReferenceSpinBox;
+
+    // compute button
+    {
+        auto button = ui->CrossCorrelationButton;
+
+        auto lambda = [=] ()
+        {
+            auto selection = gl->trajectory.GetSelection(ui->CrossCorrelationSelectionLineEdit->text());
+
+            if (selection.isEmpty())
+            {
+                qDebug() << "empty selection";
+                return;
+            }
+
+            bool atoms = ui->CrossCorrelationAtomsCheckBox->isChecked();
+
+            QString key = QString("%1;%2").arg(ui->CrossCorrelationSelectionLineEdit->text()).arg(atoms);
+            gl->analyses.SetParameters("correlation", key, [=] () { gl->correlation.Compute(selection, atoms); });
+            gl->analyses.Require("correlation");
+
+            heatmap->SetMatrix(gl->correlation.ResiduesMatrix, -1, 1);
+            heatmap->SetMarker(gl->correlation.GetResidueIndex(gl->outline.reference));
+
+            gl->SetOutlineColor();
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+
+    // heat map clicked : the row residue becomes the reference
+    {
+        auto lambda = [=] (int row, int column)
+        {
+            Q_UNUSED(column);
+
+            if (row < gl->correlation.ResidueNumbers.size())
+            {
+                reference->setValue(gl->correlation.ResidueNumbers[row]);
+            }
+        };
+        connect(heatmap, &HeatMapWidget::CellSignal, lambda);
+    }
+
+    // reference residue changed
+    {
+        auto lambda = [=] (int value)
+        {
+            heatmap->SetMarker(gl->correlation.GetResidueIndex(value));
+        };
+        connect(reference, QOverload<int>::of(&QSpinBox::valueChanged), lambda);
+    }
+
+    // models changed : the matrix is cleared until computed again
+    {
+        auto lambda = [=] ()
+        {
+            heatmap->SetMatrix(Eigen::MatrixXf(), 0, 0);
+        };
+        connect(gl, &OpenGLWidget::ModelsChangedSignal, this, lambda);
+    }
+
+    // export button
+    {
+        auto button = ui->CrossCorrelationExportButton;
+
+        auto lambda = [=] ()
+        {
+            if (gl->correlation.isEmpty())
+            {
+                qDebug() << "empty DCCM";
+                return;
+            }
+
+            gl->correlation.Export("../../dccm.txt");
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+}
+
+void MainWindow::LigandTab()
+{
+    auto plot = ui->LigandPlot;
+    auto label = ui->LigandValueLabel;
+    auto slider = ui->StepSlider;
+
+    auto UpdateLabel = [=] ()
+    {
+        if (gl->ligand.isEmpty() || !gl->analyses.isValid("ligand"))
+        {
+            label->setText(QString());
+            return;
+        }
+
+        float value = gl->ligand.RMSDs.value(gl->playback.step, NAN);
+        label->setText(QString("ligand RMSD %1 A").arg(value, 8, 'f', 3));
+    };
+
+    // compute button
+    {
+        auto button = ui->LigandButton;
+
+        auto lambda = [=] ()
+        {
+            QString chain = ui->LigandChainLineEdit->text().trimmed();
+            float cutoff = static_cast<float>(ui->LigandCutoffSpinBox->value());
+
+            QString key = QString("%1;%2").arg(chain).arg(cutoff);
+            gl->analyses.SetParameters("ligand", key, [=] () { gl->ligand.Compute(chain, cutoff); });
+            gl->analyses.Require("ligand");
+
+            plot->SetValues(gl->ligand.RMSDs, 0, gl->ligand.MaxRMSD);
+            plot->SetStep(gl->playback.step);
+            UpdateLabel();
+
+            gl->SetOutlineColor();
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+
+    // step changed
+    {
+        auto lambda = [=] (int value)
+        {
+            plot->SetStep(value);
+            UpdateLabel();
+        };
+        connect(slider, &QSlider::valueChanged, lambda);
+    }
+
+    // plot clicked : jump to step
+    {
+        auto lambda = [=] (int step)
+        {
+            slider->setSliderPosition(step);
+        };
+        connect(plot, &TimeSeriesWidget::StepSignal, lambda);
+    }
+
+    // models changed : the RMSDs are cleared until computed again
+    {
+        auto lambda = [=] ()
+        {
+            plot->SetValues(QVector<float>(), 0, 0);
+            UpdateLabel();
+        };
+        connect(gl, &OpenGLWidget::ModelsChangedSignal, this, lambda);
+    }
+
+    // export button
+    {
+        auto button = ui->LigandExportButton;
+
+        auto lambda = [=] ()
+        {
+            if (gl->ligand.isEmpty())
+            {
+                qDebug() << "empty ligand analysis";
+                return;
+            }
+
+            gl->ligand.Export("../../ligand.txt");
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+}
+
+void MainWindow::NormalModeTab()
+{
+    auto combobox = ui->NormalModeComboBox;
+
+    // compute button : the network is built on the current model
+    {
+        auto button = ui->NormalModeButton;
+
+        auto lambda = [=] ()
+        {
+            auto selection = gl->trajectory.GetSelection(ui->NormalModeSelectionLineEdit->text());
+
+            if (selection.isEmpty())
+            {
+                qDebug() << "empty selection";
+                return;
+            }
+
+            int step = gl->playback.step;
+            float cutoff = static_cast<float>(ui->NormalModeCutoffSpinBox->value());
+            int modes = ui->NormalModeNumberSpinBox->value();
+
+            QString key = QString("%1;%2;%3;%4").arg(ui->NormalModeSelectionLineEdit->text()).arg(step).arg(cutoff).arg(modes);
+            gl->analyses.SetParameters("anm", key, [=] () { gl->anm.Compute(selection, step, cutoff, modes); });
+            gl->analyses.Require("anm");
+
+            combobox->blockSignals(true);
+            combobox->clear();
+            for (int i = 0; i < gl->anm.eigenvalues.size(); i++)
+            {
+                combobox->addItem(QString("Mode %1 : %2").arg(i + 1).arg(gl->anm.eigenvalues[i], 0, 'f', 4));
+            }
+            combobox->blockSignals(false);
+
+            combobox->setCurrentIndex(-1);
+            combobox->setCurrentIndex(0);
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+
+    // mode combobox
+    {
+        auto lambda = [=] (int index)
+        {
+            if (index >= 0 && gl->animation.source == NORMAL_MODES)
+            {
+                gl->animation.mode = index;
+                gl->animation.UpdateFlag = true;
+            }
+        };
+        connect(combobox, QOverload<int>::of(&QComboBox::currentIndexChanged), lambda);
+    }
+
+    // animation checkbox
+    {
+        auto checkbox = ui->NormalModeAnimationCheckBox;
+
+        auto lambda = [=] (int state)
+        {
+            if (state == Qt::Checked)
+            {
+                gl->animation.source = NORMAL_MODES;
+                gl->animation.mode = qMax(0, combobox->currentIndex());
+                gl->animation.active = !gl->anm.isEmpty() && gl->analyses.isValid("anm");
+            }
+            else if (gl->animation.source == NORMAL_MODES)
+            {
+                gl->animation.active = false;
+            }
+            gl->animation.UpdateFlag = true;
+            gl->animation.time.restart();
+        };
+        connect(checkbox, &QCheckBox::stateChanged, lambda);
+    }
+
+    // models changed : the modes are cleared until computed again
+    {
+        auto lambda = [=] ()
+        {
+            ui->NormalModeAnimationCheckBox->setChecked(false);
+            combobox->clear();
+        };
+        connect(gl, &OpenGLWidget::ModelsChangedSignal, this, lambda);
+    }
+
+    // amplitude spinbox
+    {
+        auto spinbox = ui->NormalModeAmplitudeSpinBox;
+
+        auto lambda = [=] (double value)
+        {
+            gl->animation.amplitude = static_cast<float>(value);
+        };
+        connect(spinbox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), lambda);
+    }
+}
+
+void MainWindow::RadialDistributionTab()
+{
+    auto plot = ui->RadialDistributionPlot;
+    auto label = ui->RadialDistributionValueLabel;
+
+    auto compute = [=] ()
+    {
+        auto a = gl->trajectory.GetSelection(ui->RadialDistributionFirstLineEdit->text());
+        auto b = gl->trajectory.GetSelection(ui->RadialDistributionSecondLineEdit->text());
+
+        if (a.isEmpty() || b.isEmpty())
+        {
+            qDebug() << "empty selection";
+            return;
+        }
+
+        float radius = static_cast<float>(ui->RadialDistributionRadiusSpinBox->value());
+        float width = static_cast<float>(ui->RadialDistributionBinSpinBox->value());
+
+        QString key = QString("%1;%2;%3;%4").arg(ui->RadialDistributionFirstLineEdit->text(), ui->RadialDistributionSecondLineEdit->text()).arg(radius).arg(width);
+        gl->analyses.SetParameters("rdf", key, [=] () { gl->rdf.Compute(a, b, radius, width); });
+        gl->analyses.Require("rdf");
+
+        // the plot marker is left out of range
+        plot->SetValues(gl->rdf.values, 0, gl->rdf.MaxValue);
+        plot->SetStep(-1);
+
+        label->setText(QString("peak %1 A, g %2").arg(gl->rdf.GetPeakRadius(), 0, 'f', 2).arg(gl->rdf.MaxValue, 0, 'f', 2));
+    };
+
+    // compute button
+    {
+        auto button = ui->RadialDistributionButton;
+        connect(button, &QPushButton::clicked, compute);
+    }
+
+    // selections edited : recompute
+    {
+        connect(ui->RadialDistributionFirstLineEdit, &QLineEdit::editingFinished, compute);
+        connect(ui->RadialDistributionSecondLineEdit, &QLineEdit::editingFinished, compute);
+    }
+
+    // models changed : the g(r) is cleared until computed again
+    {
+        auto lambda = [=] ()
+        {
+            plot->SetValues(QVector<float>(), 0, 0);
+            label->setText(QString());
+        };
+        connect(gl, &OpenGLWidget::ModelsChangedSignal, this, lambda);
+    }
+
+    // export button
+    {
+        auto button = ui->RadialDistributionExportButton;
+
+        auto lambda = [=] ()
+        {
+            if (gl->rdf.isEmpty())
+            {
+                qDebug() << "empty RDF";
+                return;
+            }
+
+            gl->rdf.Export("../../rdf.txt");
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+}
+
+void MainWindow::DihedralTab()
+{
+    auto heatmap = ui->DihedralHeatMap;
+    auto label = ui->DihedralValueLabel;
+    auto combobox = ui->DihedralComboBox;
+    auto slider = ui->StepSlider;
+
+    for (auto name : DihedralAnglesNames)
+    {
+        combobox->addItem(name);
+    }
+
+    // Ramachandran plot of the frames window around the current step
+    auto UpdateHeatMap = [=] ()
+    {
+        if (gl->dihedrals.isEmpty() || !gl->analyses.isValid("dihedrals"))
+        {
+            return;
+        }
+
+        auto density = gl->dihedrals.GetRamachandran(gl->playback.step, gl->outline.window);
+        heatmap->SetMatrix(density, 0, density.maxCoeff(), false);
+    };
+
+    // compute button
+    {
+        auto button = ui->DihedralButton;
+
+        auto lambda = [=] ()
+        {
+            gl->analyses.Require("dihedrals");
+
+            UpdateHeatMap();
+            gl->SetOutlineColor();
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+
+    // angle combobox : dihedral outline modes
+    {
+        auto lambda = [=] (int index)
+        {
+            gl->outline.dihedral = index;
+            gl->SetOutlineColor();
+        };
+        connect(combobox, QOverload<int>::of(&QComboBox::currentIndexChanged), lambda);
+    }
+
+    // step changed
+    {
+        auto lambda = [=] (int)
+        {
+            UpdateHeatMap();
+        };
+        connect(slider, &QSlider::valueChanged, lambda);
+    }
+
+    // heat map clicked : bin angles
+    {
+        auto lambda = [=] (int row, int column)
+        {
+            int bins = 72;
+            float width = 360.0f / bins;
+
+            float phi = -180 + column * width;
+            float psi = 180 - (row + 1) * width;
+
+            label->setText(QString("phi %1 to %2, psi %3 to %4").arg(phi).arg(phi + width).arg(psi).arg(psi + width));
+        };
+        connect(heatmap, &HeatMapWidget::CellSignal, lambda);
+    }
+
+    // models changed : the plot is cleared until computed again
+    {
+        auto lambda = [=] ()
+        {
+            heatmap->SetMatrix(Eigen::MatrixXf(), 0, 0);
+            label->setText(QString());
+        };
+        connect(gl, &OpenGLWidget::ModelsChangedSignal, this, lambda);
+    }
+
+    // export button
+    {
+        auto button = ui->DihedralExportButton;
+
+        auto lambda = [=] ()
+        {
+            if (gl->dihedrals.isEmpty())
+            {
+                qDebug() << "empty dihedrals";
+                return;
+            }
+
+            gl->dihedrals.Export("../../dihedrals.txt");
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+}
+
+void MainWindow::ElectrostaticsTab()
+{
+    auto label = ui->ElectrostaticsValueLabel;
+
+    auto update = [=] ()
+    {
+        float cutoff = static_cast<float>(ui->ElectrostaticsCutoffSpinBox->value());
+        float dielectric = static_cast<float>(ui->ElectrostaticsDielectricSpinBox->value());
+
+        // the potentials cache is dropped for new parameters or new models
+        QString key = QString("%1;%2").arg(cutoff).arg(dielectric);
+        gl->analyses.SetParameters("electrostatics", key, [=] () { gl->electrostatics.SetParameters(cutoff, dielectric); });
+        gl->analyses.Require("electrostatics");
+        gl->electrostatics.range = static_cast<float>(ui->ElectrostaticsRangeSpinBox->value());
+
+        QElapsedTimer timer;
+        timer.start();
+
+        gl->electrostatics.GetPotentials(gl->playback.step);
+
+        label->setText(QString("potentials of the step in %1 ms").arg(timer.elapsed()));
+
+        gl->SetOutlineColor();
+    };
+
+    // parameters spinboxes : the outline is recomputed
+    {
+        connect(ui->ElectrostaticsCutoffSpinBox, &QDoubleSpinBox::editingFinished, update);
+        connect(ui->ElectrostaticsDielectricSpinBox, &QDoubleSpinBox::editingFinished, update);
+        connect(ui->ElectrostaticsRangeSpinBox, &QDoubleSpinBox::editingFinished, update);
+    }
+}
+
+void MainWindow::DensityTab()
+{
+    auto label = ui->DensityValueLabel;
+
+    // cells drawn from the current density
+    auto draw = [=] ()
+    {
+        gl->DensityLevel = static_cast<float>(ui->DensityLevelSpinBox->value());
+        gl->DensitySurface = (ui->DensityModeComboBox->currentIndex() == 0);
+
+        gl->makeCurrent();
+        gl->SetDensityVAO();
+        gl->doneCurrent();
+    };
+
+    // the frames are superposed once for a fit selection, a new selection or grid only accumulates again
+    auto compute = [=] ()
+    {
+        QString FitText = ui->DensityFitLineEdit->text();
+        auto fit = gl->trajectory.GetSelection(FitText);
+        auto selection = gl->trajectory.GetSelection(ui->DensitySelectionLineEdit->text());
+
+        if (fit.size() < 3 || selection.isEmpty())
+        {
+            qDebug() << "empty selection";
+            return;
+        }
+
+        float spacing = static_cast<float>(ui->DensitySpacingSpinBox->value());
+        float sigma = static_cast<float>(ui->DensitySigmaSpinBox->value());
+
+        gl->analyses.SetParameters("density alignment", FitText, [=] () { gl->density.Align(fit); });
+
+        QString key = QString("%1;%2;%3").arg(ui->DensitySelectionLineEdit->text()).arg(spacing).arg(sigma);
+        gl->analyses.SetParameters("density", key, [=] () { gl->density.Accumulate(selection, spacing, sigma); });
+
+        QElapsedTimer timer;
+        timer.start();
+
+        gl->analyses.Require("density");
+
+        const auto &density = gl->density;
+        label->setText(QString("%1 x %2 x %3 cells, max %4 atoms/A3 (%5 ms)").arg(density.dims[0]).arg(density.dims[1]).arg(density.dims[2]).arg(static_cast<double>(density.MaxValue), 0, 'g', 3).arg(timer.elapsed()));
+
+        draw();
+    };
+
+    // compute button, or a new selection
+    {
+        connect(ui->DensityButton, &QPushButton::clicked, compute);
+        connect(ui->DensitySelectionLineEdit, &QLineEdit::editingFinished, compute);
+    }
+
+    // drawn cells
+    {
+        connect(ui->DensityLevelSpinBox, &QDoubleSpinBox::editingFinished, draw);
+        connect(ui->DensityModeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), draw);
+    }
+
+    // show density
+    {
+        auto checkbox = ui->DensityCheckbox;
+        checkbox->setChecked(gl->DensityVisible);
+
+        auto lambda = [=] (int state)
+        {
+            gl->DensityVisible = (state == Qt::Checked);
+
+            // accumulated again with the last parameters when the models changed since
+            if (gl->DensityVisible && !gl->analyses.isValid("density") && gl->analyses.Require("density"))
+            {
+                draw();
+            }
+        };
+        connect(checkbox, &QCheckBox::stateChanged, lambda);
+    }
+
+    // models changed : the density on display follows
+    {
+        auto lambda = [=] ()
+        {
+            label->setText(QString());
+
+            if (gl->DensityVisible && gl->analyses.Require("density"))
+            {
+                draw();
+            }
+        };
+        connect(gl, &OpenGLWidget::ModelsChangedSignal, this, lambda);
+    }
+
+    // export button
+    {
+        auto button = ui->DensityExportButton;
+
+        auto lambda = [=] ()
+        {
+            if (gl->density.isEmpty())
+            {
+                qDebug() << "no density";
+                return;
+            }
+
+            gl->density.Export("../../density.dx");
+        };
+        connect(button, &QPushButton::clicked, lambda);
+    }
+}
+
+void MainWindow::ColorLerp()
+{
+    QColor albedo = Qt::GlobalColor::red;
+
+    auto label = ui->ColorLerpLabel;
+
+    auto slider = ui->ColorLerpSlider;
+    float size = 10;
+    slider->setMinimum(-size);
+    slider->setMaximum(+size);
+    slider->setSliderPosition(0);
+
+    auto lerp = [] (float a, float b, float t)
+    {
+        t = qBound(0.0f, t, 1.0f);
+        return a * (1 - t) + b * t;
+    };
+
+    auto LerpQColor = [=] (QColor a, QColor b, float t)
+    {
+        QColor c;
+        c.setRedF(lerp(a.redF(), b.redF(), t));
+        c.setGreenF(lerp(a.greenF(), b.greenF(), t));
+        c.setBlueF(lerp(a.blueF(), b.blueF(), t));
+        return c;
+    };
+
+    auto lambda = [=] (int value)
+    {
+        QColor colour = albedo;
+
+        if (value < 0)
+        {
+            float t = (size + value) / size;
+            colour = LerpQColor(Qt::GlobalColor::black, albedo, t);
+        }
+
+        if (value > 0)
+        {
+            float t = (size - value) / size;
+            colour = LerpQColor(Qt::GlobalColor::white, albedo, t);
+        }
+
+        QStringList rules;
+        rules += QString("background-color: %1").arg(colour.name());
+        label->setStyleSheet(rules.join("; "));
+
+        label->setText(colour.name());
+    };
+    connect(slider, &QSlider::valueChanged, lambda);
+
+}
+
+void MainWindow::SSAOTab()
+{
+    // active checkbox
+    {
+        auto checkbox = ui->SSAOActive;
+        checkbox->setChecked(gl->SSAO.active);
+
+        auto lambda = [=] (int state)
+        {
+            // update value
+            gl->SSAO.active = (state == Qt::Checked);
+        };
+        connect(checkbox, &QCheckBox::stateChanged, lambda);
+    }
+
+    // blur checkbox
+    {
+        auto checkbox = ui->SSAOBlur;
+        checkbox->setChecked(gl->SSAO.blur);
+
+        qDebug() << checkbox;
+
+        auto lambda = [=] (int state)
+        {
+            // update value
+            gl->SSAO.blur = (state == Qt::Checked);
+        };
+        connect(checkbox, &QCheckBox::stateChanged, lambda);
+    }
+
+    // kernel size
+    {
+        int size = gl->SSAO.KernelSize;
+
+        auto label = ui->SSAOKernelSizeLabel;
+        QString caption = label->text().split(" :").first();
+        label->setText(QString("%1 : %2").arg(caption).arg(size, 2));
+
+        auto slider = ui->SSAOKernelSizeSlider;
+        slider->setMinimum(1);
+        slider->setMaximum(30);
+
+        // update value
+        slider->setSliderPosition(size);
+
+        // value changed event
+        auto lambda = [=] (int value)
+        {
+            // update value
+            gl->SSAO.KernelSize = value;
+            gl->SSAO.SetKernel();
+            // gl->KernelTextureFlag = true;
+            // update label
+            QString caption = label->text().split(" :").first();
+            label->setText(QString("%1 : %2").arg(caption).arg(value, 2));
+        };
+        connect(slider, &QSlider::valueChanged, lambda);
+    }
+
+    // noise size
+    {
+        int size = gl->SSAO.NoiseSize;
+
+        auto label = ui->SSAONoiseSizeLabel;
+        QString caption = label->text().split(" :").first();
+        label->setText(QString("%1 : %2").arg(caption).arg(size, 2));
+
+        auto slider = ui->SSAONoiseSizeSlider;
+        slider->setMinimum(1);
+        slider->setMaximum(30);
+
+        // update value
+        slider->setSliderPosition(size * 0.5f);
+
+        // value changed event
+        auto lambda = [=] (int value)
+        {
+            int w = gl->geometry().width();
             int h = gl->geometry().height();
 
             int NoiseSize = value * 2.0f;
@@ -1405,6 +2843,20 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
         qDebug() << "light.free" << gl->light.free;
         break;
     }
+    case Qt::Key_G:
+    {
+        // neighbour grid against brute force on the current model
+        auto selection = gl->trajectory.GetSelection("all");
+        auto positions = gl->trajectory.GetPositions(gl->playback.step, selection);
+        NeighbourGrid::Benchmark(positions, 4.5f, 16);
+        break;
+    }
+    case Qt::Key_B:
+    {
+        // covalent bonds perception scaling, up to millions of atoms
+        CovalentBonds::Benchmark(8000000);
+        break;
+    }
     case Qt::Key_Shift:
     {
         gl->ShiftDown = true;
@@ -10,6 +10,10 @@
 #include <QButtonGroup>
 #include <QCheckBox>
 #include <QComboBox>
+#include <QLineEdit>
+#include <QDoubleSpinBox>
+#include <QSpinBox>
+#include <QFutureWatcher>
 
 #include "residueswindow.h"
 
@@ -41,9 +45,28 @@ private:
     void AtomGroup();
     void ResidueGroup();
     void TrajectoryGroup();
+    void ReferenceGroup();
+    void SmoothingGroup();
+    void FrameSearchGroup();
     // void progress();
     void OutlineGroup();
     void playback();
+    void ObservableGroup();
+    void UpdateObservables();
+
+    void ClusterTab();
+    void ContactTab();
+    void HydrogenBondTab();
+    void SurfaceTab();
+    void ObservableTab();
+    void PrincipalComponentTab();
+    void CrossCorrelationTab();
+    void LigandTab();
+    void NormalModeTab();
+    void RadialDistributionTab();
+    void DihedralTab();
+    void ElectrostaticsTab();
+    void DensityTab();
 
     void ColorLerp();
 
@@ -53,6 +76,14 @@ private:
 
     void framerate();
 
+    // frames index over the current models, swapped in when built
+    // (each build is tagged with its generation, the results of superseded builds are dropped)
+    QFutureWatcher<QPair<int, FrameIndex>> FrameIndexWatcher;
+    int FrameIndexGeneration = 0;
+    void BuildFrameIndex();
+    // nearest frames of the current step, as jump targets
+    void UpdateFrameTargets();
+
     ResiduesWindow window;
     void ResiduesWindowInit();
 };
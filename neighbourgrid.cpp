@@ -0,0 +1,633 @@
+#include "neighbourgrid.h"
+
+NeighbourGrid::NeighbourGrid()
+{
+    CellSize = 1.0f;
+    margin = 0.0f;
+    dims[0] = dims[1] = dims[2] = 0;
+}
+
+void NeighbourGrid::Build(const QVector<QVector3D> &positions, float CellSize)
+{
+    this->positions = positions;
+    this->CellSize = CellSize;
+    this->margin = CellSize;
+
+    SetGeometry();
+    SetCells();
+    Sort();
+}
+
+void NeighbourGrid::Update(const QVector<QVector3D> &positions)
+{
+    if (positions.size() != this->positions.size())
+    {
+        Build(positions, CellSize);
+        return;
+    }
+
+    this->positions = positions;
+
+    // a position outside the grid needs a new geometry
+    QVector3D extent = QVector3D(dims[0], dims[1], dims[2]) * CellSize;
+
+    for (auto p : positions)
+    {
+        QVector3D q = p - origin;
+
+        for (int i = 0; i < 3; i++)
+        {
+            if (q[i] < 0 || q[i] >= extent[i])
+            {
+                SetGeometry();
+                SetCells();
+                Sort();
+                return;
+            }
+        }
+    }
+
+    QVector<int> previous = cells;
+    SetCells();
+
+    if (cells == previous)
+    {
+        // same cells : only the sorted positions change
+        for (int i = 0; i < indices.size(); i++)
+        {
+            sorted[i] = positions[indices[i]];
+        }
+        return;
+    }
+
+    Sort();
+}
+
+void NeighbourGrid::SetGeometry()
+{
+    QVector3D min(FLT_MAX, FLT_MAX, FLT_MAX);
+    QVector3D max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    for (auto p : positions)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            min[i] = qMin(min[i], p[i]);
+            max[i] = qMax(max[i], p[i]);
+        }
+    }
+
+    if (positions.isEmpty())
+    {
+        min = max = QVector3D();
+    }
+
+    origin = min - QVector3D(margin, margin, margin);
+    QVector3D extent = (max - min) + QVector3D(margin, margin, margin) * 2;
+
+    // sparse positions would make too many empty cells : the cell size grows
+    qint64 MaxCells = 4 * static_cast<qint64>(positions.size()) + 1024;
+
+    while (true)
+    {
+        qint64 count = 1;
+        for (int i = 0; i < 3; i++)
+        {
+            dims[i] = qMax(1, static_cast<int>(extent[i] / CellSize) + 1);
+            count *= dims[i];
+        }
+
+        if (count <= MaxCells)
+        {
+            break;
+        }
+
+        CellSize *= 1.25f;
+    }
+}
+
+void NeighbourGrid::GetCellCoordinates(QVector3D point, int coordinates[3]) const
+{
+    QVector3D q = (point - origin) / CellSize;
+
+    for (int i = 0; i < 3; i++)
+    {
+        coordinates[i] = static_cast<int>(std::floor(q[i]));
+    }
+}
+
+int NeighbourGrid::GetCellIndex(int x, int y, int z) const
+{
+    return (z * dims[1] + y) * dims[0] + x;
+}
+
+void NeighbourGrid::SetCells()
+{
+    cells.resize(positions.size());
+
+    auto data = cells.data();
+    auto lambda = [=] (QPair<int, int> chunk)
+    {
+        for (int i = chunk.first; i < chunk.second; i++)
+        {
+            int c[3];
+            GetCellCoordinates(positions.at(i), c);
+
+            for (int j = 0; j < 3; j++)
+            {
+                c[j] = qBound(0, c[j], dims[j] - 1);
+            }
+
+            data[i] = GetCellIndex(c[0], c[1], c[2]);
+        }
+    };
+
+    if (!parallel)
+    {
+        lambda(qMakePair(0, positions.size()));
+        return;
+    }
+
+    auto chunks = GetChunks(positions.size());
+    QtConcurrent::blockingMap(chunks, lambda);
+}
+
+void NeighbourGrid::Sort()
+{
+    // counting sort of the positions by cell
+    int count = dims[0] * dims[1] * dims[2];
+
+    CellStarts.fill(0, count + 1);
+
+    for (auto c : cells)
+    {
+        CellStarts[c + 1] += 1;
+    }
+
+    for (int c = 0; c < count; c++)
+    {
+        CellStarts[c + 1] += CellStarts[c];
+    }
+
+    indices.resize(positions.size());
+    sorted.resize(positions.size());
+
+    QVector<int> offsets = CellStarts;
+
+    for (int i = 0; i < positions.size(); i++)
+    {
+        int j = offsets[cells[i]]++;
+        indices[j] = i;
+        sorted[j] = positions[i];
+    }
+}
+
+int NeighbourGrid::size() const
+{
+    return positions.size();
+}
+
+QVector3D NeighbourGrid::position(int index) const
+{
+    return positions.at(index);
+}
+
+QVector<int> NeighbourGrid::RadiusQuery(QVector3D point, float radius) const
+{
+    QVector<int> result;
+
+    if (positions.isEmpty())
+    {
+        return result;
+    }
+
+    int c[3];
+    GetCellCoordinates(point, c);
+
+    int n = static_cast<int>(std::ceil(radius / CellSize));
+
+    int lo[3];
+    int hi[3];
+    for (int i = 0; i < 3; i++)
+    {
+        lo[i] = qMax(0, c[i] - n);
+        hi[i] = qMin(dims[i] - 1, c[i] + n);
+
+        // point farther than radius outside the grid
+        if (lo[i] > hi[i])
+        {
+            return result;
+        }
+    }
+
+    float r2 = radius * radius;
+
+    for (int z = lo[2]; z <= hi[2]; z++)
+    {
+        for (int y = lo[1]; y <= hi[1]; y++)
+        {
+            // cells along x are contiguous
+            int begin = CellStarts[GetCellIndex(lo[0], y, z)];
+            int end = CellStarts[GetCellIndex(hi[0], y, z) + 1];
+
+            for (int j = begin; j < end; j++)
+            {
+                if ((sorted[j] - point).lengthSquared() <= r2)
+                {
+                    result += indices[j];
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+void NeighbourGrid::GetCellRanges(QVector3D point, float radius, QVector<QPair<int, int>> &ranges) const
+{
+    ranges.clear();
+
+    if (positions.isEmpty())
+    {
+        return;
+    }
+
+    int c[3];
+    GetCellCoordinates(point, c);
+
+    int n = static_cast<int>(std::ceil(radius / CellSize));
+
+    int lo[3];
+    int hi[3];
+    for (int i = 0; i < 3; i++)
+    {
+        lo[i] = qMax(0, c[i] - n);
+        hi[i] = qMin(dims[i] - 1, c[i] + n);
+
+        // point farther than radius outside the grid
+        if (lo[i] > hi[i])
+        {
+            return;
+        }
+    }
+
+    for (int z = lo[2]; z <= hi[2]; z++)
+    {
+        for (int y = lo[1]; y <= hi[1]; y++)
+        {
+            // cells along x are contiguous
+            int begin = CellStarts[GetCellIndex(lo[0], y, z)];
+            int end = CellStarts[GetCellIndex(hi[0], y, z) + 1];
+
+            if (begin < end)
+            {
+                ranges += qMakePair(begin, end);
+            }
+        }
+    }
+}
+
+int NeighbourGrid::GetSortedIndex(int slot) const
+{
+    return indices[slot];
+}
+
+QVector<int> NeighbourGrid::NearestQuery(QVector3D point, int k) const
+{
+    k = qMin(k, positions.size());
+
+    // max-heap of (squared distance, index)
+    std::vector<std::pair<float, int>> heap;
+
+    if (k <= 0)
+    {
+        return QVector<int>();
+    }
+
+    int c[3];
+    GetCellCoordinates(point, c);
+
+    // rings beyond this one are all outside the grid
+    int MaxRing = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        MaxRing = qMax(MaxRing, qMax(qAbs(c[i]), qAbs(dims[i] - 1 - c[i])));
+    }
+
+    for (int s = 0; s <= MaxRing; s++)
+    {
+        // positions in ring s are at least (s - 1) cells away from point
+        if (static_cast<int>(heap.size()) == k)
+        {
+            float bound = (s - 1) * CellSize;
+            if (bound > 0 && heap.front().first <= bound * bound)
+            {
+                break;
+            }
+        }
+
+        for (int z = c[2] - s; z <= c[2] + s; z++)
+        {
+            if (z < 0 || z >= dims[2])
+            {
+                continue;
+            }
+
+            for (int y = c[1] - s; y <= c[1] + s; y++)
+            {
+                if (y < 0 || y >= dims[1])
+                {
+                    continue;
+                }
+
+                // inner rows only contribute the two ring faces along x
+                bool face = (qAbs(z - c[2]) == s) || (qAbs(y - c[1]) == s);
+                int step = (face || s == 0) ? 1 : 2 * s;
+
+                for (int x = c[0] - s; x <= c[0] + s; x += step)
+                {
+                    if (x < 0 || x >= dims[0])
+                    {
+                        continue;
+                    }
+
+                    int cell = GetCellIndex(x, y, z);
+
+                    for (int j = CellStarts[cell]; j < CellStarts[cell + 1]; j++)
+                    {
+                        float d2 = (sorted[j] - point).lengthSquared();
+
+                        if (static_cast<int>(heap.size()) < k)
+                        {
+                            heap.push_back({d2, indices[j]});
+                            std::push_heap(heap.begin(), heap.end());
+                        }
+                        else if (d2 < heap.front().first)
+                        {
+                            std::pop_heap(heap.begin(), heap.end());
+                            heap.back() = {d2, indices[j]};
+                            std::push_heap(heap.begin(), heap.end());
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end());
+
+    QVector<int> result;
+    for (auto item : heap)
+    {
+        result += item.second;
+    }
+
+    return result;
+}
+
+QVector<QPair<int, int>> NeighbourGrid::PairsQuery(float cutoff) const
+{
+    int count = dims[0] * dims[1] * dims[2];
+
+    if (!parallel)
+    {
+        QVector<QPair<int, int>> pairs;
+        GetPairs(cutoff, 0, count, pairs);
+        return pairs;
+    }
+
+    struct Worker
+    {
+        int begin;
+        int end;
+        QVector<QPair<int, int>> pairs;
+    };
+
+    QVector<Worker> workers;
+    for (auto chunk : GetChunks(count))
+    {
+        Worker worker;
+        worker.begin = chunk.first;
+        worker.end = chunk.second;
+        workers += worker;
+    }
+
+    auto lambda = [&] (Worker &worker)
+    {
+        GetPairs(cutoff, worker.begin, worker.end, worker.pairs);
+    };
+
+    QtConcurrent::blockingMap(workers, lambda);
+
+    QVector<QPair<int, int>> pairs;
+    for (auto worker : workers)
+    {
+        pairs += worker.pairs;
+    }
+
+    return pairs;
+}
+
+void NeighbourGrid::GetPairs(float cutoff, int FirstCell, int LastCell, QVector<QPair<int, int>> &pairs) const
+{
+    int n = static_cast<int>(std::ceil(cutoff / CellSize));
+    float r2 = cutoff * cutoff;
+
+    for (int cell = FirstCell; cell < LastCell; cell++)
+    {
+        int x = cell % dims[0];
+        int y = (cell / dims[0]) % dims[1];
+        int z = cell / (dims[0] * dims[1]);
+
+        for (int nz = qMax(0, z - n); nz <= qMin(dims[2] - 1, z + n); nz++)
+        {
+            for (int ny = qMax(0, y - n); ny <= qMin(dims[1] - 1, y + n); ny++)
+            {
+                for (int nx = qMax(0, x - n); nx <= qMin(dims[0] - 1, x + n); nx++)
+                {
+                    int other = GetCellIndex(nx, ny, nz);
+
+                    // each couple of cells is visited once
+                    if (other < cell)
+                    {
+                        continue;
+                    }
+
+                    for (int i = CellStarts[cell]; i < CellStarts[cell + 1]; i++)
+                    {
+                        int begin = (other == cell) ? i + 1 : CellStarts[other];
+
+                        for (int j = begin; j < CellStarts[other + 1]; j++)
+                        {
+                            if ((sorted[i] - sorted[j]).lengthSquared() <= r2)
+                            {
+                                int a = indices[i];
+                                int b = indices[j];
+                                pairs += qMakePair(qMin(a, b), qMax(a, b));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+QVector<QVector<int>> NeighbourGrid::RadiusQueries(const QVector<QVector3D> &points, float radius) const
+{
+    QVector<QVector<int>> results(points.size());
+
+    auto data = results.data();
+    auto lambda = [&] (QPair<int, int> chunk)
+    {
+        for (int i = chunk.first; i < chunk.second; i++)
+        {
+            data[i] = RadiusQuery(points.at(i), radius);
+        }
+    };
+
+    if (!parallel)
+    {
+        lambda(qMakePair(0, points.size()));
+        return results;
+    }
+
+    auto chunks = GetChunks(points.size());
+    QtConcurrent::blockingMap(chunks, lambda);
+
+    return results;
+}
+
+void NeighbourGrid::Benchmark(const QVector<QVector3D> &positions, float radius, int k)
+{
+    int size = positions.size();
+
+    QElapsedTimer timer;
+
+    // build
+    NeighbourGrid grid;
+
+    timer.start();
+    grid.Build(positions, radius);
+    qint64 BuildTime = timer.nsecsElapsed();
+
+    timer.restart();
+    grid.Update(positions);
+    qint64 UpdateTime = timer.nsecsElapsed();
+
+    // radius queries
+    timer.restart();
+    auto GridNeighbours = grid.RadiusQueries(positions, radius);
+    qint64 GridRadiusTime = timer.nsecsElapsed();
+
+    timer.restart();
+    qint64 BruteNeighboursCount = 0;
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            if ((positions[i] - positions[j]).lengthSquared() <= radius * radius)
+            {
+                BruteNeighboursCount += 1;
+            }
+        }
+    }
+    qint64 BruteRadiusTime = timer.nsecsElapsed();
+
+    qint64 GridNeighboursCount = 0;
+    for (auto neighbours : GridNeighbours)
+    {
+        GridNeighboursCount += neighbours.size();
+    }
+
+    // pairs
+    timer.restart();
+    auto GridPairs = grid.PairsQuery(radius);
+    qint64 GridPairsTime = timer.nsecsElapsed();
+
+    // k nearest (first atoms only, brute force is sorting all distances)
+    int queries = qMin(size, 1000);
+
+    timer.restart();
+    QVector<QVector<int>> GridNearest;
+    for (int i = 0; i < queries; i++)
+    {
+        GridNearest += grid.NearestQuery(positions[i], k);
+    }
+    qint64 GridNearestTime = timer.nsecsElapsed();
+
+    timer.restart();
+    int mismatches = 0;
+    for (int i = 0; i < queries; i++)
+    {
+        QVector<QPair<float, int>> distances;
+        for (int j = 0; j < size; j++)
+        {
+            distances += qMakePair((positions[i] - positions[j]).lengthSquared(), j);
+        }
+        std::partial_sort(distances.begin(), distances.begin() + qMin(k, size), distances.end());
+
+        // compare the k-th distance (ties may swap indices)
+        int last = qMin(k, size) - 1;
+        if (last >= 0)
+        {
+            float expected = distances[last].first;
+            float found = (positions[i] - positions[GridNearest[i].last()]).lengthSquared();
+            mismatches += (qAbs(expected - found) > 1e-6f) ? 1 : 0;
+        }
+    }
+    qint64 BruteNearestTime = timer.nsecsElapsed();
+
+    // radius queries outside the grid (e.g. a selection against the grid of another one),
+    // from just beyond the bounding box to several radii away, below and above on every axis
+    QVector3D min = positions.isEmpty() ? QVector3D() : positions.first();
+    QVector3D max = min;
+    for (const auto &p : positions)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            min[i] = qMin(min[i], p[i]);
+            max[i] = qMax(max[i], p[i]);
+        }
+    }
+
+    QVector<QVector3D> outside;
+    for (float margin : {0.5f * radius, 1.5f * radius, 4.0f * radius, 100.0f * radius})
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            QVector3D below = (min + max) / 2;
+            QVector3D above = below;
+            below[i] = min[i] - margin;
+            above[i] = max[i] + margin;
+            outside += below;
+            outside += above;
+        }
+        outside += min - QVector3D(margin, margin, margin);
+        outside += max + QVector3D(margin, margin, margin);
+    }
+
+    int OutsideMismatches = 0;
+    for (const auto &point : outside)
+    {
+        int expected = 0;
+        for (const auto &p : positions)
+        {
+            expected += ((point - p).lengthSquared() <= radius * radius) ? 1 : 0;
+        }
+        OutsideMismatches += (grid.RadiusQuery(point, radius).size() != expected) ? 1 : 0;
+    }
+
+    auto ms = [] (qint64 ns) { return QString("%1 ms").arg(ns * 1e-6, 0, 'f', 3); };
+
+    qDebug() << "NeighbourGrid::Benchmark" << size << "positions, radius" << radius << "k" << k;
+    qDebug() << "  build" << ms(BuildTime) << "update" << ms(UpdateTime);
+    qDebug() << "  radius queries : grid" << ms(GridRadiusTime) << "brute force" << ms(BruteRadiusTime)
+             << ((GridNeighboursCount == BruteNeighboursCount) ? "match" : "MISMATCH");
+    qDebug() << "  pairs : grid" << ms(GridPairsTime) << "brute force (radius queries)" << ms(BruteRadiusTime)
+             << ((2 * GridPairs.size() + size == BruteNeighboursCount) ? "match" : "MISMATCH");
+    qDebug() << "  nearest queries :" << queries << "grid" << ms(GridNearestTime) << "brute force" << ms(BruteNearestTime)
+             << ((mismatches == 0) ? "match" : "MISMATCH");
+    qDebug() << "  radius queries outside the grid :" << outside.size()
+             << ((OutsideMismatches == 0) ? "match" : "MISMATCH");
+}
@@ -0,0 +1,81 @@
+#ifndef NEIGHBOURGRID_H
+#define NEIGHBOURGRID_H
+
+#include <QVector>
+#include <QVector3D>
+#include <QPair>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+
+#include "utility.h"
+using namespace utility;
+
+// uniform grid (cell list) over a set of positions,
+// positions are referred to by their index in the built set
+class NeighbourGrid
+{
+public:
+    NeighbourGrid();
+
+    // queries and builds run across threads,
+    // callers already parallel (e.g. over frames) turn it off
+    bool parallel = true;
+
+    // builds the cell list in O(N)
+    // queries are cheaper when the cell size is close to the typical radius
+    void Build(const QVector<QVector3D> &positions, float CellSize);
+    // rebuilds the cell list for another frame of the same positions set,
+    // reusing grid geometry and buffers while the positions stay inside the grid
+    void Update(const QVector<QVector3D> &positions);
+
+    // positions within radius from point
+    QVector<int> RadiusQuery(QVector3D point, float radius) const;
+    // k nearest positions to point, sorted by distance
+    QVector<int> NearestQuery(QVector3D point, int k) const;
+    // all pairs (i < j) of positions within cutoff
+    QVector<QPair<int, int>> PairsQuery(float cutoff) const;
+
+    // radius queries of many points, in parallel
+    QVector<QVector<int>> RadiusQueries(const QVector<QVector3D> &points, float radius) const;
+
+    // sorted slots ranges [first, second) of the cells within radius from point,
+    // for callers streaming their own per-position data laid out in sorted order
+    void GetCellRanges(QVector3D point, float radius, QVector<QPair<int, int>> &ranges) const;
+    // built position index of a sorted slot
+    int GetSortedIndex(int slot) const;
+
+    int size() const;
+    QVector3D position(int index) const;
+
+    // grid against brute force timings and results, printed on debug output
+    static void Benchmark(const QVector<QVector3D> &positions, float radius, int k);
+
+private:
+    float CellSize;
+    // space left around the positions bounding box, so that Update rarely needs a new geometry
+    float margin;
+    QVector3D origin;
+    int dims[3];
+
+    QVector<QVector3D> positions;
+    // cell of each position
+    QVector<int> cells;
+    // positions indices sorted by cell, cell c owns indices[CellStarts[c]] ... indices[CellStarts[c+1]-1]
+    QVector<int> CellStarts;
+    QVector<int> indices;
+    // positions sorted by cell (contiguous memory access in queries)
+    QVector<QVector3D> sorted;
+
+    void SetGeometry();
+    void SetCells();
+    void Sort();
+
+    // pairs within cutoff owned by the cells in [FirstCell, LastCell)
+    void GetPairs(float cutoff, int FirstCell, int LastCell, QVector<QPair<int, int>> &pairs) const;
+
+    // cell coordinates of a point (may fall outside the grid)
+    void GetCellCoordinates(QVector3D point, int coordinates[3]) const;
+    int GetCellIndex(int x, int y, int z) const;
+};
+
+#endif // NEIGHBOURGRID_H
@@ -0,0 +1,318 @@
+#include "normalmodes.h"
+
+NormalModes::NormalModes(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+    step = 0;
+    cutoff = 15.0f;
+}
+
+void NormalModes::Compute(QVector<int> selection, int step, float cutoff, int k)
+{
+    this->selection = selection;
+    this->step = step;
+    this->cutoff = cutoff;
+
+    eigenvalues.clear();
+    modes.resize(0, 0);
+
+    int size = selection.size();
+
+    if (size < 3)
+    {
+        qDebug() << "normal modes need at least 3 atoms";
+        return;
+    }
+
+    auto positions = trajectory->GetPositions(step, selection);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    auto H = GetHessian(positions);
+
+    qDebug() << "ANM Hessian" << H.nonZeros() << "non-zeros" << timer.elapsed() << "ms";
+
+    Lanczos(H, GetRigidBasis(positions), qMin(3 * size - 6, k));
+
+    qDebug() << "ANM modes" << eigenvalues << timer.elapsed() << "ms";
+}
+
+Eigen::SparseMatrix<double, Eigen::RowMajor> NormalModes::GetHessian(const QVector<QVector3D> &positions)
+{
+    int size = positions.size();
+
+    NeighbourGrid grid;
+    grid.Build(positions, cutoff);
+    auto pairs = grid.PairsQuery(cutoff);
+
+    // springs of each node (counting sort of the pairs in both directions)
+    QVector<int> starts(size + 1, 0);
+    for (auto pair : pairs)
+    {
+        starts[pair.first + 1] += 1;
+        starts[pair.second + 1] += 1;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        starts[i + 1] += starts[i];
+    }
+
+    QVector<int> neighbours(2 * pairs.size());
+    {
+        auto offsets = starts;
+        for (auto pair : pairs)
+        {
+            neighbours[offsets[pair.first]++] = pair.second;
+            neighbours[offsets[pair.second]++] = pair.first;
+        }
+    }
+
+    // super-elements : -(d d^T) / |d|^2 off the diagonal, minus their sum on the diagonal
+    auto GetBlock = [&] (int i, int j)
+    {
+        Eigen::Vector3d d = FromQVector3DToVector3f(positions[j] - positions[i]).cast<double>();
+        return Eigen::Matrix3d(-d * d.transpose() / d.squaredNorm());
+    };
+
+    Eigen::SparseMatrix<double, Eigen::RowMajor> H(3 * size, 3 * size);
+    H.reserve(9 * (size + neighbours.size()));
+
+    // rows in order, columns increasing within each row
+    for (int i = 0; i < size; i++)
+    {
+        auto first = neighbours.begin() + starts[i];
+        auto last = neighbours.begin() + starts[i + 1];
+        std::sort(first, last);
+
+        Eigen::Matrix3d diagonal = Eigen::Matrix3d::Zero();
+        for (auto j = first; j != last; j++)
+        {
+            diagonal -= GetBlock(i, *j);
+        }
+
+        // the diagonal block goes between the lower and the higher neighbours
+        auto middle = std::lower_bound(first, last, i);
+
+        for (int a = 0; a < 3; a++)
+        {
+            int row = 3 * i + a;
+            H.startVec(row);
+
+            for (auto j = first; j != middle; j++)
+            {
+                Eigen::Matrix3d block = GetBlock(i, *j);
+                for (int b = 0; b < 3; b++)
+                {
+                    H.insertBack(row, 3 * (*j) + b) = block(a, b);
+                }
+            }
+
+            for (int b = 0; b < 3; b++)
+            {
+                H.insertBack(row, 3 * i + b) = diagonal(a, b);
+            }
+
+            for (auto j = middle; j != last; j++)
+            {
+                Eigen::Matrix3d block = GetBlock(i, *j);
+                for (int b = 0; b < 3; b++)
+                {
+                    H.insertBack(row, 3 * (*j) + b) = block(a, b);
+                }
+            }
+        }
+    }
+    H.finalize();
+
+    return H;
+}
+
+Eigen::MatrixXd NormalModes::GetRigidBasis(const QVector<QVector3D> &positions)
+{
+    int size = positions.size();
+
+    QVector3D c = GetCentroid(positions);
+
+    Eigen::MatrixXd B(3 * size, 6);
+    for (int i = 0; i < size; i++)
+    {
+        Eigen::Vector3d p = FromQVector3DToVector3f(positions[i] - c).cast<double>();
+
+        B.block<3, 3>(3 * i, 0).setIdentity();
+        B.block<3, 1>(3 * i, 3) << 0, -p.z(), p.y();
+        B.block<3, 1>(3 * i, 4) << p.z(), 0, -p.x();
+        B.block<3, 1>(3 * i, 5) << -p.y(), p.x(), 0;
+    }
+
+    Eigen::HouseholderQR<Eigen::MatrixXd> QR(B);
+    return QR.householderQ() * Eigen::MatrixXd::Identity(3 * size, 6);
+}
+
+void NormalModes::Lanczos(const Eigen::SparseMatrix<double, Eigen::RowMajor> &H, const Eigen::MatrixXd &rigid, int count)
+{
+    int n = static_cast<int>(H.rows());
+
+    eigenvalues.clear();
+    modes.resize(0, 0);
+
+    if (count <= 0)
+    {
+        return;
+    }
+
+    // Gershgorin bound of the spectrum
+    double c = 0;
+    for (int row = 0; row < n; row++)
+    {
+        double sum = 0;
+        for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(H, row); it; ++it)
+        {
+            sum += std::abs(it.value());
+        }
+        c = qMax(c, sum);
+    }
+
+    // basis size, and Ritz vectors kept across restarts
+    int m = qMin(n - 6, qMax(2 * count + 20, count + 40));
+    int keep = count + (m - count) / 2;
+
+    // V : orthonormal basis, W = (c I - H) V
+    Eigen::MatrixXd V(n, m);
+    Eigen::MatrixXd W(n, m);
+    Eigen::VectorXd theta;
+
+    auto Deflate = [&] (Eigen::VectorXd &x)
+    {
+        x -= rigid * (rigid.transpose() * x);
+    };
+
+    std::mt19937 generator(0);
+    std::normal_distribution<double> distribution;
+
+    Eigen::VectorXd v(n);
+    for (int i = 0; i < n; i++)
+    {
+        v(i) = distribution(generator);
+    }
+    Deflate(v);
+    v.normalize();
+
+    int kept = 0;
+    const int MaxRestarts = 200;
+
+    for (int restart = 0; restart < MaxRestarts; restart++)
+    {
+        // Krylov extension from the last residual direction
+        for (int j = kept; j < m; j++)
+        {
+            V.col(j) = v;
+            W.col(j) = c * v - H * v;
+
+            Eigen::VectorXd w = W.col(j);
+
+            for (int attempt = 0; attempt < 2; attempt++)
+            {
+                // full reorthogonalization (twice is enough), the deflation comes last
+                // so that the rigid body components are not amplified back
+                for (int pass = 0; pass < 2; pass++)
+                {
+                    w -= V.leftCols(j + 1) * (V.leftCols(j + 1).transpose() * w);
+                    Deflate(w);
+                }
+
+                // invariant subspace : continue from a random direction
+                if (w.norm() > 1e-10 * c)
+                {
+                    break;
+                }
+
+                for (int i = 0; i < n; i++)
+                {
+                    w(i) = distribution(generator);
+                }
+            }
+
+            v = w.normalized();
+        }
+
+        // Rayleigh-Ritz on the basis
+        Eigen::MatrixXd G = V.transpose() * W;
+        G = 0.5 * (G + G.transpose());
+
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigensolver(G);
+
+        // largest first
+        Eigen::MatrixXd S = eigensolver.eigenvectors().rightCols(keep).rowwise().reverse();
+        theta = eigensolver.eigenvalues().tail(keep).reverse();
+
+        Eigen::MatrixXd X = V * S;
+        Eigen::MatrixXd Y = W * S;
+
+        double residual = 0;
+        for (int i = 0; i < count; i++)
+        {
+            residual = qMax(residual, (Y.col(i) - theta(i) * X.col(i)).norm());
+        }
+
+        V.leftCols(keep) = X;
+        W.leftCols(keep) = Y;
+        kept = keep;
+
+        if (residual < 1e-6 * c)
+        {
+            qDebug() << "ANM Lanczos converged after" << restart + 1 << "restarts";
+            break;
+        }
+    }
+
+    modes.resize(n, count);
+    for (int i = 0; i < count; i++)
+    {
+        eigenvalues += static_cast<float>(c - theta(i));
+        modes.col(i) = V.col(i).cast<float>();
+    }
+}
+
+bool NormalModes::isEmpty() const
+{
+    return eigenvalues.isEmpty();
+}
+
+QVector<QVector3D> NormalModes::GetModeDisplacements(int mode, int step) const
+{
+    QVector<QVector3D> displacements;
+
+    if (mode < 0 || mode >= modes.cols() || step < 0 || step >= trajectory->models.size())
+    {
+        return displacements;
+    }
+
+    // the spring constant is arbitrary, the modes are scaled to 1 Angstrom RMS per atom
+    float amplitude = std::sqrt(static_cast<float>(selection.size()));
+
+    // modes live in the frame of the network model
+    auto a = trajectory->GetPositions(this->step, selection);
+    auto b = trajectory->GetPositions(step, selection);
+
+    QVector3D ca = GetCentroid(a);
+    QVector3D cb = GetCentroid(b);
+
+    QVector<Eigen::Vector3f> x, y;
+    for (int i = 0; i < selection.size(); i++)
+    {
+        x += FromQVector3DToVector3f(a[i] - ca);
+        y += FromQVector3DToVector3f(b[i] - cb);
+    }
+
+    // R superposes the model on the network model, its transpose brings the modes back
+    Eigen::Matrix3f R = trajectory->GetRotateMatrix(x, y).transpose();
+
+    for (int i = 0; i < selection.size(); i++)
+    {
+        Eigen::Vector3f d = modes.block<3, 1>(3 * i, mode) * amplitude;
+        displacements += FromVector3fToQVector3D(R * d);
+    }
+
+    return displacements;
+}
@@ -0,0 +1,55 @@
+#ifndef NORMALMODES_H
+#define NORMALMODES_H
+
+#include <random>
+
+#include <QtConcurrent>
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+#include "trajectory.h"
+#include "neighbourgrid.h"
+#include "utility.h"
+using namespace utility;
+
+// anisotropic network model : the selection atoms of a single model are nodes,
+// joined by springs (all of the same constant) when closer than the cutoff
+class NormalModes
+{
+public:
+    NormalModes(Trajectory *trajectory);
+
+    QVector<int> selection;
+    // model the network is built on
+    int step;
+    // springs cutoff (in Angstrom)
+    float cutoff;
+
+    // nonzero eigenvalues of the Hessian, increasing (the 6 rigid body modes are left out)
+    QVector<float> eigenvalues;
+    // unit modes (3N x k, x y z of each atom)
+    Eigen::MatrixXf modes;
+
+    void Compute(QVector<int> selection, int step, float cutoff = 15.0f, int k = 10);
+
+    bool isEmpty() const;
+
+    // mode displacements of the selection atoms (1 Angstrom RMS), in the frame of a model
+    QVector<QVector3D> GetModeDisplacements(int mode, int step) const;
+
+private:
+    Trajectory *trajectory;
+
+    // sparse Hessian (row-major, so that the products run across threads), built row by row from the grid pairs
+    Eigen::SparseMatrix<double, Eigen::RowMajor> GetHessian(const QVector<QVector3D> &positions);
+    // orthonormal basis of the rigid body motions (3 translations, 3 rotations)
+    Eigen::MatrixXd GetRigidBasis(const QVector<QVector3D> &positions);
+
+    // thick-restart Lanczos on (c I - H), c bounding the spectrum of H,
+    // so that the largest eigenvalues found are the lowest of H,
+    // with the rigid body motions projected out of the Krylov basis
+    void Lanczos(const Eigen::SparseMatrix<double, Eigen::RowMajor> &H, const Eigen::MatrixXd &rigid, int count);
+};
+
+#endif // NORMALMODES_H
@@ -0,0 +1,105 @@
+#include "observable.h"
+
+Observable::Observable()
+{
+    type = RADIUS_OF_GYRATION;
+    MinValue = NAN;
+    MaxValue = NAN;
+}
+
+std::ostream& operator<<(std::ostream& os, const Observable& observable)
+{
+    QStringList attributes;
+    attributes += QString("%1").arg(observable.type);
+    attributes += QString("%1").arg(observable.groups.size());
+    attributes += QString("%1").arg(observable.values.size());
+    attributes += QString("%1").arg(observable.MinValue);
+    attributes += QString("%1").arg(observable.MaxValue);
+
+    os << QString("Observable %1 (%2)").arg(observable.name).arg(attributes.join(", ")).toStdString();
+    return os;
+}
+
+float Observable::Evaluate(const QVector<QVector<QVector3D>> &positions) const
+{
+    switch (type)
+    {
+    case RADIUS_OF_GYRATION:
+    {
+        auto x = positions.value(0);
+
+        if (x.isEmpty())
+        {
+            return NAN;
+        }
+
+        QVector3D c = GetCentroid(x);
+
+        float sum = 0;
+        for (auto v : x)
+        {
+            sum += (v - c).lengthSquared();
+        }
+
+        return std::sqrt(sum / x.size());
+    }
+    case END_TO_END_DISTANCE:
+    case CENTROIDS_DISTANCE:
+    {
+        auto a = positions.value(0);
+        auto b = positions.value(1);
+
+        if (a.isEmpty() || b.isEmpty())
+        {
+            return NAN;
+        }
+
+        return (GetCentroid(a) - GetCentroid(b)).length();
+    }
+    case MIN_DISTANCE:
+    {
+        auto a = positions.value(0);
+        auto b = positions.value(1);
+
+        if (a.isEmpty() || b.isEmpty())
+        {
+            return NAN;
+        }
+
+        float min = FLT_MAX;
+        for (auto u : a)
+        {
+            for (auto v : b)
+            {
+                min = qMin(min, (u - v).lengthSquared());
+            }
+        }
+
+        return std::sqrt(min);
+    }
+    }
+
+    return NAN;
+}
+
+QString Observable::PackedData()
+{
+    QStringList list;
+
+    // names are single tokens in the cooked data
+    list += QString(name).replace(" ", "_");
+    list += QString::number(type);
+
+    QStringList packed;
+    for (auto group : groups)
+    {
+        packed += PackNumbers(group);
+    }
+    list += packed.join("|");
+
+    list += PackNumbers(values);
+    list += QString::number(MinValue);
+    list += QString::number(MaxValue);
+
+    return list.join(" ");
+}
@@ -0,0 +1,45 @@
+#ifndef OBSERVABLE_H
+#define OBSERVABLE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QVector3D>
+
+#include "utility.h"
+using namespace utility;
+
+enum ObservableType
+{
+    RADIUS_OF_GYRATION,     // one group
+    END_TO_END_DISTANCE,    // two single atom groups
+    CENTROIDS_DISTANCE,     // two groups
+    MIN_DISTANCE            // two groups : closest atoms pair
+};
+
+// per-frame scalar quantity of atom groups
+class Observable
+{
+public:
+    Observable();
+
+    QString name;
+    ObservableType type;
+
+    // atoms numbers of each group
+    QVector<QVector<int>> groups;
+
+    // one value per model
+    QVector<float> values;
+    float MinValue;
+    float MaxValue;
+
+    // value from the positions of the groups atoms (same order as groups)
+    float Evaluate(const QVector<QVector<QVector3D>> &positions) const;
+
+    QString PackedData();
+
+    friend std::ostream& operator<<(std::ostream& os, const Observable& observable);
+};
+
+#endif // OBSERVABLE_H
@@ -1,6 +1,6 @@
 #include "openglwidget.h"
 
-OpenGLWidget::OpenGLWidget(QWidget *parent) : QOpenGLWidget(parent)
+OpenGLWidget::OpenGLWidget(QWidget *parent) : QOpenGLWidget(parent), clustering(&trajectory), contacts(&trajectory), hbonds(&trajectory), bonds(&trajectory), structure(&trajectory), surface(&trajectory), pca(&trajectory), correlation(&trajectory), ligand(&trajectory), anm(&trajectory), rdf(&trajectory), dihedrals(&trajectory), electrostatics(&trajectory), neighbours(&trajectory), density(&trajectory)
 {
     // screen geometry
     int w = geometry().width();
@@ -38,6 +38,42 @@ OpenGLWidget::OpenGLWidget(QWidget *parent) : QOpenGLWidget(parent)
     trajectory.LoadCookedData();
     PointsCount = trajectory.atoms.size();
 
+    // analyses : the models feed everything, the cooked statistics and observables are loaded up to date,
+    // the products with user parameters wait for them (MainWindow tabs)
+    analyses.AddNode("models", {});
+    analyses.AddNode("statistics", {"models"});
+    SetStatisticsParameters(trajectory.AverageReference, trajectory.CompactRMSDs, trajectory.OnlineStatistics);
+    analyses.AddNode("observables", {"models"}, [=] () { trajectory.ComputeObservables(); });
+    analyses.Validate("models");
+    analyses.Validate("statistics");
+    analyses.Validate("observables");
+
+    analyses.AddNode("structure", {"models"}, [=] () { structure.Compute(); });
+    // topology : perceived once on the first model, whatever the models
+    analyses.AddNode("bonds", {}, [=] () { bonds.Compute(0); });
+    analyses.AddNode("dihedrals", {"models"}, [=] () { dihedrals.Compute(); });
+
+    analyses.AddNode("clustering", {"models"});
+    analyses.AddNode("contacts", {"models"});
+    analyses.AddNode("hbonds", {"models"});
+    analyses.AddNode("surface", {"models"});
+    analyses.AddNode("pca", {"models"});
+    analyses.AddNode("ligand", {"models"});
+    analyses.AddNode("anm", {"models"});
+    analyses.AddNode("rdf", {"models"});
+    analyses.AddNode("electrostatics", {"models"});
+    {
+        float cutoff = electrostatics.cutoff;
+        float dielectric = electrostatics.dielectric;
+        analyses.SetParameters("electrostatics", QString("%1;%2").arg(cutoff).arg(dielectric), [=] () { electrostatics.SetParameters(cutoff, dielectric); });
+        analyses.Validate("electrostatics");
+    }
+    // the atoms cross-correlation reads the atoms RMSDs
+    analyses.AddNode("correlation", {"statistics"});
+    // the frames superposition is kept, a new selection only accumulates again
+    analyses.AddNode("density alignment", {"models"});
+    analyses.AddNode("density", {"density alignment"});
+
     // playback
     playback.active = false;
     playback.step = 0;
@@ -77,6 +113,17 @@ OpenGLWidget::OpenGLWidget(QWidget *parent) : QOpenGLWidget(parent)
     outline.size = 5;
     outline.thickness = 3;
     outline.boundary = BoundaryValues::absolute;
+    outline.window = 25;
+    outline.reference = 0;
+    outline.dihedral = PHI;
+
+    animation.active = false;
+    animation.source = PRINCIPAL_COMPONENTS;
+    animation.mode = 0;
+    animation.amplitude = 3.0f;
+    animation.period = 2.0f;
+    animation.UpdateFlag = false;
+    animation.time.start();
     SetOutlineColor();
 
     // frame rate
@@ -102,58 +149,7 @@ void OpenGLWidget::initializeGL()
     SetClearColor(BackgroundColor);
 
     // VAOs
-    {
-        auto VAOsData = trajectory.GetVAOsData();
-        VAOs.resize(VAOsData.size());
-
-        int index = 0;
-        for (auto data : VAOsData)
-        {
-            glGenVertexArrays(1, &(VAOs[index]));
-
-            GLuint vbo;
-            glGenBuffers(1, &vbo);
-            glBindBuffer(GL_ARRAY_BUFFER, vbo);
-            GLsizei stride = sizeof(VertexData);
-            GLsizeiptr size = data.size() * static_cast<GLsizeiptr>(stride);
-            glBufferData(GL_ARRAY_BUFFER, size, &(data[0]), GL_STATIC_DRAW);
-
-            unsigned int bytes;
-            const void* offset;
-
-            glBindVertexArray(VAOs[index]);
-            {
-                // center
-                bytes = 0;
-                offset = nullptr;
-                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, offset);
-                glEnableVertexAttribArray(0);
-                // radius
-                bytes += sizeof(VertexData::center);
-                offset = reinterpret_cast<const void*>(bytes);
-                glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, offset);
-                glEnableVertexAttribArray(1);
-                // albedo
-                bytes += sizeof(VertexData::radius);
-                offset = reinterpret_cast<const void*>(bytes);
-                glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, offset);
-                glEnableVertexAttribArray(2);
-                // atom and residue number
-                bytes += sizeof(VertexData::albedo);
-                offset = reinterpret_cast<const void*>(bytes);
-                // glVertexAttribPointer(3, 1, GL_INT, GL_FALSE, stride, offset);
-                // glVertexAttribPointer(3, 1, GL_UNSIGNED_INT, GL_FALSE, stride, offset);
-                // glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, offset);
-                glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, offset);
-                glEnableVertexAttribArray(3);
-            }
-            glBindVertexArray(0);
-
-            glDeleteBuffers(1, &vbo);
-
-            index += 1;
-        }
-    }
+    SetModelVAOs();
 
     // framebuffers
     {
@@ -345,6 +341,13 @@ void OpenGLWidget::paintGL()
     view.setToIdentity();
     view.lookAt(camera.eye, camera.center, camera.up);
 
+    // principal component displacements of the current model
+    if (animation.active && (animation.UpdateFlag || ModeStep != playback.step))
+    {
+        SetModeDisplacements();
+        animation.UpdateFlag = false;
+    }
+
     /* #################### geometry #################### */
 
     glBindFramebuffer(GL_FRAMEBUFFER, addFBO(FBOIndex::GEOMETRY));
@@ -362,6 +365,21 @@ void OpenGLWidget::paintGL()
 
         // draw geometry
         DrawImpostors();
+
+        if (HydrogenBondsVisible)
+        {
+            DrawHydrogenBonds();
+        }
+
+        if (BondsVisible)
+        {
+            DrawBonds();
+        }
+
+        if (DensityVisible)
+        {
+            DrawDensity();
+        }
     }
     glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
 
@@ -491,7 +509,7 @@ void OpenGLWidget::paintGL()
     {
         if (playback.active)
         {
-            playback.step = (playback.step + 1) % playback.size;
+            playback.step = GetNextStep(playback);
             emit NextStepSignal();
         }
         playback.time.restart();
@@ -778,6 +796,12 @@ GLuint OpenGLWidget::addProgram(int index)
             geometry = true;
             break;
         }
+        case ProgramIndex::HBOND:
+        {
+            prefix += "hbond";
+            geometry = true;
+            break;
+        }
         }
 
         std::string vert = prefix + "_vert.glsl";
@@ -1251,7 +1275,7 @@ void OpenGLWidget::DrawPoints()
     glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, view.constData());
     glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, projection.constData());
 
-    glUniform1i(glGetUniformLocation(program, "OutlineMode"), outline.mode);
+    glUniform1i(glGetUniformLocation(program, "OutlineLevel"), GetOutlineLevel(outline.mode));
 
     // addTexture(TextureIndex::OUTLINE);
 
@@ -1282,6 +1306,10 @@ void OpenGLWidget::DrawImpostors()
     // glUniform1i(glGetUniformLocation(program, "OutlineTexture"), 0);
 
     glUniform1i(glGetUniformLocation(program, "grayscale"), outline.active && outline.grayscale);
+    // balls and sticks
+    glUniform1f(glGetUniformLocation(program, "RadiusScale"), BondsVisible ? 0.3f : 1.0f);
+
+    SetModeUniforms(program);
 
     // glActiveTexture(GL_TEXTURE0);
     // glBindTexture(GL_TEXTURE_1D, textures[TextureIndex::OUTLINE]);
@@ -1293,6 +1321,251 @@ void OpenGLWidget::DrawImpostors()
     glBindVertexArray(0);
 }
 
+void OpenGLWidget::DrawHydrogenBonds()
+{
+    // bonds of previous models are not drawn over the current ones
+    if (!analyses.isValid("hbonds"))
+    {
+        return;
+    }
+
+    auto indices = hbonds.GetLineIndices(playback.step);
+
+    if (indices.isEmpty())
+    {
+        return;
+    }
+
+    GLuint program = addProgram(ProgramIndex::HBOND);
+    glUseProgram(program);
+
+    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, model.constData());
+    glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, view.constData());
+    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, projection.constData());
+
+    QVector3D color = FromQColorToQVector3D("#55ffff");
+    glUniform1f(glGetUniformLocation(program, "width"), 0.08f);
+    glUniform1i(glGetUniformLocation(program, "solid"), false);
+    glUniform3fv(glGetUniformLocation(program, "BondColor"), 1, &(color[0]));
+    glUniform1i(glGetUniformLocation(program, "grayscale"), outline.active && outline.grayscale);
+
+    SetModeUniforms(program);
+
+    if (HydrogenBondsEBO == 0)
+    {
+        glGenBuffers(1, &HydrogenBondsEBO);
+    }
+
+    // the lines endpoints are the atoms of the current model VAO
+    GLuint vao = VAOs[playback.step];
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, HydrogenBondsEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.constData(), GL_DYNAMIC_DRAW);
+    glDrawElements(GL_LINES, indices.size(), GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(0);
+}
+
+void OpenGLWidget::DrawBonds()
+{
+    if (bonds.isEmpty())
+    {
+        return;
+    }
+
+    GLuint program = addProgram(ProgramIndex::HBOND);
+    glUseProgram(program);
+
+    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, model.constData());
+    glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, view.constData());
+    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, projection.constData());
+
+    QVector3D color = FromQColorToQVector3D("#b0b0b0");
+    glUniform1f(glGetUniformLocation(program, "width"), 0.15f);
+    glUniform1i(glGetUniformLocation(program, "solid"), true);
+    glUniform3fv(glGetUniformLocation(program, "BondColor"), 1, &(color[0]));
+    glUniform1i(glGetUniformLocation(program, "grayscale"), outline.active && outline.grayscale);
+
+    SetModeUniforms(program);
+
+    if (BondsEBO == 0)
+    {
+        glGenBuffers(1, &BondsEBO);
+    }
+
+    // the lines endpoints are the atoms of the current model VAO
+    GLuint vao = VAOs[playback.step];
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, BondsEBO);
+
+    if (BondsEBOSize != bonds.pairs.size())
+    {
+        auto indices = bonds.GetLineIndices();
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.constData(), GL_STATIC_DRAW);
+        BondsEBOSize = indices.size();
+    }
+
+    glDrawElements(GL_LINES, BondsEBOSize, GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(0);
+}
+
+void OpenGLWidget::SetModelVAOs()
+{
+    if (!VAOs.isEmpty())
+    {
+        glDeleteVertexArrays(VAOs.size(), VAOs.constData());
+        VAOs.clear();
+    }
+
+    for (const auto &data : trajectory.GetVAOsData())
+    {
+        VAOs += CreateVAO(data);
+    }
+}
+
+GLuint OpenGLWidget::CreateVAO(const ModelData &data)
+{
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+
+    GLuint vbo;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    GLsizei stride = sizeof(VertexData);
+    GLsizeiptr size = data.size() * static_cast<GLsizeiptr>(stride);
+    glBufferData(GL_ARRAY_BUFFER, size, data.constData(), GL_STATIC_DRAW);
+
+    unsigned int bytes;
+    const void* offset;
+
+    glBindVertexArray(vao);
+    {
+        // center
+        bytes = 0;
+        offset = nullptr;
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, offset);
+        glEnableVertexAttribArray(0);
+        // radius
+        bytes += sizeof(VertexData::center);
+        offset = reinterpret_cast<const void*>(bytes);
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, offset);
+        glEnableVertexAttribArray(1);
+        // albedo
+        bytes += sizeof(VertexData::radius);
+        offset = reinterpret_cast<const void*>(bytes);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, offset);
+        glEnableVertexAttribArray(2);
+        // atom and residue number
+        bytes += sizeof(VertexData::albedo);
+        offset = reinterpret_cast<const void*>(bytes);
+        // glVertexAttribPointer(3, 1, GL_INT, GL_FALSE, stride, offset);
+        // glVertexAttribPointer(3, 1, GL_UNSIGNED_INT, GL_FALSE, stride, offset);
+        // glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, offset);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, offset);
+        glEnableVertexAttribArray(3);
+    }
+    glBindVertexArray(0);
+
+    glDeleteBuffers(1, &vbo);
+
+    return vao;
+}
+
+void OpenGLWidget::SetDensityVAO()
+{
+    if (DensityVAO != 0)
+    {
+        glDeleteVertexArrays(1, &DensityVAO);
+        DensityVAO = 0;
+    }
+
+    auto data = density.GetVertices(DensityLevel * density.MaxValue, DensitySurface);
+    DensityPointsCount = data.size();
+
+    if (DensityPointsCount > 0)
+    {
+        DensityVAO = CreateVAO(data);
+    }
+}
+
+void OpenGLWidget::DrawDensity()
+{
+    // no density of previous models over the current ones
+    if (DensityVAO == 0 || !analyses.isValid("density"))
+    {
+        return;
+    }
+
+    GLuint program = addProgram(ProgramIndex::IMPOSTOR);
+    glUseProgram(program);
+
+    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, model.constData());
+    glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, view.constData());
+    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, projection.constData());
+
+    // the cells keep their colours and sizes, and do not follow the modes
+    glUniform1i(glGetUniformLocation(program, "grayscale"), false);
+    glUniform1f(glGetUniformLocation(program, "RadiusScale"), 1.0f);
+    glUniform1i(glGetUniformLocation(program, "ModeAnimation"), false);
+
+    glBindVertexArray(DensityVAO);
+    glDrawArrays(GL_POINTS, 0, DensityPointsCount);
+    glBindVertexArray(0);
+}
+
+void OpenGLWidget::SetModeDisplacements()
+{
+    // one displacement per vertex, in the atoms order of the models VAOs
+    QVector<QVector4D> displacements(PointsCount);
+
+    auto keys = trajectory.models.value(playback.step).keys();
+
+    bool components = (animation.source == PRINCIPAL_COMPONENTS);
+    auto selection = components ? pca.selection : anm.selection;
+    auto values = components ? pca.GetModeDisplacements(animation.mode, playback.step) : anm.GetModeDisplacements(animation.mode, playback.step);
+
+    for (int i = 0; i < values.size(); i++)
+    {
+        // keys are sorted
+        auto it = std::lower_bound(keys.begin(), keys.end(), selection[i]);
+        int index = (it != keys.end() && *it == selection[i]) ? static_cast<int>(it - keys.begin()) : -1;
+
+        if (0 <= index && index < displacements.size())
+        {
+            displacements[index] = QVector4D(values[i], 0.0f);
+        }
+    }
+
+    if (ModeSSBO == 0)
+    {
+        glGenBuffers(1, &ModeSSBO);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ModeSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, displacements.size() * sizeof(QVector4D), displacements.constData(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    ModeStep = playback.step;
+}
+
+void OpenGLWidget::SetModeUniforms(GLuint program)
+{
+    bool active = animation.active && (ModeSSBO != 0);
+
+    // oscillation between -amplitude and +amplitude standard deviations
+    float t = animation.time.elapsed() * 0.001f / animation.period;
+    float scale = animation.amplitude * std::sin(2.0f * static_cast<float>(M_PI) * t);
+
+    glUniform1i(glGetUniformLocation(program, "ModeAnimation"), active);
+    glUniform1f(glGetUniformLocation(program, "ModeScale"), scale);
+
+    if (active)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ModeSSBO);
+    }
+}
+
 void OpenGLWidget::DrawOcclusion()
 {
     GLuint program = addProgram(ProgramIndex::SSAO_OCCLUSION);
@@ -1414,7 +1687,12 @@ void OpenGLWidget::DrawSilhouette()
     glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, view.constData());
     glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, projection.constData());
 
-    glUniform1i(glGetUniformLocation(program, "OutlineMode"), outline.mode);
+    glUniform1i(glGetUniformLocation(program, "OutlineLevel"), GetOutlineLevel(outline.mode));
+
+    // same spheres as the impostors
+    glUniform1f(glGetUniformLocation(program, "RadiusScale"), BondsVisible ? 0.3f : 1.0f);
+
+    SetModeUniforms(program);
 
     GLuint vao = VAOs[playback.step];
 
@@ -1717,8 +1995,40 @@ void OpenGLWidget::SetOutlineColor(bool flag)
 }
 */
 
+void OpenGLWidget::SetStatisticsParameters(bool average, bool compact, bool online)
+{
+    auto compute = [=] ()
+    {
+        trajectory.AverageReference = average;
+        trajectory.CompactRMSDs = compact;
+        // single pass without the RMSDs histories
+        trajectory.OnlineStatistics = online;
+        trajectory.StoreRMSDs = !online;
+        trajectory.Recook();
+    };
+
+    analyses.SetParameters("statistics", QString("%1;%2;%3").arg(average).arg(compact).arg(online), compute);
+}
+
 void OpenGLWidget::SetOutlineColor(bool flag)
 {
+    // the product behind the mode is brought up to date (computed on first use),
+    // the RMSD and RMSF modes read the statistics
+    static const QMap<OutlineMode, QString> nodes =
+    {
+        {RESIDUE_CONTACTS, "contacts"},
+        {RESIDUE_SECONDARY_STRUCTURE, "structure"},
+        {RESIDUE_SASA, "surface"},
+        {RESIDUE_CROSS_CORRELATION, "correlation"},
+        {RESIDUE_LIGAND_DISTANCE, "ligand"},
+        {RESIDUE_LIGAND_RESIDENCE, "ligand"},
+        {RESIDUE_DIHEDRAL, "dihedrals"},
+        {RESIDUE_DIHEDRAL_VARIANCE, "dihedrals"},
+        {RESIDUE_POTENTIAL, "electrostatics"},
+        {ATOM_POTENTIAL, "electrostatics"}
+    };
+    analyses.Require(nodes.value(outline.mode, "statistics"));
+
     ColorScheme scheme;
 
     outline.schemes.clear();
@@ -1800,7 +2110,7 @@ void OpenGLWidget::SetOutlineColor(bool flag)
             {
                 Residue residue = trajectory.residues[number];
 
-                float value = residue.RMSDs[playback.step];
+                float value = residue.RMSDs.value(playback.step, NAN);
                 // outline.colours[number] = FromQColorToQVector3D(GetColorStep(scheme, value).color);
                 outline.colours[number] = FilterColor(GetColorStep(scheme, value));
             }
@@ -1821,7 +2131,7 @@ void OpenGLWidget::SetOutlineColor(bool flag)
 
                 outline.schemes[number] = scheme;
 
-                float value = residue.RMSDs[playback.step];
+                float value = residue.RMSDs.value(playback.step, NAN);
                 // outline.colours[number] = FromQColorToQVector3D(GetColorStep(scheme, value).color);
                 outline.colours[number] = FilterColor(GetColorStep(scheme, value));
             }
@@ -1887,11 +2197,14 @@ void OpenGLWidget::SetOutlineColor(bool flag)
 
             outline.schemes += scheme;
 
-            for (auto number : list)
+            // stored or derived RMSD vectors, in atoms order as list
+            auto RMSDs = trajectory.GetAtomsRMSDs(playback.step);
+
+            for (int i = 0; i < list.size(); i++)
             {
-                Atom atom = trajectory.atoms[number];
+                int number = list[i];
 
-                float value = atom.RMSDs[playback.step].lengthSquared();
+                float value = RMSDs[i].lengthSquared();
                 // outline.colours[number] = FromQColorToQVector3D(GetColorStep(scheme, value).color);
                 outline.colours[number] = FilterColor(GetColorStep(scheme, value));
             }
@@ -1902,8 +2215,11 @@ void OpenGLWidget::SetOutlineColor(bool flag)
         {
             outline.schemes.resize(MaxNumber + 1);
 
-            for (auto number : list)
+            auto RMSDs = trajectory.GetAtomsRMSDs(playback.step);
+
+            for (int i = 0; i < list.size(); i++)
             {
+                int number = list[i];
                 Atom atom = trajectory.atoms[number];
 
                 float min = atom.MinRMSD;
@@ -1912,7 +2228,7 @@ void OpenGLWidget::SetOutlineColor(bool flag)
 
                 outline.schemes[number] = scheme;
 
-                float value = atom.RMSDs[playback.step].lengthSquared();
+                float value = RMSDs[i].lengthSquared();
                 // outline.colours[number] = FromQColorToQVector3D(GetColorStep(scheme, value).color);
                 outline.colours[number] = FilterColor(GetColorStep(scheme, value));
             }
@@ -1922,6 +2238,319 @@ void OpenGLWidget::SetOutlineColor(bool flag)
 
         break;
     }
+    case RESIDUE_WINDOW_RMSF:
+    {
+        // the window average of the RMSDs is bounded by their Min and Max values
+
+        auto list = trajectory.residues.keys();
+        int MaxNumber = *std::max_element(list.begin(), list.end());
+
+        outline.colours.resize(MaxNumber + 1);
+
+        switch (outline.boundary)
+        {
+        case absolute:
+        {
+            float min = trajectory.MinResiduesRMSD;
+            float max = trajectory.MaxResiduesRMSD;
+            scheme = GetColorScheme(min, max, outline.palette, outline.size);
+
+            outline.schemes += scheme;
+
+            for (auto number : list)
+            {
+                Residue &residue = trajectory.residues[number];
+
+                float value = residue.GetWindowRMSF(playback.step, outline.window);
+                outline.colours[number] = FilterColor(GetColorStep(scheme, value));
+            }
+
+            break;
+        }
+        case relative:
+        {
+            outline.schemes.resize(MaxNumber + 1);
+
+            for (auto number : list)
+            {
+                Residue &residue = trajectory.residues[number];
+
+                float min = residue.MinRMSD;
+                float max = residue.MaxRMSD;
+                scheme = GetColorScheme(min, max, outline.palette, outline.size);
+
+                outline.schemes[number] = scheme;
+
+                float value = residue.GetWindowRMSF(playback.step, outline.window);
+                outline.colours[number] = FilterColor(GetColorStep(scheme, value));
+            }
+            break;
+        }
+        }
+
+        break;
+    }
+    case ATOM_WINDOW_RMSF:
+    {
+        auto list = trajectory.atoms.keys();
+        int MaxNumber = *std::max_element(list.begin(), list.end());
+
+        outline.colours.resize(MaxNumber + 1);
+
+        switch (outline.boundary)
+        {
+        case absolute:
+        {
+            float min = trajectory.MinAtomsRMSD;
+            float max = trajectory.MaxAtomsRMSD;
+            scheme = GetColorScheme(min, max, outline.palette, outline.size);
+
+            outline.schemes += scheme;
+
+            for (auto number : list)
+            {
+                float value = trajectory.GetAtomWindowRMSF(playback.step, number, outline.window);
+                outline.colours[number] = FilterColor(GetColorStep(scheme, value));
+            }
+
+            break;
+        }
+        case relative:
+        {
+            outline.schemes.resize(MaxNumber + 1);
+
+            for (auto number : list)
+            {
+                Atom &atom = trajectory.atoms[number];
+
+                float min = atom.MinRMSD;
+                float max = atom.MaxRMSD;
+                scheme = GetColorScheme(min, max, outline.palette, outline.size);
+
+                outline.schemes[number] = scheme;
+
+                float value = trajectory.GetAtomWindowRMSF(playback.step, number, outline.window);
+                outline.colours[number] = FilterColor(GetColorStep(scheme, value));
+            }
+            break;
+        }
+        }
+
+        break;
+    }
+    case RESIDUE_CONTACTS:
+    {
+        // contact frequency with the reference residue, or mean number of contacts without reference
+
+        auto list = trajectory.residues.keys();
+        int MaxNumber = *std::max_element(list.begin(), list.end());
+
+        outline.colours.resize(MaxNumber + 1);
+
+        switch (outline.boundary)
+        {
+        case absolute:
+        case relative:
+        {
+            bool reference = trajectory.residues.contains(outline.reference);
+
+            float min = 0;
+            float max = reference ? 1 : contacts.GetMaxContactsNumber();
+            scheme = GetColorScheme(min, max, outline.palette, outline.size);
+
+            outline.schemes += scheme;
+
+            for (auto number : list)
+            {
+                float value = reference ? contacts.GetFrequency(outline.reference, number) : contacts.GetContactsNumber(number);
+                outline.colours[number] = FilterColor(GetColorStep(scheme, value));
+            }
+
+            break;
+        }
+        }
+
+        break;
+    }
+    case RESIDUE_SECONDARY_STRUCTURE:
+    {
+        // one colour per state, boundary values do not apply
+
+        auto list = trajectory.residues.keys();
+        int MaxNumber = *std::max_element(list.begin(), list.end());
+
+        outline.colours.resize(MaxNumber + 1);
+
+        scheme = SecondaryStructure::GetStatesScheme();
+        outline.schemes += scheme;
+
+        for (auto number : list)
+        {
+            float value = structure.isEmpty() ? NAN : SecondaryStructure::GetStateValue(structure.GetState(playback.step, number));
+            outline.colours[number] = FilterColor(GetColorStep(scheme, value));
+        }
+
+        break;
+    }
+    case RESIDUE_SASA:
+    {
+        auto list = trajectory.residues.keys();
+        int MaxNumber = *std::max_element(list.begin(), list.end());
+
+        outline.colours.resize(MaxNumber + 1);
+
+        switch (outline.boundary)
+        {
+        case absolute:
+        {
+            float min = surface.MinResiduesSASA;
+            float max = surface.MaxResiduesSASA;
+            scheme = GetColorScheme(min, max, outline.palette, outline.size);
+
+            outline.schemes += scheme;
+
+            for (auto number : list)
+            {
+                float value = surface.GetSASA(playback.step, number);
+                outline.colours[number] = FilterColor(GetColorStep(scheme, value));
+            }
+
+            break;
+        }
+        case relative:
+        {
+            outline.schemes.resize(MaxNumber + 1);
+
+            for (auto number : list)
+            {
+                float min = surface.GetMinSASA(number);
+                float max = surface.GetMaxSASA(number);
+                scheme = GetColorScheme(min, max, outline.palette, outline.size);
+
+                outline.schemes[number] = scheme;
+
+                float value = surface.GetSASA(playback.step, number);
+                outline.colours[number] = FilterColor(GetColorStep(scheme, value));
+            }
+            break;
+        }
+        }
+
+        break;
+    }
+    case RESIDUE_CROSS_CORRELATION:
+    {
+        // correlation with the reference residue, from -1 (anti-correlated) to +1 (correlated)
+
+        auto list = trajectory.residues.keys();
+        int MaxNumber = *std::max_element(list.begin(), list.end());
+
+        outline.colours.resize(MaxNumber + 1);
+
+        scheme = GetColorScheme(-1, 1, outline.palette, outline.size);
+        scheme.first().min = -FLT_MAX;
+
+        outline.schemes += scheme;
+
+        for (auto number : list)
+        {
+            float value = correlation.GetCorrelation(outline.reference, number);
+            outline.colours[number] = FilterColor(GetColorStep(scheme, value));
+        }
+
+        break;
+    }
+    case RESIDUE_LIGAND_DISTANCE:
+    case RESIDUE_LIGAND_RESIDENCE:
+    {
+        // distance : closeness to the ligand in step (twice the cutoff minus the closest ligand atom distance)
+        // residence : mean length (in frames) of the uninterrupted contacts with the ligand
+
+        auto list = trajectory.residues.keys();
+        int MaxNumber = *std::max_element(list.begin(), list.end());
+
+        outline.colours.resize(MaxNumber + 1);
+
+        bool distance = (outline.mode == RESIDUE_LIGAND_DISTANCE);
+
+        float min = 0;
+        float max = distance ? 2 * ligand.cutoff : ligand.GetMaxResidenceTime();
+        scheme = GetColorScheme(min, max, outline.palette, outline.size);
+
+        outline.schemes += scheme;
+
+        for (auto number : list)
+        {
+            // the ligand itself is highlighted
+            if (ligand.isLigand(number))
+            {
+                outline.colours[number] = FromQColorToQVector3D("#55ff7f");
+                continue;
+            }
+
+            float value = distance ? qMax(0.0f, max - ligand.GetDistance(playback.step, number)) : ligand.GetResidenceTime(number);
+            outline.colours[number] = FilterColor(GetColorStep(scheme, value));
+        }
+
+        break;
+    }
+    case RESIDUE_DIHEDRAL:
+    case RESIDUE_DIHEDRAL_VARIANCE:
+    {
+        // dihedral : angle in step, from -180 to 180 degrees
+        // variance : circular variance of the angle over the sliding window, from 0 (rigid) to 1 (free)
+
+        auto list = trajectory.residues.keys();
+        int MaxNumber = *std::max_element(list.begin(), list.end());
+
+        outline.colours.resize(MaxNumber + 1);
+
+        bool angle = (outline.mode == RESIDUE_DIHEDRAL);
+        auto dihedral = static_cast<DihedralAngle>(outline.dihedral);
+
+        scheme = angle ? GetColorScheme(-180, 180, outline.palette, outline.size) : GetColorScheme(0, 1, outline.palette, outline.size);
+        scheme.first().min = -FLT_MAX;
+
+        outline.schemes += scheme;
+
+        for (auto number : list)
+        {
+            float value = angle ? dihedrals.GetAngle(playback.step, number, dihedral) : dihedrals.GetWindowVariance(playback.step, number, dihedral, outline.window);
+            outline.colours[number] = FilterColor(GetColorStep(scheme, value));
+        }
+
+        break;
+    }
+    case RESIDUE_POTENTIAL:
+    case ATOM_POTENTIAL:
+    {
+        // Coulomb potential in step, symmetric scale (negative : acidic, positive : basic environment)
+
+        bool residue = (outline.mode == RESIDUE_POTENTIAL);
+
+        auto list = residue ? trajectory.residues.keys() : trajectory.atoms.keys();
+        int MaxNumber = *std::max_element(list.begin(), list.end());
+
+        outline.colours.resize(MaxNumber + 1);
+
+        scheme = GetColorScheme(-electrostatics.range, electrostatics.range, outline.palette, outline.size);
+        scheme.first().min = -FLT_MAX;
+
+        outline.schemes += scheme;
+
+        for (auto number : list)
+        {
+            float value = residue ? electrostatics.GetResiduePotential(playback.step, number) : electrostatics.GetAtomPotential(playback.step, number);
+            // values beyond the scale take the extreme colours
+            if (!std::isnan(value))
+            {
+                value = qBound(-electrostatics.range, value, electrostatics.range);
+            }
+            outline.colours[number] = FilterColor(GetColorStep(scheme, value));
+        }
+
+        break;
+    }
     }
 
     outline.OutlineTextureFlag = true;
@@ -16,6 +16,23 @@
 #include <QTime>
 
 #include "trajectory.h"
+#include "clustering.h"
+#include "neighbourgrid.h"
+#include "contactmap.h"
+#include "hbonds.h"
+#include "secondarystructure.h"
+#include "surfacearea.h"
+#include "pca.h"
+#include "crosscorrelation.h"
+#include "ligand.h"
+#include "normalmodes.h"
+#include "radialdistribution.h"
+#include "dihedrals.h"
+#include "electrostatics.h"
+#include "frameindex.h"
+#include "analysisgraph.h"
+#include "bonds.h"
+#include "densitymap.h"
 #include "utility.h"
 using namespace utility;
 
@@ -37,6 +54,56 @@ public:
     Trajectory trajectory;
     GLsizei PointsCount;
 
+    // conformational clustering
+    Clustering clustering;
+    ContactMap contacts;
+
+    // hydrogen bonds of the current step, drawn as dashed lines
+    HydrogenBonds hbonds;
+    bool HydrogenBondsVisible = false;
+
+    // covalent bonds, drawn as sticks (the atoms shrink to balls)
+    CovalentBonds bonds;
+    bool BondsVisible = false;
+
+    // DSSP-like states of each frame
+    SecondaryStructure structure;
+
+    // per residue solvent accessible surface area of each frame
+    SurfaceArea surface;
+
+    // principal components, animated through the impostors
+    PrincipalComponents pca;
+    ModeAnimationData animation;
+
+    CrossCorrelation correlation;
+    LigandBinding ligand;
+
+    // elastic network normal modes, animated like the principal components
+    NormalModes anm;
+
+    RadialDistribution rdf;
+    Dihedrals dihedrals;
+    Electrostatics electrostatics;
+
+    // nearest frames search, built in the background
+    FrameIndex neighbours;
+
+    // occupancy density of a selection over the aligned frames, drawn as cells impostors
+    DensityMap density;
+    bool DensityVisible = false;
+    // drawn cells : density at or above the level fraction of the maximum, shell (isosurface) or all (volume)
+    float DensityLevel = 0.2f;
+    bool DensitySurface = true;
+    // rebuilds the cells VAO from the density (GL context current)
+    void SetDensityVAO();
+
+    // analysis products as dependency graph nodes, recomputed on use when out of date
+    // ("models" is the source, "statistics" the RMSD and RMSF of the residues and atoms)
+    AnalysisGraph analyses;
+    // reference and atoms RMSDs mode of the statistics node
+    void SetStatisticsParameters(bool average, bool compact, bool online);
+
     PlaybackData playback;
     FrameRateData FrameRate;
 
@@ -52,6 +119,11 @@ public:
     OutlineData outline;
     void SetOutlineColor(bool flag = false);
 
+    // one VAO per model, rebuilt when the models change (GL context current)
+    void SetModelVAOs();
+    // VAO of impostors vertices
+    GLuint CreateVAO(const ModelData &data);
+
     // texture toggles
     bool KernelTextureFlag = false;
     bool NoiseTextureFlag = false;
@@ -124,6 +196,20 @@ private:
     // drawing
     void DrawPoints();
     void DrawImpostors();
+    void DrawHydrogenBonds();
+    void DrawBonds();
+    void DrawDensity();
+
+    GLuint ModeSSBO = 0;
+    int ModeStep = -1;
+    void SetModeDisplacements();
+    void SetModeUniforms(GLuint program);
+    GLuint HydrogenBondsEBO = 0;
+    // the bonds indices are uploaded once, they hold for every model VAO
+    GLuint BondsEBO = 0;
+    int BondsEBOSize = 0;
+    GLuint DensityVAO = 0;
+    GLsizei DensityPointsCount = 0;
 
     void DrawOcclusion();
     void DrawBlur();
@@ -143,6 +229,8 @@ signals:
     void MouseHoverSignal(Atom atom);
     void MouseNotHoverSignal();
     void ColorSchemeSignal(bool flag);
+    // the models changed (e.g. smoothing) : the products on display are out of date
+    void ModelsChangedSignal();
 };
 
 #endif // OPENGLWIDGET_H
@@ -0,0 +1,199 @@
+#include "pca.h"
+
+PrincipalComponents::PrincipalComponents(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+    TotalVariance = 0;
+}
+
+void PrincipalComponents::Compute(QVector<int> selection, int k)
+{
+    this->selection = selection;
+
+    variances.clear();
+    rotations.clear();
+    modes.resize(0, 0);
+    projections.resize(0, 0);
+
+    auto conformations = trajectory->GetConformations(selection);
+
+    int F = conformations.size();
+    int N = selection.size();
+
+    if (F < 2 || N == 0)
+    {
+        return;
+    }
+
+    k = qBound(1, k, qMin(F - 1, 3 * N));
+
+    // Eigen products run on all cores
+    Eigen::setNbThreads(QThread::idealThreadCount());
+
+    // aligned data matrix, one model per row
+    Eigen::MatrixXf X(F, 3 * N);
+    rotations.resize(F);
+
+    Eigen::Matrix3f *R = rotations.data();
+    Eigen::MatrixXf *data = &X;
+
+    auto lambda = [=] (int f)
+    {
+        const auto &a = conformations.at(0);
+        const auto &b = conformations.at(f);
+
+        R[f] = trajectory->GetRotateMatrix(a, b);
+
+        for (int i = 0; i < N; i++)
+        {
+            data->block<1, 3>(f, 3 * i) = (R[f] * b[i]).transpose();
+        }
+    };
+
+    auto indices = GetIndices(F);
+    QtConcurrent::blockingMap(indices, lambda);
+
+    // fluctuations around the average structure
+    Eigen::RowVectorXf mean = X.colwise().mean();
+    X.rowwise() -= mean;
+
+    TotalVariance = X.squaredNorm() / (F - 1);
+
+    if (3 * N <= MaxCovarianceSize)
+    {
+        Covariance(X, k);
+    }
+    else
+    {
+        RandomizedSVD(X, k);
+    }
+
+    projections = X * modes;
+}
+
+void PrincipalComponents::Covariance(const Eigen::MatrixXf &X, int k)
+{
+    int F = static_cast<int>(X.rows());
+    int n = static_cast<int>(X.cols());
+
+    // 3N x 3N covariance, only the lower triangle (symmetric rank update)
+    Eigen::MatrixXf C = Eigen::MatrixXf::Zero(n, n);
+    C.selfadjointView<Eigen::Lower>().rankUpdate(X.transpose(), 1.0f / (F - 1));
+
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXf> solver(C);
+
+    // eigenvalues are sorted in increasing order
+    modes.resize(n, k);
+    for (int i = 0; i < k; i++)
+    {
+        variances += solver.eigenvalues()(n - 1 - i);
+        modes.col(i) = solver.eigenvectors().col(n - 1 - i);
+    }
+}
+
+Eigen::MatrixXf PrincipalComponents::GetOrthonormalBasis(const Eigen::MatrixXf &Y) const
+{
+    Eigen::HouseholderQR<Eigen::MatrixXf> QR(Y);
+    return QR.householderQ() * Eigen::MatrixXf::Identity(Y.rows(), Y.cols());
+}
+
+void PrincipalComponents::RandomizedSVD(const Eigen::MatrixXf &X, int k, int oversampling, int iterations)
+{
+    int F = static_cast<int>(X.rows());
+    int n = static_cast<int>(X.cols());
+    int l = qMin(k + oversampling, qMin(F, n));
+
+    // gaussian test matrix, fixed seed for reproducible modes
+    std::mt19937 generator(0);
+    std::normal_distribution<float> distribution(0.0f, 1.0f);
+
+    Eigen::MatrixXf Omega(n, l);
+    for (int j = 0; j < l; j++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            Omega(i, j) = distribution(generator);
+        }
+    }
+
+    // range of X, refined by power iterations
+    Eigen::MatrixXf Q = GetOrthonormalBasis(X * Omega);
+
+    for (int q = 0; q < iterations; q++)
+    {
+        Eigen::MatrixXf Z = GetOrthonormalBasis(X.transpose() * Q);
+        Q = GetOrthonormalBasis(X * Z);
+    }
+
+    // small l x 3N problem : B = Q^T X = U S V^T, from the eigenpairs of B B^T
+    Eigen::MatrixXf B = Q.transpose() * X;
+    Eigen::MatrixXf G = B * B.transpose();
+
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXf> solver(G);
+
+    modes.resize(n, k);
+    for (int i = 0; i < k; i++)
+    {
+        float s2 = qMax(solver.eigenvalues()(l - 1 - i), 0.0f);
+        variances += s2 / (F - 1);
+
+        Eigen::VectorXf v = B.transpose() * solver.eigenvectors().col(l - 1 - i);
+        float norm = v.norm();
+        modes.col(i) = (norm > 0) ? Eigen::VectorXf(v / norm) : v;
+    }
+}
+
+bool PrincipalComponents::isEmpty() const
+{
+    return variances.isEmpty();
+}
+
+QVector<float> PrincipalComponents::GetProjection(int mode) const
+{
+    QVector<float> projection;
+
+    if (mode < 0 || mode >= projections.cols())
+    {
+        return projection;
+    }
+
+    for (int f = 0; f < projections.rows(); f++)
+    {
+        projection += projections(f, mode);
+    }
+
+    return projection;
+}
+
+float PrincipalComponents::GetExplainedVariance(int mode) const
+{
+    if (mode < 0 || mode >= variances.size() || TotalVariance <= 0)
+    {
+        return NAN;
+    }
+
+    return variances[mode] / TotalVariance;
+}
+
+QVector<QVector3D> PrincipalComponents::GetModeDisplacements(int mode, int step) const
+{
+    QVector<QVector3D> displacements;
+
+    if (mode < 0 || mode >= modes.cols() || step < 0 || step >= rotations.size())
+    {
+        return displacements;
+    }
+
+    float sigma = std::sqrt(qMax(variances[mode], 0.0f));
+
+    // modes live in the frame of the first model
+    Eigen::Matrix3f R = rotations[step].transpose();
+
+    for (int i = 0; i < selection.size(); i++)
+    {
+        Eigen::Vector3f d = modes.block<3, 1>(3 * i, mode) * sigma;
+        displacements += FromVector3fToQVector3D(R * d);
+    }
+
+    return displacements;
+}
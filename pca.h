@@ -0,0 +1,58 @@
+#ifndef PCA_H
+#define PCA_H
+
+#include <random>
+
+#include <QThread>
+#include <QtConcurrent>
+
+#include <Eigen/Dense>
+
+#include "trajectory.h"
+#include "utility.h"
+using namespace utility;
+
+// essential dynamics : principal components of the selection atoms fluctuations,
+// after superposition of every model onto the first one
+class PrincipalComponents
+{
+public:
+    PrincipalComponents(Trajectory *trajectory);
+
+    QVector<int> selection;
+
+    // eigenvalues (in squared Angstrom), decreasing
+    QVector<float> variances;
+    float TotalVariance;
+
+    // unit modes (3N x k, x y z of each atom) and frames projections (F x k)
+    Eigen::MatrixXf modes;
+    Eigen::MatrixXf projections;
+
+    // the covariance matrix is diagonalized up to this size (3N),
+    // larger selections use a randomized SVD of the data matrix
+    int MaxCovarianceSize = 3000;
+
+    void Compute(QVector<int> selection, int k);
+
+    bool isEmpty() const;
+
+    QVector<float> GetProjection(int mode) const;
+    float GetExplainedVariance(int mode) const;
+
+    // mode displacements (one standard deviation) of the selection atoms, in the frame of a model
+    QVector<QVector3D> GetModeDisplacements(int mode, int step) const;
+
+private:
+    Trajectory *trajectory;
+
+    // rotations superposing each model onto the first one
+    QVector<Eigen::Matrix3f> rotations;
+
+    void Covariance(const Eigen::MatrixXf &X, int k);
+    void RandomizedSVD(const Eigen::MatrixXf &X, int k, int oversampling = 10, int iterations = 2);
+
+    Eigen::MatrixXf GetOrthonormalBasis(const Eigen::MatrixXf &Y) const;
+};
+
+#endif // PCA_H
@@ -0,0 +1,172 @@
+#include "radialdistribution.h"
+
+RadialDistribution::RadialDistribution(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+    MaxRadius = 12.0f;
+    BinWidth = 0.1f;
+    MaxValue = 0;
+}
+
+void RadialDistribution::Compute(QVector<int> a, QVector<int> b, float MaxRadius, float BinWidth)
+{
+    this->MaxRadius = MaxRadius;
+    this->BinWidth = BinWidth;
+
+    radii.clear();
+    values.clear();
+    MaxValue = 0;
+
+    int frames = trajectory->models.size();
+    int bins = qMax(1, static_cast<int>(std::ceil(MaxRadius / BinWidth)));
+
+    if (a.isEmpty() || b.isEmpty() || frames == 0)
+    {
+        return;
+    }
+
+    // each worker streams a contiguous block of models into its own histogram
+    // (fixed blocks, the volume sum does not depend on the threads count)
+    struct Worker
+    {
+        int begin;
+        int end;
+        QVector<qint64> histogram;
+        double volume; // sum of the models volumes
+    };
+
+    QVector<Worker> workers;
+    for (auto chunk : GetReductionBlocks(frames))
+    {
+        Worker worker;
+        worker.begin = chunk.first;
+        worker.end = chunk.second;
+        worker.histogram.fill(0, bins);
+        worker.volume = 0;
+        workers += worker;
+    }
+
+    float r2 = MaxRadius * MaxRadius;
+
+    auto lambda = [&] (Worker &worker)
+    {
+        NeighbourGrid grid;
+        grid.parallel = false;
+
+        for (int step = worker.begin; step < worker.end; step++)
+        {
+            const Trajectory::Model &model = trajectory->models.at(step);
+
+            PeriodicBox box = trajectory->boxes.value(step);
+
+            if (!box.isEmpty())
+            {
+                worker.volume += box.GetVolume();
+            }
+            else
+            {
+                // models bounding box
+                QVector3D min(FLT_MAX, FLT_MAX, FLT_MAX);
+                QVector3D max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+                for (auto p : model)
+                {
+                    for (int i = 0; i < 3; i++)
+                    {
+                        min[i] = qMin(min[i], p[i]);
+                        max[i] = qMax(max[i], p[i]);
+                    }
+                }
+                QVector3D size = max - min;
+                worker.volume += static_cast<double>(size.x()) * size.y() * size.z();
+            }
+
+            // cell list up to the max radius (half-radius cells scan less volume)
+            auto positions = trajectory->GetPositions(step, b);
+            grid.Build(positions, 0.5f * MaxRadius);
+
+            for (auto number : a)
+            {
+                QVector3D p = model.value(number);
+
+                for (auto j : grid.RadiusQuery(p, MaxRadius))
+                {
+                    // an atom in both selections is not its own neighbour
+                    if (b.at(j) == number)
+                    {
+                        continue;
+                    }
+
+                    float d2 = (grid.position(j) - p).lengthSquared();
+                    if (d2 < r2)
+                    {
+                        int bin = qMin(bins - 1, static_cast<int>(std::sqrt(d2) / BinWidth));
+                        worker.histogram[bin] += 1;
+                    }
+                }
+            }
+        }
+    };
+
+    QtConcurrent::blockingMap(workers, lambda);
+
+    // merge the histograms along the fixed pairwise tree
+    auto merge = [bins] (Worker &a, const Worker &b)
+    {
+        for (int i = 0; i < bins; i++)
+        {
+            a.histogram[i] += b.histogram[i];
+        }
+        a.volume += b.volume;
+    };
+    PairwiseMerge(workers, merge);
+
+    const QVector<qint64> &histogram = workers.first().histogram;
+    double volume = workers.first().volume;
+
+    // ideal gas counts : frames * N(A) * density(B) * shell volume
+    double density = b.size() / qMax(volume / frames, 1e-6);
+    double normalization = static_cast<double>(frames) * a.size() * density;
+
+    for (int i = 0; i < bins; i++)
+    {
+        double inner = i * BinWidth;
+        double outer = qMin((i + 1) * BinWidth, MaxRadius);
+        double shell = 4.0 / 3.0 * M_PI * (outer * outer * outer - inner * inner * inner);
+
+        float value = static_cast<float>(histogram[i] / (normalization * shell));
+
+        radii += static_cast<float>(0.5 * (inner + outer));
+        values += value;
+        MaxValue = qMax(MaxValue, value);
+    }
+}
+
+bool RadialDistribution::isEmpty() const
+{
+    return values.isEmpty();
+}
+
+float RadialDistribution::GetPeakRadius() const
+{
+    if (values.isEmpty())
+    {
+        return NAN;
+    }
+
+    return radii[static_cast<int>(std::max_element(values.begin(), values.end()) - values.begin())];
+}
+
+void RadialDistribution::Export(QString path) const
+{
+    QFile file(path);
+    assert(file.open(QIODevice::Text | QIODevice::WriteOnly));
+
+    QTextStream stream(&file);
+
+    for (int i = 0; i < values.size(); i++)
+    {
+        stream << "RDF " << radii[i] << " " << values[i] << "\n";
+    }
+
+    file.close();
+}
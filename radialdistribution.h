@@ -0,0 +1,44 @@
+#ifndef RADIALDISTRIBUTION_H
+#define RADIALDISTRIBUTION_H
+
+#include <QFile>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include "trajectory.h"
+#include "neighbourgrid.h"
+#include "utility.h"
+using namespace utility;
+
+// radial distribution function g(r) of the atoms of selection B around the atoms of selection A,
+// accumulated over all frames (the density of B is taken over the periodic box of each model,
+// or over its bounding box without a box)
+class RadialDistribution
+{
+public:
+    RadialDistribution(Trajectory *trajectory);
+
+    // in Angstrom
+    float MaxRadius;
+    float BinWidth;
+
+    // bins centers and g(r) values
+    QVector<float> radii;
+    QVector<float> values;
+    float MaxValue;
+
+    void Compute(QVector<int> a, QVector<int> b, float MaxRadius = 12.0f, float BinWidth = 0.1f);
+
+    bool isEmpty() const;
+
+    // radius of the highest bin
+    float GetPeakRadius() const;
+
+    // one "RDF r g" line per bin
+    void Export(QString path) const;
+
+private:
+    Trajectory *trajectory;
+};
+
+#endif // RADIALDISTRIBUTION_H
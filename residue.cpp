@@ -38,3 +38,19 @@ QString Residue::PackedData()
 
     return list.join(" ");
 }
+
+void Residue::SetPrefixSums()
+{
+    RMSDsPrefixSums.resize(RMSDs.size() + 1);
+    RMSDsPrefixSums[0] = 0;
+
+    for (int i = 0; i < RMSDs.size(); i++)
+    {
+        RMSDsPrefixSums[i + 1] = RMSDsPrefixSums[i] + RMSDs[i];
+    }
+}
+
+float Residue::GetWindowRMSF(int step, int window)
+{
+    return GetWindowAverage(RMSDsPrefixSums, step, window);
+}
@@ -31,6 +31,18 @@ public:
 
     float RMSF;
 
+    // prefix sums of the RMSDs, for sliding window RMSF
+    QVector<double> RMSDsPrefixSums;
+    void SetPrefixSums();
+    // RMSF over the window of frames centered in step
+    float GetWindowRMSF(int step, int window);
+
+    // compact RMSDs mode : superposition of each model on the reference conformation,
+    // rotation (column-major) and centroid, 12 floats per model
+    QVector<float> alignments;
+    // reference conformation (centered), in atoms order
+    QVector<QVector3D> reference;
+
     QString PackedData();
 
     friend std::ostream& operator<<(std::ostream& os, const Residue& residue);
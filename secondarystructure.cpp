@@ -0,0 +1,370 @@
+#include "secondarystructure.h"
+
+SecondaryStructure::SecondaryStructure(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+}
+
+void SecondaryStructure::Compute()
+{
+    ResidueIndices.clear();
+    backbones.clear();
+    chains.clear();
+
+    for (auto residue : trajectory->residues)
+    {
+        Backbone backbone = {-1, -1, -1, -1, residue.name != "PRO"};
+
+        for (auto AtomNumber : residue.atoms)
+        {
+            QString name = trajectory->atoms.value(AtomNumber).name;
+
+            if (name == "N") backbone.N = AtomNumber;
+            if (name == "CA") backbone.CA = AtomNumber;
+            if (name == "C") backbone.C = AtomNumber;
+            if (name == "O") backbone.O = AtomNumber;
+        }
+
+        ResidueIndices[residue.number] = backbones.size();
+        backbones += backbone;
+        chains += residue.chain;
+    }
+
+    int frames = trajectory->models.size();
+    int size = backbones.size();
+
+    states.fill('-', frames * size);
+
+    char *data = states.data();
+    auto lambda = [=] (QPair<int, int> chunk)
+    {
+        for (int step = chunk.first; step < chunk.second; step++)
+        {
+            Assign(step, data + step * size);
+        }
+    };
+
+    auto chunks = GetChunks(frames);
+    QtConcurrent::blockingMap(chunks, lambda);
+}
+
+void SecondaryStructure::Assign(int step, char *result) const
+{
+    const Trajectory::Model &model = trajectory->models.at(step);
+    int size = backbones.size();
+
+    // residues with all the backbone atoms
+    QVector<bool> valid(size);
+    for (int i = 0; i < size; i++)
+    {
+        auto b = backbones[i];
+        valid[i] = (b.N >= 0 && b.CA >= 0 && b.C >= 0 && b.O >= 0);
+    }
+
+    QVector<QVector3D> N(size), CA(size), C(size), O(size), H(size);
+    for (int i = 0; i < size; i++)
+    {
+        if (valid[i])
+        {
+            N[i] = model.value(backbones[i].N);
+            CA[i] = model.value(backbones[i].CA);
+            C[i] = model.value(backbones[i].C);
+            O[i] = model.value(backbones[i].O);
+        }
+    }
+
+    // connected : peptide bond between residues i-1 and i
+    QVector<bool> connected(size, false);
+    QVector<bool> donor(size, false);
+    for (int i = 1; i < size; i++)
+    {
+        connected[i] = valid[i - 1] && valid[i] && chains[i - 1] == chains[i] && (C[i - 1] - N[i]).length() < 2.5f;
+
+        // amide hydrogen opposite to the previous carbonyl oxygen
+        if (connected[i] && backbones[i].donor)
+        {
+            H[i] = N[i] + (C[i - 1] - O[i - 1]).normalized();
+            donor[i] = true;
+        }
+    }
+
+    // hydrogen bonds energy is evaluated for CA atoms closer than 9 Angstrom
+    float MaxDistance = 9.0f;
+    float MaxEnergy = -0.5f;
+
+    NeighbourGrid grid;
+    grid.parallel = false;
+    grid.Build(CA, MaxDistance);
+
+    // two lowest energy acceptors of each donor
+    QVector<int> acceptors(2 * size, -1);
+    QVector<float> energies(2 * size, 0);
+
+    // candidates donors of each acceptor in SoA layout, so that the energy loop vectorizes
+    QVector<int> candidates;
+    QVector<float> NX, NY, NZ, HX, HY, HZ, E;
+
+    QVector<QVector<int>> neighbours(size);
+
+    for (int i = 0; i < size; i++)
+    {
+        if (!valid[i])
+        {
+            continue;
+        }
+
+        neighbours[i] = grid.RadiusQuery(CA[i], MaxDistance);
+
+        candidates.clear();
+        NX.clear(); NY.clear(); NZ.clear();
+        HX.clear(); HY.clear(); HZ.clear();
+
+        for (auto j : neighbours[i])
+        {
+            if (j == i || j == i + 1 || !donor[j])
+            {
+                continue;
+            }
+
+            candidates += j;
+            NX += N[j].x(); NY += N[j].y(); NZ += N[j].z();
+            HX += H[j].x(); HY += H[j].y(); HZ += H[j].z();
+        }
+
+        int count = candidates.size();
+        E.resize(count);
+
+        const float cx = C[i].x(), cy = C[i].y(), cz = C[i].z();
+        const float ox = O[i].x(), oy = O[i].y(), oz = O[i].z();
+
+        const float *nx = NX.constData(), *ny = NY.constData(), *nz = NZ.constData();
+        const float *hx = HX.constData(), *hy = HY.constData(), *hz = HZ.constData();
+        float *e = E.data();
+
+        // E = 0.084 * 332 * (1/rON + 1/rCH - 1/rOH - 1/rCN) kcal/mol
+        for (int k = 0; k < count; k++)
+        {
+            float dON = std::sqrt((ox - nx[k]) * (ox - nx[k]) + (oy - ny[k]) * (oy - ny[k]) + (oz - nz[k]) * (oz - nz[k]));
+            float dCH = std::sqrt((cx - hx[k]) * (cx - hx[k]) + (cy - hy[k]) * (cy - hy[k]) + (cz - hz[k]) * (cz - hz[k]));
+            float dOH = std::sqrt((ox - hx[k]) * (ox - hx[k]) + (oy - hy[k]) * (oy - hy[k]) + (oz - hz[k]) * (oz - hz[k]));
+            float dCN = std::sqrt((cx - nx[k]) * (cx - nx[k]) + (cy - ny[k]) * (cy - ny[k]) + (cz - nz[k]) * (cz - nz[k]));
+
+            // overlapping atoms get the DSSP minimum energy
+            float energy = 27.888f * (1.0f / dON + 1.0f / dCH - 1.0f / dOH - 1.0f / dCN);
+            e[k] = std::max(energy, -9.9f);
+        }
+
+        for (int k = 0; k < count; k++)
+        {
+            int j = candidates[k];
+
+            if (E[k] < energies[2 * j])
+            {
+                acceptors[2 * j + 1] = acceptors[2 * j];
+                energies[2 * j + 1] = energies[2 * j];
+                acceptors[2 * j] = i;
+                energies[2 * j] = E[k];
+            }
+            else if (E[k] < energies[2 * j + 1])
+            {
+                acceptors[2 * j + 1] = i;
+                energies[2 * j + 1] = E[k];
+            }
+        }
+    }
+
+    // hydrogen bond from CO of i to NH of j
+    auto HBond = [&] (int i, int j)
+    {
+        if (i < 0 || j < 0 || i >= size || j >= size)
+        {
+            return false;
+        }
+
+        return (acceptors[2 * j] == i && energies[2 * j] < MaxEnergy) || (acceptors[2 * j + 1] == i && energies[2 * j + 1] < MaxEnergy);
+    };
+
+    // residues i, i+1, ... i+n are all connected
+    auto Connected = [&] (int i, int n)
+    {
+        if (i < 0 || i + n >= size)
+        {
+            return false;
+        }
+
+        for (int k = i + 1; k <= i + n; k++)
+        {
+            if (!connected[k])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    // n-turns
+    QVector<QVector<bool>> turns(6, QVector<bool>(size, false));
+    for (int n = 3; n <= 5; n++)
+    {
+        for (int i = 0; i + n < size; i++)
+        {
+            turns[n][i] = Connected(i, n) && HBond(i, i + n);
+        }
+    }
+
+    // bridges
+    QVector<bool> bridge(size, false);
+    for (int i = 1; i + 1 < size; i++)
+    {
+        if (!Connected(i - 1, 2))
+        {
+            continue;
+        }
+
+        for (auto j : neighbours[i])
+        {
+            if (qAbs(i - j) < 3 || !Connected(j - 1, 2))
+            {
+                continue;
+            }
+
+            bool parallel = (HBond(i - 1, j) && HBond(j, i + 1)) || (HBond(j - 1, i) && HBond(i, j + 1));
+            bool antiparallel = (HBond(i, j) && HBond(j, i)) || (HBond(i - 1, j + 1) && HBond(j - 1, i + 1));
+
+            if (parallel || antiparallel)
+            {
+                bridge[i] = true;
+                break;
+            }
+        }
+    }
+
+    // states from the lowest to the highest priority
+    for (int i = 0; i < size; i++)
+    {
+        result[i] = '-';
+    }
+
+    // bends : CA(i-2) CA(i) CA(i+2) angle over 70 degrees
+    for (int i = 2; i + 2 < size; i++)
+    {
+        if (Connected(i - 2, 4))
+        {
+            QVector3D u = CA[i] - CA[i - 2];
+            QVector3D v = CA[i + 2] - CA[i];
+            float cosine = QVector3D::dotProduct(u.normalized(), v.normalized());
+
+            if (cosine < std::cos(qDegreesToRadians(70.0f)))
+            {
+                result[i] = 'S';
+            }
+        }
+    }
+
+    for (int n = 3; n <= 5; n++)
+    {
+        for (int i = 0; i + n < size; i++)
+        {
+            if (turns[n][i])
+            {
+                for (int k = i + 1; k < i + n; k++)
+                {
+                    result[k] = 'T';
+                }
+            }
+        }
+    }
+
+    // helices : two consecutive n-turns
+    auto SetHelix = [&] (int n, char state)
+    {
+        for (int i = 1; i + n < size; i++)
+        {
+            if (turns[n][i - 1] && turns[n][i])
+            {
+                for (int k = i; k < i + n; k++)
+                {
+                    result[k] = state;
+                }
+            }
+        }
+    };
+
+    SetHelix(5, 'I');
+    SetHelix(3, 'G');
+
+    // ladders : bridges with a bridged neighbour
+    for (int i = 0; i < size; i++)
+    {
+        if (bridge[i])
+        {
+            bool ladder = (i > 0 && bridge[i - 1]) || (i + 1 < size && bridge[i + 1]);
+            result[i] = ladder ? 'E' : 'B';
+        }
+    }
+
+    SetHelix(4, 'H');
+}
+
+bool SecondaryStructure::isEmpty() const
+{
+    return states.isEmpty();
+}
+
+char SecondaryStructure::GetState(int step, int ResidueNumber) const
+{
+    int index = ResidueIndices.value(ResidueNumber, -1);
+    int size = backbones.size();
+
+    if (index < 0 || step < 0 || (step + 1) * size > states.size())
+    {
+        return '-';
+    }
+
+    return states.at(step * size + index);
+}
+
+float SecondaryStructure::GetContent(int step, char state) const
+{
+    int size = backbones.size();
+
+    if (size == 0 || (step + 1) * size > states.size())
+    {
+        return 0;
+    }
+
+    return states.mid(step * size, size).count(state) / static_cast<float>(size);
+}
+
+ColorScheme SecondaryStructure::GetStatesScheme()
+{
+    // coil, bend, turn, pi, 3-10, strand, bridge, alpha
+    QStringList colors = {"#909090", "#00c0c0", "#6080ff", "#600080", "#a00080", "#ffc800", "#c8a000", "#ff0080"};
+
+    ColorScheme scheme;
+
+    for (int i = 0; i < colors.size(); i++)
+    {
+        ColorStep step;
+        step.number = i;
+        step.min = i;
+        step.max = i + 1;
+        step.color = colors[i];
+        scheme += step;
+    }
+
+    return scheme;
+}
+
+float SecondaryStructure::GetStateValue(char state)
+{
+    // SecondaryStructureStates is sorted by decreasing priority, the scheme by increasing one
+    int index = SecondaryStructureStates.indexOf(state);
+    if (index < 0)
+    {
+        index = SecondaryStructureStates.size() - 1;
+    }
+
+    return (SecondaryStructureStates.size() - 1 - index) + 0.5f;
+}
@@ -0,0 +1,61 @@
+#ifndef SECONDARYSTRUCTURE_H
+#define SECONDARYSTRUCTURE_H
+
+#include <QByteArray>
+#include <QtConcurrent>
+
+#include "trajectory.h"
+#include "neighbourgrid.h"
+#include "utility.h"
+using namespace utility;
+
+// DSSP states, from the highest priority
+// H : alpha helix, B : isolated bridge, E : strand, G : 3-10 helix,
+// I : pi helix, T : turn, S : bend, '-' : coil (or missing backbone atoms)
+static const QByteArray SecondaryStructureStates = "HBEGITS-";
+
+// DSSP-like secondary structure assignment from the backbone hydrogen bonds energy
+class SecondaryStructure
+{
+public:
+    SecondaryStructure(Trajectory *trajectory);
+
+    void Compute();
+
+    bool isEmpty() const;
+
+    // state of a residue (residue number) in step
+    char GetState(int step, int ResidueNumber) const;
+    // fraction of the residues in a state in step
+    float GetContent(int step, char state) const;
+
+    // one colour per state, coil first
+    static ColorScheme GetStatesScheme();
+    // colour scheme value of a state
+    static float GetStateValue(char state);
+
+private:
+    Trajectory *trajectory;
+
+    // backbone atoms numbers of each residue (-1 : missing)
+    struct Backbone
+    {
+        int N;
+        int CA;
+        int C;
+        int O;
+        bool donor; // proline has no amide hydrogen
+    };
+
+    // map : residue number -> residue index
+    QMap<int, int> ResidueIndices;
+    QVector<Backbone> backbones;
+    QVector<QString> chains;
+
+    // one byte per residue per frame (frames x residues)
+    QByteArray states;
+
+    void Assign(int step, char *result) const;
+};
+
+#endif // SECONDARYSTRUCTURE_H
@@ -0,0 +1,54 @@
+#version 450
+
+layout (location = 0) out vec3 center;
+layout (location = 1) out vec3 normal;
+layout (location = 2) out vec3 albedo;
+layout (location = 3) out vec3 colour;
+
+in FragData
+{
+    flat vec3 axis;
+    flat vec3 side;
+    smooth vec3 position;
+    smooth float offset;
+} frag;
+
+uniform mat4 projection;
+
+uniform float width;
+uniform vec3 BondColor;
+uniform bool grayscale;
+
+void main()
+{
+    // cylinder impostor : across the dash the normal bends from the side to the camera
+    vec3 toward = normalize(cross(frag.side, frag.axis));
+    if (dot(toward, -frag.position) < 0.0f)
+    {
+        toward = -toward;
+    }
+
+    float s = clamp(frag.offset, -1.0f, +1.0f);
+    vec3 n = normalize(frag.side * s + toward * sqrt(1.0f - s * s));
+
+    // frag position on the cylinder in view space
+    vec3 axial = frag.position - frag.side * width * s;
+    vec3 surface = axial + n * width;
+
+    vec4 clip = projection * vec4(surface, 1.0f);
+    float depth = clip.z / clip.w;
+    gl_FragDepth = ((gl_DepthRange.diff * depth) + gl_DepthRange.near + gl_DepthRange.far) * 0.5f;
+
+    center = surface;
+    normal = n;
+    albedo = BondColor;
+    // no atom number : bonds are not hovered
+    colour = vec3(0.0f);
+
+    if (grayscale)
+    {
+        // grayscale weights
+        vec3 weight = vec3(0.2126f, 0.7152f, 0.0722f);
+        albedo = vec3(dot(albedo, weight));
+    }
+}
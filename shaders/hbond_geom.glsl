@@ -0,0 +1,67 @@
+#version 450 core
+
+#define DASHES 8
+
+layout (lines) in;
+layout (triangle_strip, max_vertices = 32) out;
+
+in VertData
+{
+    vec3 center;
+} vert[];
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform float width;
+// covalent bonds : a single dash over the whole bond
+uniform bool solid;
+
+out FragData
+{
+    flat vec3 axis;
+    flat vec3 side;
+    smooth vec3 position;
+    smooth float offset;
+} frag;
+
+void main()
+{
+    // bond endpoints in view space
+    vec3 a = vec3(view * model * vec4(vert[0].center, 1.0f));
+    vec3 b = vec3(view * model * vec4(vert[1].center, 1.0f));
+
+    vec3 axis = normalize(b - a);
+    // the dashes face the camera (0 in view space)
+    vec3 side = normalize(cross(axis, -(a + b) * 0.5f));
+
+    int dashes = solid ? 1 : DASHES;
+    float length = solid ? 1.0f : 0.5f;
+
+    for (int i = 0; i < dashes; i++)
+    {
+        // each dash covers the first half of its segment
+        vec3 endpoints[2];
+        endpoints[0] = mix(a, b, (i + 0.0f) / dashes);
+        endpoints[1] = mix(a, b, (i + length) / dashes);
+
+        for (int j = 0; j < 2; j++)
+        {
+            for (int k = -1; k <= +1; k += 2)
+            {
+                frag.axis = axis;
+                frag.side = side;
+                frag.position = endpoints[j] + side * width * k;
+                frag.offset = k;
+
+                gl_Position = projection * vec4(frag.position, 1.0f);
+                gl_PrimitiveID = gl_PrimitiveIDIn;
+
+                EmitVertex();
+            }
+        }
+
+        EndPrimitive();
+    }
+}
@@ -0,0 +1,27 @@
+#version 450 core
+
+layout (location = 0) in vec3 center;
+
+// principal component animation
+layout (std430, binding = 0) buffer ModeData
+{
+    vec4 displacements[];
+};
+
+uniform bool ModeAnimation;
+uniform float ModeScale;
+
+out VertData
+{
+    vec3 center;
+} vert;
+
+void main()
+{
+    vert.center = center;
+
+    if (ModeAnimation)
+    {
+        vert.center += displacements[gl_VertexID].xyz * ModeScale;
+    }
+}
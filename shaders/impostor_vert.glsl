@@ -5,6 +5,17 @@ layout (location = 1) in float radius;
 layout (location = 2) in vec3 albedo;
 layout (location = 3) in vec2 number;
 
+// principal component animation
+layout (std430, binding = 0) buffer ModeData
+{
+    vec4 displacements[];
+};
+
+uniform bool ModeAnimation;
+uniform float ModeScale;
+// atoms shrink under the covalent bonds sticks
+uniform float RadiusScale;
+
 out VertData
 {
     vec3 center;
@@ -23,7 +34,12 @@ void main()
     vec3 colour = ((uvec3(AtomNumber) & mask) >> shift) / 255.0f;
 
     vert.center = center;
-    vert.radius = radius;
+
+    if (ModeAnimation)
+    {
+        vert.center += displacements[gl_VertexID].xyz * ModeScale;
+    }
+    vert.radius = radius * RadiusScale;
     vert.albedo = albedo;
     vert.number = number;
 
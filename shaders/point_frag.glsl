@@ -6,7 +6,7 @@ in FragData
     flat vec2 number;
 } frag;
 
-uniform int OutlineMode;
+uniform int OutlineLevel;
 uniform sampler1D outline;
 
 out vec4 PixelColor;
@@ -18,18 +18,16 @@ void main()
 
     float number;
 
-    switch (OutlineMode)
+    switch (OutlineLevel)
     {
     // residue number
     case 0:
-    case 1:
     {
         number = frag.number[1];
         break;
     }
     // atom number
-    case 2:
-    case 3:
+    case 1:
     {
         number = frag.number[0];
         break;
@@ -5,7 +5,18 @@ layout (location = 1) in float radius;
 layout (location = 2) in vec3 albedo;
 layout (location = 3) in vec2 number;
 
-uniform int OutlineMode;
+// principal component animation
+layout (std430, binding = 0) buffer ModeData
+{
+    vec4 displacements[];
+};
+
+uniform bool ModeAnimation;
+uniform float ModeScale;
+
+uniform float RadiusScale;
+
+uniform int OutlineLevel;
 
 out VertData
 {
@@ -23,18 +34,16 @@ void main()
 
     vec3 colour;
 
-    switch (OutlineMode)
+    switch (OutlineLevel)
     {
     // residue number
     case 0:
-    case 1:
     {
         colour = ((uvec3(number[1]) & mask) >> shift) / 255.0f;
         break;
     }
     // atom number
-    case 2:
-    case 3:
+    case 1:
     {
         colour = ((uvec3(number[0]) & mask) >> shift) / 255.0f;
         break;
@@ -42,7 +51,12 @@ void main()
     }
 
     vert.center = center;
-    vert.radius = radius;
+
+    if (ModeAnimation)
+    {
+        vert.center += displacements[gl_VertexID].xyz * ModeScale;
+    }
+    vert.radius = radius * RadiusScale;
     // vert.albedo = albedo;
     vert.number = number;
     vert.colour = colour;
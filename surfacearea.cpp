@@ -0,0 +1,222 @@
+#include "surfacearea.h"
+
+SurfaceArea::SurfaceArea(Trajectory *trajectory)
+{
+    this->trajectory = trajectory;
+    probe = 1.4f;
+    points = 96;
+    MinResiduesSASA = FLT_MAX;
+    MaxResiduesSASA = 0;
+}
+
+QVector<QVector3D> SurfaceArea::GetSpherePoints(int count) const
+{
+    QVector<QVector3D> sphere;
+
+    float increment = static_cast<float>(M_PI) * (3.0f - std::sqrt(5.0f));
+    float offset = 2.0f / count;
+
+    for (int i = 0; i < count; i++)
+    {
+        float y = i * offset - 1.0f + offset * 0.5f;
+        float r = std::sqrt(1.0f - y * y);
+        float phi = i * increment;
+
+        sphere += QVector3D(std::cos(phi) * r, y, std::sin(phi) * r);
+    }
+
+    return sphere;
+}
+
+void SurfaceArea::Compute(float probe, int points)
+{
+    this->probe = probe;
+    this->points = points;
+
+    ResidueIndices.clear();
+    ResidueNumbers.clear();
+
+    for (auto number : trajectory->residues.keys())
+    {
+        ResidueIndices[number] = ResidueNumbers.size();
+        ResidueNumbers += number;
+    }
+
+    // atoms in model order, with their expanded radii and residue index
+    QVector<int> selection;
+    QVector<float> radii;
+    QVector<int> AtomResidues;
+    float MaxRadius = 0;
+
+    for (auto atom : trajectory->atoms)
+    {
+        float radius = ChemicalElements.contains(atom.element) ? ChemicalElements[atom.element].radius : 1.8f;
+
+        selection += atom.number;
+        radii += radius + probe;
+        AtomResidues += ResidueIndices.value(atom.residue);
+        MaxRadius = qMax(MaxRadius, radius + probe);
+    }
+
+    auto sphere = GetSpherePoints(points);
+
+    int frames = trajectory->models.size();
+    int size = ResidueNumbers.size();
+
+    values.fill(0, frames * size);
+
+    float *data = values.data();
+    auto lambda = [&] (QPair<int, int> chunk)
+    {
+        NeighbourGrid grid;
+        grid.parallel = false;
+
+        // neighbours of the current atom in SoA layout, so that the occlusion loop vectorizes
+        QVector<float> NX, NY, NZ, R2;
+
+        for (int step = chunk.first; step < chunk.second; step++)
+        {
+            auto positions = trajectory->GetPositions(step, selection);
+
+            if (step == chunk.first)
+            {
+                grid.Build(positions, 2 * MaxRadius);
+            }
+            else
+            {
+                grid.Update(positions);
+            }
+
+            float *row = data + step * size;
+
+            for (int i = 0; i < selection.size(); i++)
+            {
+                QVector3D center = positions[i];
+                float radius = radii[i];
+
+                NX.clear(); NY.clear(); NZ.clear(); R2.clear();
+
+                for (auto j : grid.RadiusQuery(center, radius + MaxRadius))
+                {
+                    if (j == i || (positions[j] - center).length() >= radius + radii[j])
+                    {
+                        continue;
+                    }
+
+                    NX += positions[j].x();
+                    NY += positions[j].y();
+                    NZ += positions[j].z();
+                    R2 += radii[j] * radii[j];
+                }
+
+                int count = NX.size();
+                const float *nx = NX.constData(), *ny = NY.constData(), *nz = NZ.constData(), *r2 = R2.constData();
+
+                int accessible = 0;
+
+                for (auto point : sphere)
+                {
+                    float px = center.x() + point.x() * radius;
+                    float py = center.y() + point.y() * radius;
+                    float pz = center.z() + point.z() * radius;
+
+                    // branch-free test against all the neighbours
+                    int buried = 0;
+                    for (int k = 0; k < count; k++)
+                    {
+                        float dx = px - nx[k];
+                        float dy = py - ny[k];
+                        float dz = pz - nz[k];
+                        buried |= (dx * dx + dy * dy + dz * dz < r2[k]);
+                    }
+
+                    accessible += 1 - buried;
+                }
+
+                float area = 4.0f * static_cast<float>(M_PI) * radius * radius * accessible / sphere.size();
+                row[AtomResidues[i]] += area;
+            }
+        }
+    };
+
+    auto chunks = GetChunks(frames);
+    QtConcurrent::blockingMap(chunks, lambda);
+
+    // Min and Max values
+    MinValues.fill(FLT_MAX, size);
+    MaxValues.fill(0, size);
+    MinResiduesSASA = FLT_MAX;
+    MaxResiduesSASA = 0;
+
+    for (int step = 0; step < frames; step++)
+    {
+        for (int r = 0; r < size; r++)
+        {
+            float value = values[step * size + r];
+
+            MinValues[r] = qMin(MinValues[r], value);
+            MaxValues[r] = qMax(MaxValues[r], value);
+        }
+    }
+
+    for (int r = 0; r < size; r++)
+    {
+        MinResiduesSASA = qMin(MinResiduesSASA, MinValues[r]);
+        MaxResiduesSASA = qMax(MaxResiduesSASA, MaxValues[r]);
+    }
+}
+
+bool SurfaceArea::isEmpty() const
+{
+    return values.isEmpty();
+}
+
+float SurfaceArea::GetSASA(int step, int ResidueNumber) const
+{
+    int index = ResidueIndices.value(ResidueNumber, -1);
+    int size = ResidueNumbers.size();
+
+    if (index < 0 || step < 0 || (step + 1) * size > values.size())
+    {
+        return NAN;
+    }
+
+    return values[step * size + index];
+}
+
+float SurfaceArea::GetMinSASA(int ResidueNumber) const
+{
+    return MinValues.value(ResidueIndices.value(ResidueNumber, -1), NAN);
+}
+
+float SurfaceArea::GetMaxSASA(int ResidueNumber) const
+{
+    return MaxValues.value(ResidueIndices.value(ResidueNumber, -1), NAN);
+}
+
+void SurfaceArea::Export(QString path) const
+{
+    QFile file(path);
+    assert(file.open(QIODevice::Text | QIODevice::WriteOnly));
+
+    QTextStream stream(&file);
+
+    stream << "PROBE " << probe << "\n";
+    stream << "POINTS " << points << "\n";
+
+    int size = ResidueNumbers.size();
+    int frames = (size > 0) ? values.size() / size : 0;
+
+    for (int r = 0; r < size; r++)
+    {
+        QVector<float> series;
+        for (int step = 0; step < frames; step++)
+        {
+            series += values[step * size + r];
+        }
+
+        stream << "SASA " << ResidueNumbers[r] << " " << PackNumbers(series, " ") << "\n";
+    }
+
+    file.close();
+}
@@ -0,0 +1,56 @@
+#ifndef SURFACEAREA_H
+#define SURFACEAREA_H
+
+#include <QFile>
+#include <QTextStream>
+#include <QtConcurrent>
+
+#include "trajectory.h"
+#include "neighbourgrid.h"
+#include "utility.h"
+using namespace utility;
+
+// Shrake-Rupley solvent accessible surface area of each residue in each frame
+class SurfaceArea
+{
+public:
+    SurfaceArea(Trajectory *trajectory);
+
+    // probe radius (in Angstrom)
+    float probe;
+    // sphere points per atom
+    int points;
+
+    void Compute(float probe = 1.4f, int points = 96);
+
+    bool isEmpty() const;
+
+    // SASA (in squared Angstrom) of a residue (residue number) in step
+    float GetSASA(int step, int ResidueNumber) const;
+    float GetMinSASA(int ResidueNumber) const;
+    float GetMaxSASA(int ResidueNumber) const;
+
+    // Min and Max SASA over all residues and frames
+    float MinResiduesSASA;
+    float MaxResiduesSASA;
+
+    // one "SASA residue value value ..." line per residue, one value per frame
+    void Export(QString path) const;
+
+private:
+    Trajectory *trajectory;
+
+    // map : residue number -> residue index
+    QMap<int, int> ResidueIndices;
+    QVector<int> ResidueNumbers;
+
+    // frames x residues
+    QVector<float> values;
+    QVector<float> MinValues;
+    QVector<float> MaxValues;
+
+    // golden spiral points on the unit sphere
+    QVector<QVector3D> GetSpherePoints(int count) const;
+};
+
+#endif // SURFACEAREA_H
@@ -0,0 +1,220 @@
+#include <cstring>
+#include <functional>
+
+#include <QCoreApplication>
+#include <QRandomGenerator>
+
+#include "trajectory.h"
+#include "radialdistribution.h"
+
+// reductions of a synthetic trajectory (statistics, average references, radial distribution)
+// on 1 thread and on all the threads, compared bitwise
+class ReductionsTest
+{
+public:
+    ReductionsTest(int ModelsCount, int ResiduesCount);
+
+    // returns the number of reductions that differ
+    int Run();
+
+private:
+    Trajectory trajectory;
+    int AtomsCount = 0;
+
+    // all the RMSD and RMSF statistics, residues then atoms then global extrema
+    QVector<float> GetStatistics() const;
+
+    // runs reduction on 1 thread then on all the threads, returns whether the results are bit-identical
+    bool Compare(QString name, std::function<QVector<float>()> reduction);
+};
+
+ReductionsTest::ReductionsTest(int ModelsCount, int ResiduesCount)
+{
+    // a chain of residues of 5 atoms, each atom jittering around its rest position
+    // (random walk of the chain plus thermal noise, fixed seed)
+    QRandomGenerator generator(42);
+
+    auto random = [&] (float amplitude)
+    {
+        return QVector3D(static_cast<float>(generator.bounded(2.0) - 1.0),
+                         static_cast<float>(generator.bounded(2.0) - 1.0),
+                         static_cast<float>(generator.bounded(2.0) - 1.0)) * amplitude;
+    };
+
+    const int ResidueSize = 5;
+    QVector<QVector3D> rest;
+
+    for (int r = 0; r < ResiduesCount; r++)
+    {
+        Residue residue;
+        residue.number = r;
+        residue.sequence = r + 1;
+        residue.name = "ALA";
+        residue.chain = "A";
+
+        for (int i = 0; i < ResidueSize; i++)
+        {
+            Atom atom;
+            atom.number = r * ResidueSize + i;
+            atom.name = "C";
+            atom.element = "C";
+            atom.residue = r;
+
+            trajectory.atoms[atom.number] = atom;
+            residue.atoms += atom.number;
+
+            rest += QVector3D(3.8f * r, 0, 0) + random(1.5f);
+        }
+
+        trajectory.residues[r] = residue;
+    }
+
+    for (int m = 0; m < ModelsCount; m++)
+    {
+        Trajectory::Model model;
+        for (int i = 0; i < rest.size(); i++)
+        {
+            rest[i] += random(0.05f);
+            model[i] = rest[i] + random(0.5f);
+        }
+        trajectory.models += model;
+    }
+
+    AtomsCount = rest.size();
+}
+
+QVector<float> ReductionsTest::GetStatistics() const
+{
+    QVector<float> statistics;
+
+    for (const auto &residue : trajectory.residues)
+    {
+        statistics << residue.MinRMSD << residue.MaxRMSD << residue.RMSF;
+    }
+
+    for (const auto &atom : trajectory.atoms)
+    {
+        statistics << atom.MinRMSD << atom.MaxRMSD << atom.RMSF;
+    }
+
+    statistics << trajectory.MinResiduesRMSD << trajectory.MaxResiduesRMSD;
+    statistics << trajectory.MinResiduesRMSF << trajectory.MaxResiduesRMSF;
+    statistics << trajectory.MinAtomsRMSD << trajectory.MaxAtomsRMSD;
+    statistics << trajectory.MinAtomsRMSF << trajectory.MaxAtomsRMSF;
+
+    return statistics;
+}
+
+bool ReductionsTest::Compare(QString name, std::function<QVector<float>()> reduction)
+{
+    // the reductions run on the global pool of this process only
+    QThreadPool *pool = QThreadPool::globalInstance();
+    int MaxThreadCount = pool->maxThreadCount();
+    int ThreadCount = qMax(2, QThread::idealThreadCount());
+
+    QVector<QVector<float>> results;
+    QVector<qint64> times;
+
+    for (int threads : {1, ThreadCount})
+    {
+        pool->setMaxThreadCount(threads);
+
+        QElapsedTimer timer;
+        timer.start();
+        results += reduction();
+        times += timer.elapsed();
+    }
+
+    pool->setMaxThreadCount(MaxThreadCount);
+
+    int mismatches = (results[0].size() == results[1].size()) ? 0 : 1;
+    for (int i = 0; i < qMin(results[0].size(), results[1].size()); i++)
+    {
+        mismatches += (std::memcmp(&results[0][i], &results[1][i], sizeof(float)) != 0) ? 1 : 0;
+    }
+
+    qDebug() << name << results[0].size() << "values"
+             << "1 thread" << times[0] << "ms"
+             << ThreadCount << "threads" << times[1] << "ms"
+             << "bitwise mismatches" << mismatches << ((mismatches == 0) ? "PASS" : "FAIL");
+
+    return mismatches == 0;
+}
+
+int ReductionsTest::Run()
+{
+    int failures = 0;
+
+    // online statistics against the 1st model and the average structure
+    for (bool average : {false, true})
+    {
+        trajectory.OnlineStatistics = true;
+        trajectory.StoreRMSDs = false;
+        trajectory.AverageReference = average;
+
+        auto reduction = [&] ()
+        {
+            trajectory.Recook();
+            return GetStatistics();
+        };
+        failures += Compare(average ? "average reference statistics" : "1st model reference statistics", reduction) ? 0 : 1;
+    }
+
+    // average structure of the residues
+    {
+        auto reduction = [&] ()
+        {
+            QVector<float> values;
+            for (const auto &reference : trajectory.GetAverageReferences())
+            {
+                for (const auto &v : reference)
+                {
+                    values << v.x() << v.y() << v.z();
+                }
+            }
+            return values;
+        };
+        failures += Compare("average references", reduction) ? 0 : 1;
+    }
+
+    // radial distribution of the second half of the chain around the first half
+    // (g(r) is the histogram over the summed volumes, so both merges are compared)
+    {
+        QVector<int> a;
+        QVector<int> b;
+        for (int i = 0; i < AtomsCount; i++)
+        {
+            if (i < AtomsCount / 2)
+            {
+                a += i;
+            }
+            else
+            {
+                b += i;
+            }
+        }
+
+        RadialDistribution rdf(&trajectory);
+
+        auto reduction = [&] ()
+        {
+            rdf.Compute(a, b, 12.0f, 0.1f);
+            return rdf.values;
+        };
+        failures += Compare("radial distribution", reduction) ? 0 : 1;
+    }
+
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+
+    ReductionsTest test(2000, 200);
+    int failures = test.Run();
+
+    qDebug() << "reductions" << ((failures == 0) ? "PASS" : QString("FAIL (%1 reductions differ)").arg(failures));
+
+    return (failures == 0) ? 0 : 1;
+}
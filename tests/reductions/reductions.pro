@@ -0,0 +1,36 @@
+# bitwise comparison of the parallel reductions on 1 thread and on all the threads
+# (own process : the thread pool is not shared with the application)
+
+QT       += core gui concurrent
+QT       -= widgets
+
+TARGET = reductions
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+gcc: QMAKE_CXXFLAGS += -fopenmp
+gcc: QMAKE_LFLAGS += -fopenmp
+
+INCLUDEPATH += ../.. ../../../../eigen-eigen-323c052e1731
+
+SOURCES += \
+    main.cpp \
+    ../../trajectory.cpp \
+    ../../atom.cpp \
+    ../../residue.cpp \
+    ../../observable.cpp \
+    ../../neighbourgrid.cpp \
+    ../../radialdistribution.cpp
+
+HEADERS += \
+    ../../trajectory.h \
+    ../../atom.h \
+    ../../residue.h \
+    ../../observable.h \
+    ../../utility.h \
+    ../../neighbourgrid.h \
+    ../../radialdistribution.h
@@ -0,0 +1,94 @@
+#include "timeserieswidget.h"
+
+TimeSeriesWidget::TimeSeriesWidget(QWidget *parent) : QWidget(parent)
+{
+    min = 0;
+    max = 0;
+    step = 0;
+
+    setMinimumSize(160, 32);
+}
+
+void TimeSeriesWidget::SetValues(QVector<float> values, float min, float max)
+{
+    this->values = values;
+    this->min = min;
+    this->max = max;
+    update();
+}
+
+void TimeSeriesWidget::SetStep(int step)
+{
+    this->step = step;
+    update();
+}
+
+int TimeSeriesWidget::GetStep(int x)
+{
+    if (values.isEmpty())
+    {
+        return 0;
+    }
+
+    return qBound(0, static_cast<int>(x / static_cast<float>(width()) * values.size()), values.size() - 1);
+}
+
+void TimeSeriesWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::GlobalColor::black);
+
+    if (values.isEmpty())
+    {
+        return;
+    }
+
+    int w = width();
+    int h = height();
+    float span = (max > min) ? (max - min) : 1;
+
+    auto y = [=] (float value) { return h - 1 - static_cast<int>((value - min) / span * (h - 1)); };
+
+    // one vertical segment (min to max of its frames) per pixel column
+    painter.setPen(QColor("#55ffff"));
+
+    for (int x = 0; x < w; x++)
+    {
+        int first = static_cast<int>(x / static_cast<float>(w) * values.size());
+        int last = qMax(first + 1, static_cast<int>((x + 1) / static_cast<float>(w) * values.size()));
+        last = qMin(last, values.size());
+
+        if (first >= last)
+        {
+            continue;
+        }
+
+        auto bounds = std::minmax_element(values.begin() + first, values.begin() + last);
+        painter.drawLine(x, y(*bounds.first), x, y(*bounds.second));
+    }
+
+    // current step marker (none outside the values)
+    if (step < 0 || step >= values.size())
+    {
+        return;
+    }
+
+    int x = static_cast<int>((step + 0.5f) / values.size() * w);
+    painter.setPen(QColor("#ff557f"));
+    painter.drawLine(x, 0, x, h - 1);
+}
+
+void TimeSeriesWidget::mousePressEvent(QMouseEvent *event)
+{
+    emit StepSignal(GetStep(event->pos().x()));
+}
+
+void TimeSeriesWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    if (event->buttons() & Qt::LeftButton)
+    {
+        emit StepSignal(GetStep(event->pos().x()));
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef TIMESERIESWIDGET_H
+#define TIMESERIESWIDGET_H
+
+#include <QWidget>
+#include <QPainter>
+#include <QMouseEvent>
+
+#include "utility.h"
+using namespace utility;
+
+// compact plot of a per-frame series, with a marker on the current step
+class TimeSeriesWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TimeSeriesWidget(QWidget *parent = nullptr);
+
+    void SetValues(QVector<float> values, float min, float max);
+    void SetStep(int step);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseMoveEvent(QMouseEvent *event);
+
+private:
+    QVector<float> values;
+    float min;
+    float max;
+    int step;
+
+    int GetStep(int x);
+
+signals:
+    // clicked step
+    void StepSignal(int step);
+};
+
+#endif // TIMESERIESWIDGET_H
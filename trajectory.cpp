@@ -1,5 +1,38 @@
 #include "trajectory.h"
 
+bool PeriodicBox::isEmpty() const
+{
+    // unit cells of 1 Angstrom are placeholders (e.g. NMR structures)
+    return lengths.x() <= 1 || lengths.y() <= 1 || lengths.z() <= 1;
+}
+
+Eigen::Matrix3f PeriodicBox::GetMatrix() const
+{
+    float alpha = qDegreesToRadians(angles.x());
+    float beta = qDegreesToRadians(angles.y());
+    float gamma = qDegreesToRadians(angles.z());
+
+    float a = lengths.x();
+    float b = lengths.y();
+    float c = lengths.z();
+
+    float cx = c * std::cos(beta);
+    float cy = c * (std::cos(alpha) - std::cos(beta) * std::cos(gamma)) / std::sin(gamma);
+    float cz = std::sqrt(qMax(0.0f, c * c - cx * cx - cy * cy));
+
+    Eigen::Matrix3f H;
+    H << a, b * std::cos(gamma), cx,
+         0, b * std::sin(gamma), cy,
+         0, 0, cz;
+
+    return H;
+}
+
+float PeriodicBox::GetVolume() const
+{
+    return isEmpty() ? 0 : GetMatrix().determinant();
+}
+
 void Trajectory::LoadCookedData()
 {
     auto path = paths.last();
@@ -13,10 +46,13 @@ void Trajectory::LoadCookedData()
     atoms.clear();
     residues.clear();
     models.clear();
+    boxes.clear();
+    observables.clear();
 
     auto lines = document.split("\n");
 
     Model model;
+    bool charged = false;
 
     int step = 0;
     int size = lines.size();
@@ -62,9 +98,31 @@ void Trajectory::LoadCookedData()
             residue.MaxRMSD = record[i++].toFloat();
             residue.RMSF = record[i++].toFloat();
 
+            // no RMSDs history : cooked in online statistics mode
+            if (residue.RMSDs.isEmpty())
+            {
+                OnlineStatistics = true;
+                StoreRMSDs = false;
+            }
+
             residues[residue.number] = residue;
         }
 
+        if (line.startsWith("ALIGNMENT "))
+        {
+            auto record = line.split(" ");
+            int i = 1;
+
+            int ResidueNumber = record[i++].toInt();
+
+            if (residues.contains(ResidueNumber))
+            {
+                residues[ResidueNumber].alignments = UnpackFloats(record[i++]);
+                residues[ResidueNumber].reference = UnpackVectors(record[i++]);
+                CompactRMSDs = true;
+            }
+        }
+
         if (line.startsWith("NEW MODEL"))
         {
             model = Model();
@@ -81,11 +139,67 @@ void Trajectory::LoadCookedData()
             model[AtomNumber] = AtomPosition;
         }
 
+        if (line.startsWith("BOX "))
+        {
+            auto record = line.split(" ");
+            int i = 1;
+
+            PeriodicBox box;
+
+            for (int j = 0; j < 3; j++)
+            {
+                box.lengths[j] = record[i++].toFloat();
+            }
+            for (int j = 0; j < 3; j++)
+            {
+                box.angles[j] = record[i++].toFloat();
+            }
+
+            // the box belongs to the model being read
+            boxes.resize(models.size() + 1);
+            boxes.last() = box;
+        }
+
         if (line.startsWith("END MODEL"))
         {
             models += model;
         }
 
+        if (line.startsWith("CHARGE "))
+        {
+            auto record = line.split(" ");
+            int i = 1;
+
+            int AtomNumber = record[i++].toInt();
+            float charge = record[i++].toFloat();
+
+            if (atoms.contains(AtomNumber))
+            {
+                atoms[AtomNumber].charge = charge;
+                charged = true;
+            }
+        }
+
+        if (line.startsWith("OBSERVABLE "))
+        {
+            auto record = line.split(" ");
+            int i = 1;
+
+            Observable observable;
+
+            observable.name = record[i++].replace("_", " ");
+            observable.type = static_cast<ObservableType>(record[i++].toInt());
+            for (auto group : record[i++].split("|"))
+            {
+                observable.groups += UnpackInts(group);
+            }
+            observable.values = UnpackFloats(record[i++]);
+            observable.MinValue = record[i++].toFloat();
+            observable.MaxValue = record[i++].toFloat();
+
+            observables += observable;
+        }
+
         if (line.startsWith("MINMAX "))
         {
             auto record = line.split(" ");
@@ -107,6 +221,187 @@ void Trajectory::LoadCookedData()
 
     QString text = QString("load %1complete").arg((step < size) ? "in" : "");
     emit ProgressLabelSetTextSignal(text);
+
+    SetPrefixSums();
+
+    // cooked data without charges
+    if (!charged)
+    {
+        SetCharges();
+    }
+
+    // cooked data without observables
+    if (observables.isEmpty())
+    {
+        SetDefaultObservables();
+        ComputeObservables();
+    }
+}
+
+void Trajectory::SetPrefixSums()
+{
+    // residues only : the atoms window RMSF is summed on demand (a prefix sum per atom and model
+    // would cost more than the RMSDs history itself)
+    for (auto &residue : residues)
+    {
+        residue.SetPrefixSums();
+    }
+}
+
+QVector3D Trajectory::GetAtomRMSD(int step, int AtomNumber)
+{
+    const Atom &atom = atoms[AtomNumber];
+
+    if (step < 0 || step >= models.size())
+    {
+        return QVector3D(NAN, NAN, NAN);
+    }
+
+    if (!atom.RMSDs.isEmpty())
+    {
+        return atom.RMSDs[step];
+    }
+
+    const Residue &residue = residues[atom.residue];
+    int index = residue.atoms.indexOf(AtomNumber);
+
+    if (residue.alignments.isEmpty() || index < 0)
+    {
+        return QVector3D(NAN, NAN, NAN);
+    }
+
+    // R (x - c) - a
+    const float *alignment = residue.alignments.constData() + 12 * step;
+    Eigen::Map<const Eigen::Matrix3f> R(alignment);
+    Eigen::Vector3f c(alignment[9], alignment[10], alignment[11]);
+
+    Eigen::Vector3f x = FromQVector3DToVector3f(models.at(step).value(AtomNumber));
+    Eigen::Vector3f d = R * (x - c) - FromQVector3DToVector3f(residue.reference[index]);
+
+    return FromVector3fToQVector3D(d);
+}
+
+QVector<QVector3D> Trajectory::GetAtomsRMSDs(int step)
+{
+    auto keys = atoms.keys().toVector();
+    QVector<QVector3D> result(keys.size(), QVector3D(NAN, NAN, NAN));
+
+    if (step < 0 || step >= models.size())
+    {
+        return result;
+    }
+
+    // stored histories
+    if (!CompactRMSDs)
+    {
+        int i = 0;
+        for (const auto &atom : atoms)
+        {
+            if (!atom.RMSDs.isEmpty())
+            {
+                result[i] = atom.RMSDs[step];
+            }
+            i += 1;
+        }
+        return result;
+    }
+
+    const Model &model = models.at(step);
+    auto list = residues.values().toVector();
+    QVector3D *data = result.data();
+
+    // residue by residue, SoA kernel over its atoms
+    auto lambda = [&] (QPair<int, int> chunk)
+    {
+        QVector<float> x, y, z;
+        QVector<int> indices;
+
+        for (int r = chunk.first; r < chunk.second; r++)
+        {
+            const Residue &residue = list.at(r);
+            int count = residue.atoms.size();
+
+            if (residue.alignments.isEmpty() || residue.reference.size() != count)
+            {
+                continue;
+            }
+
+            const float *alignment = residue.alignments.constData() + 12 * step;
+
+            x.resize(count);
+            y.resize(count);
+            z.resize(count);
+            indices.resize(count);
+
+            for (int i = 0; i < count; i++)
+            {
+                int number = residue.atoms[i];
+                QVector3D p = model.value(number);
+                x[i] = p.x() - alignment[9];
+                y[i] = p.y() - alignment[10];
+                z[i] = p.z() - alignment[11];
+
+                auto it = std::lower_bound(keys.begin(), keys.end(), number);
+                indices[i] = static_cast<int>(it - keys.begin());
+            }
+
+            // column-major rotation
+            const float r00 = alignment[0], r10 = alignment[1], r20 = alignment[2];
+            const float r01 = alignment[3], r11 = alignment[4], r21 = alignment[5];
+            const float r02 = alignment[6], r12 = alignment[7], r22 = alignment[8];
+
+            const QVector3D *a = residue.reference.constData();
+            float *X = x.data(), *Y = y.data(), *Z = z.data();
+
+            for (int i = 0; i < count; i++)
+            {
+                float dx = r00 * X[i] + r01 * Y[i] + r02 * Z[i];
+                float dy = r10 * X[i] + r11 * Y[i] + r12 * Z[i];
+                float dz = r20 * X[i] + r21 * Y[i] + r22 * Z[i];
+
+                X[i] = dx;
+                Y[i] = dy;
+                Z[i] = dz;
+            }
+
+            for (int i = 0; i < count; i++)
+            {
+                data[indices[i]] = QVector3D(X[i], Y[i], Z[i]) - a[i];
+            }
+        }
+    };
+
+    auto chunks = GetChunks(list.size());
+    QtConcurrent::blockingMap(chunks, lambda);
+
+    return result;
+}
+
+float Trajectory::GetAtomWindowRMSF(int step, int AtomNumber, int window)
+{
+    const Atom &atom = atoms[AtomNumber];
+
+    // stored history, or derived from the residues superpositions
+    bool stored = !atom.RMSDs.isEmpty();
+    int size = stored ? atom.RMSDs.size() : models.size();
+
+    if (size == 0 || (!stored && !CompactRMSDs))
+    {
+        return NAN;
+    }
+
+    // same window as the residues prefix sums one
+    int begin = qBound(0, step - window / 2, size - 1);
+    int end = qBound(begin + 1, begin + window, size);
+    begin = qMax(0, end - window);
+
+    double sum = 0;
+    for (int i = begin; i < end; i++)
+    {
+        sum += stored ? atom.RMSDs[i].lengthSquared() : GetAtomRMSD(i, AtomNumber).lengthSquared();
+    }
+
+    return static_cast<float>(sum / (end - begin));
 }
 
 QVector<ModelData> Trajectory::GetVAOsData()
@@ -170,135 +465,480 @@ QVector<ModelData> Trajectory::GetVAOsData()
     return VAOsData;
 }
 
-/* -------------------------------------------------------------------------------- */
-
-std::ostream& operator<<(std::ostream& os, const Trajectory& trajectory)
-{
-    QStringList attributes;
-    attributes += QString("%1").arg(trajectory.atoms.size());
-    attributes += QString("%1").arg(trajectory.residues.size());
-    attributes += QString("%1").arg(trajectory.models.size());
-    attributes += QString("%1").arg(trajectory.MinResiduesRMSD);
-    attributes += QString("%1").arg(trajectory.MaxResiduesRMSD);
-    attributes += QString("%1").arg(trajectory.MinResiduesRMSF);
-    attributes += QString("%1").arg(trajectory.MaxResiduesRMSF);
-    attributes += QString("%1").arg(trajectory.MinAtomsRMSD);
-    attributes += QString("%1").arg(trajectory.MaxAtomsRMSD);
-    attributes += QString("%1").arg(trajectory.MinAtomsRMSF);
-    attributes += QString("%1").arg(trajectory.MaxAtomsRMSF);
-
-    os << QString("Trajectory (%1)").arg(attributes.join(", ")).toStdString();
-    return os;
-}
-
-Trajectory::Trajectory()
-{
-    // raw data
-    paths += "../../aspirin_data_no_water/ain_trajectory_3_no_water.ag";
-    paths += "../../aspirin_data_no_water/ain_trajectory_3_no_water.pdb";
-    paths += "../../aspirin_data_no_water/ain_trajectory_3_no_water.alphas";
-    // cooked data
-    paths += "../../cooked.txt";
-}
-
-QVector<Table> Trajectory::CookPDB(QString text)
+QVector<int> Trajectory::GetSelection(QString expression)
 {
-    QVector<Table> tables;
-
-    auto lines = text.split("\n");
-
-    Table table;
+    QVector<int> selection;
 
-    QMap<QString, std::vector<int>> header;
-    header["AtomSerial"] = {6, 10-6 +1};
-    header["AtomName"] = {12, 15-12 +1};
-    header["AlternateLocation"] = {16, +1};
-    header["ResidueName"] = {17, 19-17 +1};
-    header["chain"] = {21, +1};
-    header["ResidueSequence"] = {22, 25-22 +1};
-    header["InsertionCode"] = {26, +1};
-    header["PositionX"] = {30, 37-30 +1};
-    header["PositionY"] = {38, 45-38 +1};
-    header["PositionZ"] = {46, 53-46 +1};
-    header["occupancy"] = {54, 59-54 +1};
-    header["temperature"] = {60, 65-60 +1};
-    header["element"] = {76, 77-76 +1};
-    header["charge"] = {78, 79-78 +1};
+    auto terms = expression.simplified().split(" and ", QString::SkipEmptyParts);
 
-    for (auto line : lines)
+    // parses ranges list like "1-10 15 20-30"
+    auto InRanges = [] (int value, QStringList ranges)
     {
-        if (line.startsWith("MODEL "))
-        {
-            table = Table();
-        }
-
-        if (line.startsWith("ATOM  ") || line.startsWith("HETATM"))
+        for (auto range : ranges)
         {
-            Record record;
+            auto bounds = range.split("-");
+            int min = bounds.first().toInt();
+            int max = bounds.last().toInt();
 
-            for (auto key : header.keys())
+            if (min <= value && value <= max)
             {
-                int p = header[key][0];
-                int n = header[key][1];
-                QString value = line.mid(p, n).trimmed();
-                record[key] = value;
+                return true;
             }
-
-            table += record;
         }
+        return false;
+    };
 
-        if (line.startsWith("ENDMDL"))
+    auto MatchTerm = [=] (Atom atom, QString term)
+    {
+        bool negation = term.startsWith("not ");
+        if (negation)
         {
-            tables += table;
+            term = term.mid(4);
         }
-    }
 
-    return tables;
-}
+        auto values = term.split(" ", QString::SkipEmptyParts);
+        auto keyword = values.takeFirst();
 
-void Trajectory::LoadRawData()
-{
-    for (auto path : paths.mid(0, paths.size() - 1))
-    {
-        QFile file(path);
-        assert(file.open(QIODevice::Text | QIODevice::ReadOnly));
+        Residue residue = residues.value(atom.residue);
 
-        QString text = file.readAll().trimmed();
-        file.close();
+        bool match = false;
 
-        switch (paths.indexOf(file.fileName()))
+        if (keyword == "all")
         {
-        case 0:
+            match = true;
+        }
+        else if (keyword == "backbone")
         {
-            AtomsTable = CookCSV(text);
-            break;
+            match = QStringList({"N", "CA", "C", "O"}).contains(atom.name);
         }
-        case 1:
+        else if (keyword == "heavy")
         {
-            ModelsTable = CookPDB(text);
-            break;
+            match = (atom.element != "H");
         }
-        case 2:
+        else if (keyword == "name")
         {
-            // alphas
-            // ??? = CookCSV(text);
-            break;
+            match = values.contains(atom.name);
+        }
+        else if (keyword == "element")
+        {
+            match = values.contains(atom.element);
+        }
+        else if (keyword == "chain")
+        {
+            match = values.contains(residue.chain);
+        }
+        else if (keyword == "resname")
+        {
+            match = values.contains(residue.name);
+        }
+        else if (keyword == "residue")
+        {
+            match = InRanges(residue.number, values);
+        }
+        else if (keyword == "atom")
+        {
+            match = InRanges(atom.number, values);
+        }
+        else
+        {
+            qDebug() << "unknown selection keyword" << keyword;
         }
+
+        return negation ? !match : match;
+    };
+
+    for (auto atom : atoms)
+    {
+        auto lambda = [=] (QString term) { return MatchTerm(atom, term); };
+
+        if (std::all_of(terms.begin(), terms.end(), lambda))
+        {
+            selection += atom.number;
         }
     }
+
+    return selection;
 }
 
-void Trajectory::CookRawData()
+QVector<QVector<Eigen::Vector3f>> Trajectory::GetConformations(QVector<int> selection)
 {
-    QMap<QString, int> ResidueLookupTable;
+    return GetConformations(models, selection);
+}
 
-    // atoms and residues data
+QVector<QVector<Eigen::Vector3f>> Trajectory::GetConformations(const QVector<Model> &models, QVector<int> selection)
+{
+    QVector<QVector<Eigen::Vector3f>> conformations(models.size());
+    auto data = conformations.data();
 
-    for (auto record : AtomsTable)
+    auto lambda = [&] (int index)
     {
-        Atom atom;
+        const Model &model = models.at(index);
 
-        // serial number
+        QVector<QVector3D> x;
+        for (auto AtomNumber : selection)
+        {
+            x += model[AtomNumber];
+        }
+
+        // center positions with respect to centroid
+        QVector3D c = GetCentroid(x);
+
+        QVector<Eigen::Vector3f> a;
+        for (auto v : x)
+        {
+            a += FromQVector3DToVector3f(v - c);
+        }
+
+        data[index] = a;
+    };
+
+    auto indices = GetIndices(models.size());
+    QtConcurrent::blockingMap(indices, lambda);
+
+    return conformations;
+}
+
+QVector<QVector3D> Trajectory::GetPositions(int step, QVector<int> selection)
+{
+    const Model &model = models.at(step);
+
+    QVector<QVector3D> positions;
+    positions.reserve(selection.size());
+
+    for (auto AtomNumber : selection)
+    {
+        positions += model.value(AtomNumber);
+    }
+
+    return positions;
+}
+
+float Trajectory::GetSuperpositionRMSD(QVector<Eigen::Vector3f> a, QVector<Eigen::Vector3f> b)
+{
+    Eigen::Matrix3f R = GetRotateMatrix(a, b);
+    // GetRMSD returns the mean squared deviation
+    return sqrt(GetRMSD(a, b, R));
+}
+
+void Trajectory::SetCharges()
+{
+    // charges read from the PDB are kept
+    for (const auto &atom : atoms)
+    {
+        if (atom.charge != 0)
+        {
+            return;
+        }
+    }
+
+    // map : residue name -> (atom name -> charge)
+    QMap<QString, QMap<QString, float>> groups;
+    groups["ARG"]["NH1"] = +0.5f;
+    groups["ARG"]["NH2"] = +0.5f;
+    groups["LYS"]["NZ"] = +1.0f;
+    groups["ASP"]["OD1"] = -0.5f;
+    groups["ASP"]["OD2"] = -0.5f;
+    groups["GLU"]["OE1"] = -0.5f;
+    groups["GLU"]["OE2"] = -0.5f;
+    // protonated histidine
+    groups["HIP"]["ND1"] = +0.5f;
+    groups["HIP"]["NE2"] = +0.5f;
+
+    // monoatomic ions
+    QMap<QString, float> ions;
+    ions["NA"] = +1.0f;
+    ions["K"] = +1.0f;
+    ions["MG"] = +2.0f;
+    ions["CA"] = +2.0f;
+    ions["ZN"] = +2.0f;
+    ions["CL"] = -1.0f;
+
+    QString chain;
+
+    for (auto it = residues.cbegin(); it != residues.cend(); ++it)
+    {
+        const Residue &residue = it.value();
+
+        QMap<QString, int> names;
+        for (auto number : residue.atoms)
+        {
+            names[atoms[number].name] = number;
+        }
+
+        for (auto name : names.keys())
+        {
+            atoms[names[name]].charge = groups.value(residue.name).value(name, 0);
+        }
+
+        if (residue.atoms.size() == 1 && residue.name == atoms[residue.atoms.first()].element.toUpper())
+        {
+            atoms[residue.atoms.first()].charge = ions.value(residue.name, 0);
+        }
+
+        // charged termini of the amino acids chains
+        if (names.contains("CA") && names.contains("N") && residue.chain != chain)
+        {
+            atoms[names["N"]].charge += 1.0f;
+        }
+        if (names.contains("OXT") && names.contains("O"))
+        {
+            atoms[names["O"]].charge -= 0.5f;
+            atoms[names["OXT"]].charge -= 0.5f;
+        }
+
+        chain = residue.chain;
+    }
+}
+
+void Trajectory::AddObservable(QString name, ObservableType type, QVector<QVector<int>> groups)
+{
+    Observable observable;
+    observable.name = name;
+    observable.type = type;
+    observable.groups = groups;
+
+    observables += observable;
+}
+
+void Trajectory::SetDefaultObservables()
+{
+    auto heavy = GetSelection("heavy");
+    auto alphas = GetSelection("name CA");
+
+    if (!heavy.isEmpty())
+    {
+        AddObservable("Rg", RADIUS_OF_GYRATION, {heavy});
+    }
+
+    if (alphas.size() > 1)
+    {
+        AddObservable("End-to-end", END_TO_END_DISTANCE, {{alphas.first()}, {alphas.last()}});
+    }
+}
+
+void Trajectory::ComputeObservables()
+{
+    // atoms needed by any observable, read once per model
+    QVector<int> selection;
+    QMap<int, int> indices;
+
+    for (auto observable : observables)
+    {
+        for (auto group : observable.groups)
+        {
+            for (auto AtomNumber : group)
+            {
+                if (!indices.contains(AtomNumber))
+                {
+                    indices[AtomNumber] = selection.size();
+                    selection += AtomNumber;
+                }
+            }
+        }
+    }
+
+    // groups as indices in the shared positions
+    QVector<QVector<QVector<int>>> GroupsIndices;
+    for (auto observable : observables)
+    {
+        QVector<QVector<int>> groups;
+        for (auto group : observable.groups)
+        {
+            QVector<int> g;
+            for (auto AtomNumber : group)
+            {
+                g += indices.value(AtomNumber);
+            }
+            groups += g;
+        }
+        GroupsIndices += groups;
+    }
+
+    QVector<float*> data;
+    for (auto &observable : observables)
+    {
+        observable.values.resize(models.size());
+        data += observable.values.data();
+    }
+
+    auto lambda = [=] (int index)
+    {
+        auto positions = GetPositions(index, selection);
+
+        for (int o = 0; o < observables.size(); o++)
+        {
+            QVector<QVector<QVector3D>> groups;
+            for (auto group : GroupsIndices.at(o))
+            {
+                QVector<QVector3D> x;
+                x.reserve(group.size());
+                for (auto i : group)
+                {
+                    x += positions[i];
+                }
+                groups += x;
+            }
+
+            data[o][index] = observables.at(o).Evaluate(groups);
+        }
+    };
+
+    auto steps = GetIndices(models.size());
+    QtConcurrent::blockingMap(steps, lambda);
+
+    for (auto &observable : observables)
+    {
+        observable.MinValue = MinInitValue;
+        observable.MaxValue = -MinInitValue;
+
+        for (auto value : observable.values)
+        {
+            observable.MinValue = qMin(observable.MinValue, value);
+            observable.MaxValue = qMax(observable.MaxValue, value);
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------------- */
+
+std::ostream& operator<<(std::ostream& os, const Trajectory& trajectory)
+{
+    QStringList attributes;
+    attributes += QString("%1").arg(trajectory.atoms.size());
+    attributes += QString("%1").arg(trajectory.residues.size());
+    attributes += QString("%1").arg(trajectory.models.size());
+    attributes += QString("%1").arg(trajectory.MinResiduesRMSD);
+    attributes += QString("%1").arg(trajectory.MaxResiduesRMSD);
+    attributes += QString("%1").arg(trajectory.MinResiduesRMSF);
+    attributes += QString("%1").arg(trajectory.MaxResiduesRMSF);
+    attributes += QString("%1").arg(trajectory.MinAtomsRMSD);
+    attributes += QString("%1").arg(trajectory.MaxAtomsRMSD);
+    attributes += QString("%1").arg(trajectory.MinAtomsRMSF);
+    attributes += QString("%1").arg(trajectory.MaxAtomsRMSF);
+
+    os << QString("Trajectory (%1)").arg(attributes.join(", ")).toStdString();
+    return os;
+}
+
+Trajectory::Trajectory()
+{
+    // raw data
+    paths += "../../aspirin_data_no_water/ain_trajectory_3_no_water.ag";
+    paths += "../../aspirin_data_no_water/ain_trajectory_3_no_water.pdb";
+    paths += "../../aspirin_data_no_water/ain_trajectory_3_no_water.alphas";
+    // cooked data
+    paths += "../../cooked.txt";
+}
+
+QVector<Table> Trajectory::CookPDB(QString text)
+{
+    QVector<Table> tables;
+
+    auto lines = text.split("\n");
+
+    Table table;
+
+    // a single CRYST1 record (before the first model) applies to all models
+    PeriodicBox box;
+    ModelsBoxes.clear();
+
+    QMap<QString, std::vector<int>> header;
+    header["AtomSerial"] = {6, 10-6 +1};
+    header["AtomName"] = {12, 15-12 +1};
+    header["AlternateLocation"] = {16, +1};
+    header["ResidueName"] = {17, 19-17 +1};
+    header["chain"] = {21, +1};
+    header["ResidueSequence"] = {22, 25-22 +1};
+    header["InsertionCode"] = {26, +1};
+    header["PositionX"] = {30, 37-30 +1};
+    header["PositionY"] = {38, 45-38 +1};
+    header["PositionZ"] = {46, 53-46 +1};
+    header["occupancy"] = {54, 59-54 +1};
+    header["temperature"] = {60, 65-60 +1};
+    header["element"] = {76, 77-76 +1};
+    header["charge"] = {78, 79-78 +1};
+
+    for (auto line : lines)
+    {
+        if (line.startsWith("CRYST1"))
+        {
+            box.lengths = QVector3D(line.mid(6, 9).trimmed().toFloat(), line.mid(15, 9).trimmed().toFloat(), line.mid(24, 9).trimmed().toFloat());
+            box.angles = QVector3D(line.mid(33, 7).trimmed().toFloat(), line.mid(40, 7).trimmed().toFloat(), line.mid(47, 7).trimmed().toFloat());
+        }
+
+        if (line.startsWith("MODEL "))
+        {
+            table = Table();
+        }
+
+        if (line.startsWith("ATOM  ") || line.startsWith("HETATM"))
+        {
+            Record record;
+
+            for (auto key : header.keys())
+            {
+                int p = header[key][0];
+                int n = header[key][1];
+                QString value = line.mid(p, n).trimmed();
+                record[key] = value;
+            }
+
+            table += record;
+        }
+
+        if (line.startsWith("ENDMDL"))
+        {
+            tables += table;
+            ModelsBoxes += box;
+        }
+    }
+
+    return tables;
+}
+
+void Trajectory::LoadRawData()
+{
+    for (auto path : paths.mid(0, paths.size() - 1))
+    {
+        QFile file(path);
+        assert(file.open(QIODevice::Text | QIODevice::ReadOnly));
+
+        QString text = file.readAll().trimmed();
+        file.close();
+
+        switch (paths.indexOf(file.fileName()))
+        {
+        case 0:
+        {
+            AtomsTable = CookCSV(text);
+            break;
+        }
+        case 1:
+        {
+            ModelsTable = CookPDB(text);
+            break;
+        }
+        case 2:
+        {
+            // alphas
+            // ??? = CookCSV(text);
+            break;
+        }
+        }
+    }
+}
+
+void Trajectory::CookRawData()
+{
+    QMap<QString, int> ResidueLookupTable;
+
+    // atoms and residues data
+
+    for (auto record : AtomsTable)
+    {
+        Atom atom;
+
+        // serial number
         atom.number = record["atom_serial"].toInt();
 
         // residue
@@ -350,198 +990,1145 @@ void Trajectory::CookRawData()
         }
         models += model;
     }
+
+    // formal charges column ("2+", "1-") of the first model
+    if (!ModelsTable.isEmpty())
+    {
+        for (auto record : ModelsTable.first())
+        {
+            QString charge = record["charge"];
+            int AtomNumber = record["AtomSerial"].toInt();
+
+            if (charge.size() == 2 && atoms.contains(AtomNumber))
+            {
+                atoms[AtomNumber].charge = (charge[1] == '-' ? -1 : +1) * QString(charge[0]).toFloat();
+            }
+        }
+    }
+    SetCharges();
+
+    // periodic boxes, kept when at least one model has a box
+    boxes.clear();
+    for (auto box : ModelsBoxes)
+    {
+        if (!box.isEmpty())
+        {
+            boxes = ModelsBoxes;
+            break;
+        }
+    }
+
+    if (PeriodicImaging)
+    {
+        ImageModels();
+    }
 }
 
-// a : reference conformation
-// b : movement conformation
-// both conformations should be centered with respect to their centroid
+void Trajectory::GetMolecules(QVector<int> &order, QVector<int> &MoleculeStarts)
+{
+    order.clear();
+    MoleculeStarts.clear();
+
+    auto keys = models.first().keys().toVector();
+
+    auto GetIndex = [&] (int number)
+    {
+        auto it = std::lower_bound(keys.begin(), keys.end(), number);
+        return (it != keys.end() && *it == number) ? static_cast<int>(it - keys.begin()) : -1;
+    };
+
+    const Model &FirstModel = models.first();
+    PeriodicBox box = boxes.value(0);
+    Eigen::Matrix3f H = box.GetMatrix();
+    Eigen::Matrix3f Hi = H.inverse();
+
+    // minimum image distance in the first model
+    auto GetDistance = [&] (int a, int b)
+    {
+        QVector3D d = FirstModel.value(a) - FirstModel.value(b);
+        Eigen::Vector3f s = Hi * Eigen::Vector3f(d.x(), d.y(), d.z());
+        for (int i = 0; i < 3; i++)
+        {
+            s[i] -= std::floor(s[i] + 0.5f);
+        }
+        return (H * s).norm();
+    };
+
+    // consecutive residues of a chain belong to the same molecule when any of their atoms are bonded
+    auto Bonded = [&] (const Residue &x, const Residue &y)
+    {
+        if (x.chain != y.chain)
+        {
+            return false;
+        }
+
+        for (auto a : x.atoms)
+        {
+            for (auto b : y.atoms)
+            {
+                if (GetDistance(a, b) < 2.0f)
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    };
+
+    const Residue *previous = nullptr;
+
+    for (const auto &residue : residues)
+    {
+        if (previous == nullptr || !Bonded(*previous, residue))
+        {
+            MoleculeStarts += order.size();
+        }
+
+        for (auto number : residue.atoms)
+        {
+            int index = GetIndex(number);
+            if (index >= 0)
+            {
+                order += index;
+            }
+        }
+
+        previous = &residue;
+    }
+
+    MoleculeStarts += order.size();
+}
+
+void Trajectory::ImageModels()
+{
+    if (boxes.isEmpty() || models.isEmpty())
+    {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<int> order;
+    QVector<int> MoleculeStarts;
+    GetMolecules(order, MoleculeStarts);
+
+    int size = order.size();
+    int count = MoleculeStarts.size() - 1;
+    int AtomsCount = models.first().size();
+
+    // traversal slots of the centered selection
+    QVector<int> TraversalSlots(AtomsCount, -1);
+    for (int k = 0; k < size; k++)
+    {
+        TraversalSlots[order[k]] = k;
+    }
+
+    auto keys = models.first().keys().toVector();
+    QVector<int> center;
+    for (auto number : GetSelection(ImagingSelection))
+    {
+        auto it = std::lower_bound(keys.begin(), keys.end(), number);
+        if (it != keys.end() && *it == number && TraversalSlots[static_cast<int>(it - keys.begin())] >= 0)
+        {
+            center += TraversalSlots[static_cast<int>(it - keys.begin())];
+        }
+    }
+
+    Model *data = models.data();
+
+    // each frame is imaged in place, through per-thread buffers of a single frame
+    auto lambda = [&] (QPair<int, int> chunk)
+    {
+        QVector<QVector3D> positions(AtomsCount);
+
+        // positions and bond vectors in traversal order, SoA
+        QVector<float> x(size), y(size), z(size);
+        QVector<float> dx(size), dy(size), dz(size);
+
+        for (int step = chunk.first; step < chunk.second; step++)
+        {
+            PeriodicBox box = boxes.value(step, boxes.last());
+            Model &model = data[step];
+
+            if (box.isEmpty() || model.size() != AtomsCount)
+            {
+                continue;
+            }
+
+            Eigen::Matrix3f H = box.GetMatrix();
+            Eigen::Matrix3f Hi = H.inverse();
+
+            int i = 0;
+            for (auto it = model.cbegin(); it != model.cend(); ++it)
+            {
+                positions[i++] = it.value();
+            }
+
+            for (int k = 0; k < size; k++)
+            {
+                QVector3D p = positions[order[k]];
+                x[k] = p.x();
+                y[k] = p.y();
+                z[k] = p.z();
+            }
+
+            // minimum image of the vectors between consecutive atoms, in fractional coordinates
+            // (both matrices are upper triangular)
+            {
+                const float h00 = H(0, 0), h01 = H(0, 1), h02 = H(0, 2), h11 = H(1, 1), h12 = H(1, 2), h22 = H(2, 2);
+                const float i00 = Hi(0, 0), i01 = Hi(0, 1), i02 = Hi(0, 2), i11 = Hi(1, 1), i12 = Hi(1, 2), i22 = Hi(2, 2);
+
+                const float *X = x.constData(), *Y = y.constData(), *Z = z.constData();
+                float *DX = dx.data(), *DY = dy.data(), *DZ = dz.data();
+
+                for (int k = 1; k < size; k++)
+                {
+                    float ux = X[k] - X[k - 1];
+                    float uy = Y[k] - Y[k - 1];
+                    float uz = Z[k] - Z[k - 1];
+
+                    float sx = i00 * ux + i01 * uy + i02 * uz;
+                    float sy = i11 * uy + i12 * uz;
+                    float sz = i22 * uz;
+
+                    sx -= std::floor(sx + 0.5f);
+                    sy -= std::floor(sy + 0.5f);
+                    sz -= std::floor(sz + 0.5f);
+
+                    DX[k] = h00 * sx + h01 * sy + h02 * sz;
+                    DY[k] = h11 * sy + h12 * sz;
+                    DZ[k] = h22 * sz;
+                }
+            }
+
+            // whole molecules : positions rebuilt along the traversal from each molecule first atom
+            for (int m = 0; m < count; m++)
+            {
+                for (int k = MoleculeStarts[m] + 1; k < MoleculeStarts[m + 1]; k++)
+                {
+                    x[k] = x[k - 1] + dx[k];
+                    y[k] = y[k - 1] + dy[k];
+                    z[k] = z[k - 1] + dz[k];
+                }
+            }
+
+            // the selection centroid is moved to the box center
+            Eigen::Vector3f shift = H * Eigen::Vector3f(0.5f, 0.5f, 0.5f);
+            if (!center.isEmpty())
+            {
+                Eigen::Vector3f centroid = Eigen::Vector3f::Zero();
+                for (auto k : center)
+                {
+                    centroid += Eigen::Vector3f(x[k], y[k], z[k]);
+                }
+                shift -= centroid / center.size();
+            }
+
+            // each molecule is wrapped into the box as a whole, by its centroid
+            for (int m = 0; m < count; m++)
+            {
+                int begin = MoleculeStarts[m];
+                int end = MoleculeStarts[m + 1];
+
+                if (begin == end)
+                {
+                    continue;
+                }
+
+                Eigen::Vector3f centroid = Eigen::Vector3f::Zero();
+                for (int k = begin; k < end; k++)
+                {
+                    centroid += Eigen::Vector3f(x[k], y[k], z[k]);
+                }
+                centroid = centroid / (end - begin) + shift;
+
+                Eigen::Vector3f s = Hi * centroid;
+                for (int j = 0; j < 3; j++)
+                {
+                    s[j] = std::floor(s[j]);
+                }
+                Eigen::Vector3f offset = shift - H * s;
+
+                for (int k = begin; k < end; k++)
+                {
+                    x[k] += offset.x();
+                    y[k] += offset.y();
+                    z[k] += offset.z();
+                }
+            }
+
+            for (int k = 0; k < size; k++)
+            {
+                positions[order[k]] = QVector3D(x[k], y[k], z[k]);
+            }
+
+            i = 0;
+            for (auto it = model.begin(); it != model.end(); ++it)
+            {
+                it.value() = positions[i++];
+            }
+        }
+    };
+
+    auto chunks = GetChunks(models.size());
+    QtConcurrent::blockingMap(chunks, lambda);
+
+    qDebug() << "periodic imaging" << count << "molecules" << timer.elapsed() << "ms";
+}
+
+// a : reference conformation
+// b : movement conformation
+// both conformations should be centered with respect to their centroid
 // the returned matrix is in column-major order
 Eigen::Matrix3f Trajectory::GetRotateMatrix(QVector<Eigen::Vector3f> a, QVector<Eigen::Vector3f> b)
+{
+    assert(a.size() == b.size());
+
+    return GetRotateMatrix(a.constData(), b.constData(), a.size());
+}
+
+Eigen::Matrix3f Trajectory::GetRotateMatrix(const Eigen::Vector3f *a, const Eigen::Vector3f *b, int size)
+{
+    // covariance matrix
+    Eigen::Matrix3f C = Eigen::Matrix3f::Zero();
+    for (int i = 0; i < size; i++)
+    {
+        C += b[i] * a[i].transpose();
+    }
+
+    // singular value decomposition
+    Eigen::JacobiSVD<Eigen::Matrix3f> SVD(C, Eigen::ComputeFullU | Eigen::ComputeFullV);
+
+    // left and right singular vectors
+    Eigen::Matrix3f U = SVD.matrixU();
+    Eigen::Matrix3f V = SVD.matrixV();
+
+    // proper rotation test
+    int d = signbit(C.determinant()) ? -1 : +1;
+
+    // optimal rotation
+    Eigen::Matrix3f D = Eigen::DiagonalMatrix<float, 3>(1, 1, d);
+    Eigen::Matrix3f R = V * D * U.transpose();
+
+    return R;
+}
+
+// a : reference conformation
+// b : movement conformation
+// R : optimal rotation matrix
+// both conformations should be centered with respect to their centroid
+float Trajectory::GetRMSD(QVector<Eigen::Vector3f> a, QVector<Eigen::Vector3f> b, Eigen::Matrix3f R)
 {
     int size = a.size();
     assert(size == b.size());
 
-    Eigen::MatrixXf A(3, size);
-    Eigen::MatrixXf B(3, size);
+    float RMSD = 0;
+    for (int i = 0; i < size; i++)
+    {
+        RMSD += (R * b[i] - a[i]).squaredNorm();
+    }
+    RMSD /= size;
+
+    return RMSD;
+}
+
+/*
+Eigen::Vector3f Trajectory::GetRMSD(QVector<Eigen::Vector3f> a, QVector<Eigen::Vector3f> b, Eigen::Matrix3f R)
+{
+    int size = a.size();
+    assert(size == b.size());
+
+    Eigen::Vector3f RMSD = Eigen::Vector3f::Zero();
+    for (int i = 0; i < size; i++)
+    {
+        RMSD += R * b[i] - a[i];
+    }
+
+    return RMSD;
+}
+*/
+
+float Trajectory::GetRMSF(QVector<Eigen::Vector3f> RMSDs)
+{
+    QVector<float> SquaredNorms;
+    for (auto RMSD : RMSDs)
+    {
+        SquaredNorms += RMSD.squaredNorm();
+    }
+
+    return GetAverage(SquaredNorms);
+}
+
+float Trajectory::GetRMSF(QVector<QVector3D> RMSDs)
+{
+    QVector<float> SquaredNorms;
+    for (auto RMSD : RMSDs)
+    {
+        SquaredNorms += RMSD.lengthSquared();
+    }
+
+    return GetAverage(SquaredNorms);
+}
+
+void Trajectory::CookResidues()
+{
+    if (OnlineStatistics || AverageReference || CompactRMSDs)
+    {
+        // residues and atoms are cooked together
+        CookOnline();
+        return;
+    }
+
+    auto FirstModel = models.first();
+
+    // initialize residues Min and Max RMSD
+    MinResiduesRMSD = MinInitValue;
+    MaxResiduesRMSD = MaxInitValue;
+
+    // initialize residues Min and Max RMSF
+    MinResiduesRMSF = MinInitValue;
+    MaxResiduesRMSF = MaxInitValue;
+
+    for (auto &residue : residues)
+    {
+        // reference conformation : 1st model
+
+        QVector<QVector3D> x;
+        QVector<Eigen::Vector3f> a;
+
+        // get conformation atoms positions
+        for (auto AtomNumber : residue.atoms)
+        {
+            x += FirstModel[AtomNumber];
+        }
+
+        // get conformation centroid
+        QVector3D c = GetCentroid(x);
+
+        for (auto &v : x)
+        {
+            // center positions with respect to centroid
+            v = v - c;
+            // from QVector3D to Vector3f
+            a += FromQVector3DToVector3f(v);
+        }
+        ConformationLookupTable[residue.number] += a;
+
+        // get conformation rotate matrix
+        Eigen::Matrix3f R = GetRotateMatrix(a, a);
+        RotateMatrixLookupTable[residue.number] += R;
+
+        // get conformation RMSD
+        residue.RMSDs += GetRMSD(a, a, R);
+
+        // initialize residue Min and Max RMSD
+        residue.MinRMSD = MinInitValue; // nella ricerca del valore min per RMSD non viene considerata la RMSD della prima configurazione essendo sempre nulla
+        residue.MaxRMSD = MaxInitValue;
+
+        for (auto model : models.mid(1))
+        {
+            // movement conformation
+
+            QVector<QVector3D> y;
+            QVector<Eigen::Vector3f> b;
+
+            // get conformation atoms positions
+            for (auto AtomNumber : residue.atoms)
+            {
+                y += model[AtomNumber];
+            }
+
+            // get conformation centroid
+            QVector3D c = GetCentroid(y);
+
+            for (auto &v : y)
+            {
+                // center positions with respect to centroid
+                v = v - c;
+                // from QVector3D to Vector3f
+                b += FromQVector3DToVector3f(v);
+            }
+            ConformationLookupTable[residue.number] += b;
+
+            // get conformation rotate matrix
+            Eigen::Matrix3f R = GetRotateMatrix(a, b);
+            RotateMatrixLookupTable[residue.number] += R;
+
+            // get conformation RMSD
+            float RMSD = GetRMSD(a, b, R);
+            // Eigen::Vector3f RMSD = GetRMSD(a, b, R);
+            residue.RMSDs += RMSD;
+
+            // update residue Min and Max RMSD
+            residue.MinRMSD = (RMSD < residue.MinRMSD) ? RMSD : residue.MinRMSD;
+            residue.MaxRMSD = (RMSD > residue.MaxRMSD) ? RMSD : residue.MaxRMSD;
+            // float SquaredNorm = RMSD.squaredNorm();
+            // residue.MinRMSD = (SquaredNorm < residue.MinRMSD) ? SquaredNorm : residue.MinRMSD;
+            // residue.MaxRMSD = (SquaredNorm > residue.MaxRMSD) ? SquaredNorm : residue.MaxRMSD;
+        }
+
+        // get residue RMSF
+        residue.RMSF = GetAverage(residue.RMSDs);
+        // residue.RMSF = GetRMSF(residue.RMSDs);
+
+        // update residues Min and Max RMSD
+        MinResiduesRMSD = (residue.MinRMSD < MinResiduesRMSD) ? residue.MinRMSD : MinResiduesRMSD;
+        MaxResiduesRMSD = (residue.MaxRMSD > MaxResiduesRMSD) ? residue.MaxRMSD : MaxResiduesRMSD;
+
+        // update residues Min and Max RMSF
+        MinResiduesRMSF = (residue.RMSF < MinResiduesRMSF) ? residue.RMSF : MinResiduesRMSF;
+        MaxResiduesRMSF = (residue.RMSF > MaxResiduesRMSF) ? residue.RMSF : MaxResiduesRMSF;
+    }
+}
+
+void Trajectory::CookAtoms()
+{
+    if (OnlineStatistics || AverageReference || CompactRMSDs)
+    {
+        // already cooked by CookOnline
+        return;
+    }
+
+    // initialize atoms Min and Max RMSD
+    MinAtomsRMSD = MinInitValue;
+    MaxAtomsRMSD = MaxInitValue;
+
+    // initialize atoms Min and Max RMSF
+    MinAtomsRMSF = MinInitValue;
+    MaxAtomsRMSF = MaxInitValue;
+
+    for (auto &atom : atoms)
+    {
+        // atom conformation index
+        int AtomIndex = residues[atom.residue].atoms.indexOf(atom.number);
+
+        // reference conformation : 1st model
+        auto x = ConformationLookupTable[atom.residue].first();
+
+        // get atom position
+        Eigen::Vector3f a = x[AtomIndex];
+
+        // get rotate matrix
+        Eigen::Matrix3f R = RotateMatrixLookupTable[atom.residue][0];
+
+        // get atom RMSD
+        Eigen::Vector3f RMSD = (R * a - a);
+        // atom.RMSDs += RMSD;
+        atom.RMSDs += FromVector3fToQVector3D(RMSD);
+
+        // initialize atom Min and Max RMSD
+        atom.MinRMSD = MinInitValue;
+        atom.MaxRMSD = MaxInitValue;
+
+        for (int i = 1; i < models.size(); i++)
+        {
+            // movement conformation
+            auto y = ConformationLookupTable[atom.residue][i];
+
+            // get atom position
+            Eigen::Vector3f b = y[AtomIndex];
+
+            // get rotate matrix
+            Eigen::Matrix3f R = RotateMatrixLookupTable[atom.residue][i];
+
+            // get atom RMSD
+            Eigen::Vector3f RMSD = (R * b - a);
+            // atom.RMSDs += RMSD;
+            atom.RMSDs += FromVector3fToQVector3D(RMSD);
+
+            // update atom Min and Max RMSD
+            float SquaredNorm = RMSD.squaredNorm();
+            atom.MinRMSD = (SquaredNorm < atom.MinRMSD) ? SquaredNorm : atom.MinRMSD;
+            atom.MaxRMSD = (SquaredNorm > atom.MaxRMSD) ? SquaredNorm : atom.MaxRMSD;
+        }
+
+        // get atom RMSF
+        // atom.RMSF = GetAverage(atom.RMSDs);
+        atom.RMSF = GetRMSF(atom.RMSDs);
+
+        // update atoms Min and Max RMSD
+        MinAtomsRMSD = (atom.MinRMSD < MinAtomsRMSD) ? atom.MinRMSD : MinAtomsRMSD;
+        MaxAtomsRMSD = (atom.MaxRMSD > MaxAtomsRMSD) ? atom.MaxRMSD : MaxAtomsRMSD;
+
+        // update atoms Min and Max RMSF
+        MinAtomsRMSF = (atom.RMSF < MinAtomsRMSF) ? atom.RMSF : MinAtomsRMSF;
+        MaxAtomsRMSF = (atom.RMSF > MaxAtomsRMSF) ? atom.RMSF : MaxAtomsRMSF;
+    }
+
+    SetPrefixSums();
+}
+
+QVector<QVector<Eigen::Vector3f>> Trajectory::GetFirstModelReferences()
+{
+    const Model &FirstModel = models.first();
+
+    QVector<QVector<Eigen::Vector3f>> references;
+
+    for (auto residue : residues)
+    {
+        QVector<QVector3D> x;
+        for (auto AtomNumber : residue.atoms)
+        {
+            x += FirstModel[AtomNumber];
+        }
+
+        QVector3D c = GetCentroid(x);
+
+        QVector<Eigen::Vector3f> a;
+        for (auto v : x)
+        {
+            a += FromQVector3DToVector3f(v - c);
+        }
+        references += a;
+    }
+
+    return references;
+}
+
+QVector<QVector<Eigen::Vector3f>> Trajectory::GetAverageReferences()
+{
+    int size = models.size();
+
+    // residues atoms, concatenated in residues order
+    QVector<int> AtomNumbers;
+    QVector<int> ResidueStarts;
+    for (auto residue : residues)
+    {
+        ResidueStarts += AtomNumbers.size();
+        AtomNumbers += residue.atoms;
+    }
+    ResidueStarts += AtomNumbers.size();
+
+    int count = AtomNumbers.size();
+    int ResiduesCount = ResidueStarts.size() - 1;
+
+    int MaxResidueSize = 0;
+    for (int r = 0; r < ResiduesCount; r++)
+    {
+        MaxResidueSize = qMax(MaxResidueSize, ResidueStarts.at(r + 1) - ResidueStarts.at(r));
+    }
+
+    // residue r of model m, centered into x (re-read from the models at each iteration,
+    // the centered trajectory would double the memory)
+    auto center = [&] (const Model &model, int r, Eigen::Vector3f *x)
+    {
+        int begin = ResidueStarts.at(r);
+        int end = ResidueStarts.at(r + 1);
+
+        Eigen::Vector3f c = Eigen::Vector3f::Zero();
+        for (int i = begin; i < end; i++)
+        {
+            x[i - begin] = FromQVector3DToVector3f(model.value(AtomNumbers.at(i)));
+            c += x[i - begin];
+        }
+        c /= qMax(1, end - begin);
+
+        for (int i = begin; i < end; i++)
+        {
+            x[i - begin] -= c;
+        }
+    };
+
+    // initial average : 1st model
+    QVector<Eigen::Vector3f> average(count);
+    for (int r = 0; r < ResiduesCount; r++)
+    {
+        center(models.first(), r, average.data() + ResidueStarts.at(r));
+    }
+
+    // each worker streams a contiguous block of models and sums their superposed conformations
+    // (fixed blocks, the average does not depend on the threads count)
+    struct Worker
+    {
+        int begin;
+        int end;
+        QVector<Eigen::Vector3f> sums;
+        // centered residue scratch, reused for every residue of every model
+        QVector<Eigen::Vector3f> buffer;
+    };
+
+    QVector<Worker> workers;
+    for (auto chunk : GetReductionBlocks(size))
+    {
+        Worker worker;
+        worker.begin = chunk.first;
+        worker.end = chunk.second;
+        workers += worker;
+    }
+
+    for (int iteration = 0; iteration < MaxAverageIterations; iteration++)
+    {
+        const Eigen::Vector3f *a = average.constData();
+
+        auto lambda = [&] (Worker &worker)
+        {
+            worker.sums.fill(Eigen::Vector3f::Zero(), count);
+            worker.buffer.resize(MaxResidueSize);
+            Eigen::Vector3f *b = worker.buffer.data();
+
+            for (int m = worker.begin; m < worker.end; m++)
+            {
+                const Model &model = models.at(m);
+
+                for (int r = 0; r < ResiduesCount; r++)
+                {
+                    int begin = ResidueStarts.at(r);
+                    int end = ResidueStarts.at(r + 1);
+
+                    center(model, r, b);
+
+                    Eigen::Matrix3f R = GetRotateMatrix(a + begin, b, end - begin);
+
+                    for (int i = begin; i < end; i++)
+                    {
+                        worker.sums[i] += R * b[i - begin];
+                    }
+                }
+            }
+        };
+
+        QtConcurrent::blockingMap(workers, lambda);
+
+        // merge the partial sums along the fixed pairwise tree
+        auto merge = [count] (Worker &a, const Worker &b)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                a.sums[i] += b.sums[i];
+            }
+        };
+        PairwiseMerge(workers, merge);
+
+        QVector<Eigen::Vector3f> updated = workers.first().sums;
+
+        // convergence : mean squared displacement of the average
+        float change = 0;
+        for (int i = 0; i < count; i++)
+        {
+            updated[i] /= size;
+            change += (updated[i] - average[i]).squaredNorm();
+        }
+        change /= qMax(1, count);
+
+        average = updated;
+
+        if (change < AverageTolerance)
+        {
+            qDebug() << "average reference converged in" << iteration + 1 << "iterations";
+            break;
+        }
+    }
+
+    QVector<QVector<Eigen::Vector3f>> references;
+    for (int r = 0; r < ResiduesCount; r++)
+    {
+        references += average.mid(ResidueStarts[r], ResidueStarts[r + 1] - ResidueStarts[r]);
+    }
+
+    return references;
+}
+
+void Trajectory::Recook()
+{
+    if (models.isEmpty())
+    {
+        return;
+    }
+
+    // the offline cooking appends to the RMSDs histories and lookup tables
+    for (auto &residue : residues)
+    {
+        residue.RMSDs.clear();
+        residue.alignments.clear();
+        residue.reference.clear();
+    }
+    for (auto &atom : atoms)
+    {
+        atom.RMSDs.clear();
+    }
+    ConformationLookupTable.clear();
+    RotateMatrixLookupTable.clear();
+
+    CookResidues();
+    CookAtoms();
+}
+
+void Trajectory::SetSmoothing(SmoothingFilter filter, int window)
+{
+    if (models.isEmpty())
+    {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (SourceModels.isEmpty())
+    {
+        SourceModels = models;
+    }
+
+    smoothing = filter;
+    SmoothingWindow = window;
+
+    if (filter == NO_SMOOTHING || window < 3)
+    {
+        models = SourceModels;
+        SourceModels.clear();
+    }
+    else
+    {
+        models = GetSmoothedModels(SourceModels, filter, window);
+    }
+
+    qDebug() << "smoothing" << window << "frames" << timer.elapsed() << "ms";
+}
+
+QVector<Trajectory::Model> Trajectory::GetSmoothedModels(const QVector<Model> &source, SmoothingFilter filter, int window)
+{
+    int frames = source.size();
+    auto keys = source.first().keys().toVector();
+    int size = keys.size();
+
+    // half window, the window is odd
+    int h = qMax(1, window / 2);
+
+    // alignment of each model on the first one : x' = R x + t
+    QVector<Eigen::Matrix3f> rotations(frames);
+    QVector<Eigen::Vector3f> translations(frames);
+    {
+        auto GetCentered = [&] (int step, Eigen::Vector3f &centroid)
+        {
+            QVector<Eigen::Vector3f> x;
+            x.reserve(size);
+            centroid = Eigen::Vector3f::Zero();
+            for (auto p : source.at(step))
+            {
+                x += FromQVector3DToVector3f(p);
+                centroid += x.last();
+            }
+            centroid /= qMax(1, size);
+            for (auto &v : x)
+            {
+                v -= centroid;
+            }
+            return x;
+        };
+
+        Eigen::Vector3f c0;
+        auto reference = GetCentered(0, c0);
+
+        auto lambda = [&] (int step)
+        {
+            Eigen::Vector3f c;
+            auto x = GetCentered(step, c);
+            Eigen::Matrix3f R = GetRotateMatrix(reference.constData(), x.constData(), size);
+
+            rotations[step] = R;
+            translations[step] = c0 - R * c;
+        };
+
+        auto steps = GetIndices(frames);
+        QtConcurrent::blockingMap(steps, lambda);
+    }
+
+    // the smoothed models are copies of the source ones, written in place
+    QVector<Model> smoothed = source;
+    for (auto &model : smoothed)
+    {
+        model.detach();
+    }
+
+    // Savitzky-Golay (quadratic) weights : y = a S0 - b S2
+    double n = 2 * h + 1;
+    double d = (2.0 * h - 1) * (2.0 * h + 1) * (2.0 * h + 3);
+    double a = 3.0 * (3.0 * h * h + 3.0 * h - 1) / d;
+    double b = 15.0 / d;
+    bool average = (filter == MOVING_AVERAGE);
+
+    // each atoms chunk streams all the frames
+    auto lambda = [&] (QPair<int, int> chunk)
+    {
+        int count = chunk.second - chunk.first;
+        int first = keys[chunk.first];
+
+        // running moments of the window around step k, j = -h ... h :
+        // S0 = sum x(k+j), S1 = sum j x(k+j), S2 = sum j^2 x(k+j)
+        QVector<Eigen::Vector3d> S0(count, Eigen::Vector3d::Zero());
+        QVector<Eigen::Vector3d> S1(count, Eigen::Vector3d::Zero());
+        QVector<Eigen::Vector3d> S2(count, Eigen::Vector3d::Zero());
+
+        QVector<Eigen::Vector3d> in(count), out(count);
+
+        // aligned chunk positions, the frames beyond the ends repeat the first and last models
+        auto GetAligned = [&] (int step, QVector<Eigen::Vector3d> &x)
+        {
+            step = qBound(0, step, frames - 1);
+            const Eigen::Matrix3f &R = rotations.at(step);
+            const Eigen::Vector3f &t = translations.at(step);
+
+            auto it = source.at(step).constFind(first);
+            for (int i = 0; i < count; i++, ++it)
+            {
+                x[i] = (R * FromQVector3DToVector3f(it.value()) + t).cast<double>();
+            }
+        };
 
-    for (int i = 0; i < size; i++)
-    {
-        A.block(0, i, 3, 1) << a[i];
-        B.block(0, i, 3, 1) << b[i];
-    }
+        for (int j = -h; j <= h; j++)
+        {
+            GetAligned(j, in);
+            for (int i = 0; i < count; i++)
+            {
+                S0[i] += in[i];
+                S1[i] += j * in[i];
+                S2[i] += j * j * in[i];
+            }
+        }
 
-    // covariance matrix
-    Eigen::MatrixXf C = B * A.transpose();
+        for (int k = 0; k < frames; k++)
+        {
+            auto it = smoothed[k].find(first);
+            for (int i = 0; i < count; i++, ++it)
+            {
+                Eigen::Vector3d y = average ? Eigen::Vector3d(S0[i] / n) : Eigen::Vector3d(a * S0[i] - b * S2[i]);
+                it.value() = QVector3D(static_cast<float>(y.x()), static_cast<float>(y.y()), static_cast<float>(y.z()));
+            }
 
-    // singular value decomposition
-    Eigen::JacobiSVD<Eigen::MatrixXf> SVD(C, Eigen::ComputeThinU | Eigen::ComputeThinV);
+            if (k + 1 == frames)
+            {
+                break;
+            }
 
-    // left and right singular vectors
-    Eigen::Matrix3f U = SVD.matrixU();
-    Eigen::Matrix3f V = SVD.matrixV();
+            // slide the window : x(k-h) leaves, x(k+h+1) enters, moments re-centered on k+1
+            GetAligned(k - h, out);
+            GetAligned(k + h + 1, in);
 
-    // proper rotation test
-    int d = signbit(C.determinant()) ? -1 : +1;
+            for (int i = 0; i < count; i++)
+            {
+                Eigen::Vector3d A0 = S0[i] - out[i] + in[i];
+                Eigen::Vector3d A1 = S1[i] + h * out[i] + (h + 1) * in[i];
+                Eigen::Vector3d A2 = S2[i] - h * h * out[i] + (h + 1) * (h + 1) * in[i];
 
-    // optimal rotation
-    Eigen::Matrix3f D = Eigen::DiagonalMatrix<float, 3>(1, 1, d);
-    Eigen::Matrix3f R = V * D * U.transpose();
+                S0[i] = A0;
+                S1[i] = A1 - A0;
+                S2[i] = A2 - 2 * A1 + A0;
+            }
+        }
+    };
 
-    return R;
+    auto chunks = GetChunks(size);
+    QtConcurrent::blockingMap(chunks, lambda);
+
+    return smoothed;
 }
 
-// a : reference conformation
-// b : movement conformation
-// R : optimal rotation matrix
-// both conformations should be centered with respect to their centroid
-float Trajectory::GetRMSD(QVector<Eigen::Vector3f> a, QVector<Eigen::Vector3f> b, Eigen::Matrix3f R)
+void Trajectory::CookOnline()
 {
-    int size = a.size();
-    assert(size == b.size());
+    int size = models.size();
 
-    float RMSD = 0;
-    for (int i = 0; i < size; i++)
+    QVector<int> ResidueNumbers = residues.keys().toVector();
+    QVector<int> AtomNumbers = atoms.keys().toVector();
+
+    // map : atom number -> atom index
+    QMap<int, int> AtomIndices;
+    for (int i = 0; i < AtomNumbers.size(); i++)
     {
-        RMSD += (R * b[i] - a[i]).squaredNorm();
+        AtomIndices[AtomNumbers[i]] = i;
     }
-    RMSD /= size;
 
-    return RMSD;
-}
+    // reference conformations : 1st model or average structure
+    auto references = AverageReference ? GetAverageReferences() : GetFirstModelReferences();
 
-/*
-Eigen::Vector3f Trajectory::GetRMSD(QVector<Eigen::Vector3f> a, QVector<Eigen::Vector3f> b, Eigen::Matrix3f R)
-{
-    int size = a.size();
-    assert(size == b.size());
+    // the RMSDs history is optional in online statistics mode only
+    bool StoreRMSDs = this->StoreRMSDs || !OnlineStatistics;
 
-    Eigen::Vector3f RMSD = Eigen::Vector3f::Zero();
-    for (int i = 0; i < size; i++)
+    for (auto &residue : residues)
     {
-        RMSD += R * b[i] - a[i];
+        residue.RMSDs.clear();
+        if (StoreRMSDs)
+        {
+            residue.RMSDs.resize(size);
+        }
     }
 
-    return RMSD;
-}
-*/
-
-float Trajectory::GetRMSF(QVector<Eigen::Vector3f> RMSDs)
-{
-    float RMSF = 0;
-    for (auto RMSD : RMSDs)
+    for (auto &atom : atoms)
     {
-        RMSF += RMSD.squaredNorm();
+        atom.RMSDs.clear();
+        if (StoreRMSDs && !CompactRMSDs)
+        {
+            atom.RMSDs.resize(size);
+        }
     }
-    RMSF /= RMSDs.size();
 
-    return RMSF;
-}
-
-float Trajectory::GetRMSF(QVector<QVector3D> RMSDs)
-{
-    float RMSF = 0;
-    for (auto RMSD : RMSDs)
+    // compact mode : the atoms RMSDs are derived from the residues superpositions
+    for (int r = 0; r < ResidueNumbers.size(); r++)
     {
-        RMSF += RMSD.lengthSquared();
-    }
-    RMSF /= RMSDs.size();
-
-    return RMSF;
-}
+        Residue &residue = residues[ResidueNumbers[r]];
 
-void Trajectory::CookResidues()
-{
-    auto FirstModel = models.first();
+        residue.alignments.clear();
+        residue.reference.clear();
 
-    // initialize residues Min and Max RMSD
-    MinResiduesRMSD = MinInitValue;
-    MaxResiduesRMSD = MaxInitValue;
+        if (CompactRMSDs)
+        {
+            residue.alignments.resize(12 * size);
+            for (auto v : references.at(r))
+            {
+                residue.reference += FromVector3fToQVector3D(v);
+            }
+        }
+    }
 
-    // initialize residues Min and Max RMSF
-    MinResiduesRMSF = MinInitValue;
-    MaxResiduesRMSF = MaxInitValue;
+    QVector<float*> ResidueAlignments;
+    for (auto &residue : residues)
+    {
+        ResidueAlignments += CompactRMSDs ? residue.alignments.data() : nullptr;
+    }
 
+    // RMSDs history buffers, written by the workers on disjoint models
+    QVector<float*> ResidueRMSDs;
     for (auto &residue : residues)
     {
-        // reference conformation : 1st model
+        ResidueRMSDs += StoreRMSDs ? residue.RMSDs.data() : nullptr;
+    }
 
-        QVector<QVector3D> x;
-        QVector<Eigen::Vector3f> a;
+    QVector<QVector3D*> AtomRMSDs;
+    for (auto &atom : atoms)
+    {
+        AtomRMSDs += atom.RMSDs.isEmpty() ? nullptr : atom.RMSDs.data();
+    }
 
-        // get conformation atoms positions
+    // residues atoms numbers and indices
+    QVector<QVector<int>> ResidueAtomNumbers;
+    QVector<QVector<int>> ResidueAtomIndices;
+    for (auto residue : residues)
+    {
+        QVector<int> indices;
         for (auto AtomNumber : residue.atoms)
         {
-            x += FirstModel[AtomNumber];
+            indices += AtomIndices[AtomNumber];
         }
+        ResidueAtomNumbers += residue.atoms;
+        ResidueAtomIndices += indices;
+    }
 
-        // get conformation centroid
-        QVector3D c = GetCentroid(x);
+    // each worker streams a contiguous block of models
+    // (fixed blocks, the statistics do not depend on the threads count)
+    struct Worker
+    {
+        int begin;
+        int end;
+        QVector<RunningStatistics> residues;
+        QVector<RunningStatistics> atoms;
+    };
+
+    QVector<Worker> workers;
+    for (auto chunk : GetReductionBlocks(size))
+    {
+        Worker worker;
+        worker.begin = chunk.first;
+        worker.end = chunk.second;
+        worker.residues.resize(ResidueNumbers.size());
+        worker.atoms.resize(AtomNumbers.size());
+        workers += worker;
+    }
 
-        for (auto &v : x)
+    auto lambda = [&] (Worker &worker)
+    {
+        for (int m = worker.begin; m < worker.end; m++)
         {
-            // center positions with respect to centroid
-            v = v - c;
-            // from QVector3D to Vector3f
-            a += FromQVector3DToVector3f(v);
-        }
-        ConformationLookupTable[residue.number] += a;
+            const Model &model = models.at(m);
 
-        // get conformation rotate matrix
-        Eigen::Matrix3f R = GetRotateMatrix(a, a);
-        RotateMatrixLookupTable[residue.number] += R;
+            // the reference model is excluded from the search for Min and Max RMSD
+            // (no model is the reference with the average structure)
+            bool extrema = (m > 0) || AverageReference;
 
-        // get conformation RMSD
-        residue.RMSDs += GetRMSD(a, a, R);
+            for (int r = 0; r < ResidueNumbers.size(); r++)
+            {
+                const QVector<Eigen::Vector3f> &a = references.at(r);
+                const QVector<int> &indices = ResidueAtomIndices.at(r);
 
-        // initialize residue Min and Max RMSD
-        residue.MinRMSD = MinInitValue; // nella ricerca del valore min per RMSD non viene considerata la RMSD della prima configurazione essendo sempre nulla
-        residue.MaxRMSD = MaxInitValue;
+                QVector<QVector3D> y;
+                for (auto AtomNumber : ResidueAtomNumbers.at(r))
+                {
+                    y += model[AtomNumber];
+                }
 
-        for (auto model : models.mid(1))
-        {
-            // movement conformation
+                QVector3D c = GetCentroid(y);
 
-            QVector<QVector3D> y;
-            QVector<Eigen::Vector3f> b;
+                QVector<Eigen::Vector3f> b;
+                for (auto v : y)
+                {
+                    b += FromQVector3DToVector3f(v - c);
+                }
 
-            // get conformation atoms positions
-            for (auto AtomNumber : residue.atoms)
-            {
-                y += model[AtomNumber];
-            }
+                Eigen::Matrix3f R = GetRotateMatrix(a, b);
 
-            // get conformation centroid
-            QVector3D c = GetCentroid(y);
+                float RMSD = GetRMSD(a, b, R);
+                worker.residues[r].Add(RMSD, extrema);
 
-            for (auto &v : y)
-            {
-                // center positions with respect to centroid
-                v = v - c;
-                // from QVector3D to Vector3f
-                b += FromQVector3DToVector3f(v);
+                if (StoreRMSDs)
+                {
+                    ResidueRMSDs[r][m] = RMSD;
+                }
+
+                if (ResidueAlignments[r])
+                {
+                    float *alignment = ResidueAlignments[r] + 12 * m;
+                    std::copy(R.data(), R.data() + 9, alignment);
+                    alignment[9] = c.x();
+                    alignment[10] = c.y();
+                    alignment[11] = c.z();
+                }
+
+                for (int i = 0; i < indices.size(); i++)
+                {
+                    Eigen::Vector3f d = R * b[i] - a[i];
+                    worker.atoms[indices[i]].Add(d.squaredNorm(), extrema);
+
+                    if (AtomRMSDs[indices[i]])
+                    {
+                        AtomRMSDs[indices[i]][m] = FromVector3fToQVector3D(d);
+                    }
+                }
             }
-            ConformationLookupTable[residue.number] += b;
+        }
+    };
 
-            // get conformation rotate matrix
-            Eigen::Matrix3f R = GetRotateMatrix(a, b);
-            RotateMatrixLookupTable[residue.number] += R;
+    QtConcurrent::blockingMap(workers, lambda);
 
-            // get conformation RMSD
-            float RMSD = GetRMSD(a, b, R);
-            // Eigen::Vector3f RMSD = GetRMSD(a, b, R);
-            residue.RMSDs += RMSD;
+    // merge the partial accumulators along the fixed pairwise tree
+    auto merge = [] (Worker &a, const Worker &b)
+    {
+        for (int r = 0; r < a.residues.size(); r++)
+        {
+            a.residues[r].Merge(b.residues[r]);
+        }
 
-            // update residue Min and Max RMSD
-            residue.MinRMSD = (RMSD < residue.MinRMSD) ? RMSD : residue.MinRMSD;
-            residue.MaxRMSD = (RMSD > residue.MaxRMSD) ? RMSD : residue.MaxRMSD;
-            // float SquaredNorm = RMSD.squaredNorm();
-            // residue.MinRMSD = (SquaredNorm < residue.MinRMSD) ? SquaredNorm : residue.MinRMSD;
-            // residue.MaxRMSD = (SquaredNorm > residue.MaxRMSD) ? SquaredNorm : residue.MaxRMSD;
+        for (int i = 0; i < a.atoms.size(); i++)
+        {
+            a.atoms[i].Merge(b.atoms[i]);
         }
+    };
+    PairwiseMerge(workers, merge);
 
-        // get residue RMSF
-        residue.RMSF = GetAverage(residue.RMSDs);
-        // residue.RMSF = GetRMSF(residue.RMSDs);
+    const QVector<RunningStatistics> &ResidueStatistics = workers.first().residues;
+    const QVector<RunningStatistics> &AtomStatistics = workers.first().atoms;
+
+    // initialize residues Min and Max RMSD and RMSF
+    MinResiduesRMSD = MinInitValue;
+    MaxResiduesRMSD = MaxInitValue;
+    MinResiduesRMSF = MinInitValue;
+    MaxResiduesRMSF = MaxInitValue;
+
+    for (int r = 0; r < ResidueNumbers.size(); r++)
+    {
+        Residue &residue = residues[ResidueNumbers[r]];
+
+        residue.MinRMSD = ResidueStatistics[r].min;
+        residue.MaxRMSD = ResidueStatistics[r].max;
+        residue.RMSF = static_cast<float>(ResidueStatistics[r].mean);
 
         // update residues Min and Max RMSD
         MinResiduesRMSD = (residue.MinRMSD < MinResiduesRMSD) ? residue.MinRMSD : MinResiduesRMSD;
@@ -551,66 +2138,20 @@ void Trajectory::CookResidues()
         MinResiduesRMSF = (residue.RMSF < MinResiduesRMSF) ? residue.RMSF : MinResiduesRMSF;
         MaxResiduesRMSF = (residue.RMSF > MaxResiduesRMSF) ? residue.RMSF : MaxResiduesRMSF;
     }
-}
 
-void Trajectory::CookAtoms()
-{
-    // initialize atoms Min and Max RMSD
+    // initialize atoms Min and Max RMSD and RMSF
     MinAtomsRMSD = MinInitValue;
     MaxAtomsRMSD = MaxInitValue;
-
-    // initialize atoms Min and Max RMSF
     MinAtomsRMSF = MinInitValue;
     MaxAtomsRMSF = MaxInitValue;
 
-    for (auto &atom : atoms)
+    for (int i = 0; i < AtomNumbers.size(); i++)
     {
-        // atom conformation index
-        int AtomIndex = residues[atom.residue].atoms.indexOf(atom.number);
-
-        // reference conformation : 1st model
-        auto x = ConformationLookupTable[atom.residue].first();
-
-        // get atom position
-        Eigen::Vector3f a = x[AtomIndex];
-
-        // get rotate matrix
-        Eigen::Matrix3f R = RotateMatrixLookupTable[atom.residue][0];
-
-        // get atom RMSD
-        Eigen::Vector3f RMSD = (R * a - a);
-        // atom.RMSDs += RMSD;
-        atom.RMSDs += FromVector3fToQVector3D(RMSD);
-
-        // initialize atom Min and Max RMSD
-        atom.MinRMSD = MinInitValue;
-        atom.MaxRMSD = MaxInitValue;
-
-        for (int i = 1; i < models.size(); i++)
-        {
-            // movement conformation
-            auto y = ConformationLookupTable[atom.residue][i];
-
-            // get atom position
-            Eigen::Vector3f b = y[AtomIndex];
-
-            // get rotate matrix
-            Eigen::Matrix3f R = RotateMatrixLookupTable[atom.residue][i];
-
-            // get atom RMSD
-            Eigen::Vector3f RMSD = (R * b - a);
-            // atom.RMSDs += RMSD;
-            atom.RMSDs += FromVector3fToQVector3D(RMSD);
-
-            // update atom Min and Max RMSD
-            float SquaredNorm = RMSD.squaredNorm();
-            atom.MinRMSD = (SquaredNorm < atom.MinRMSD) ? SquaredNorm : atom.MinRMSD;
-            atom.MaxRMSD = (SquaredNorm > atom.MaxRMSD) ? SquaredNorm : atom.MaxRMSD;
-        }
+        Atom &atom = atoms[AtomNumbers[i]];
 
-        // get atom RMSF
-        // atom.RMSF = GetAverage(atom.RMSDs);
-        atom.RMSF = GetRMSF(atom.RMSDs);
+        atom.MinRMSD = AtomStatistics[i].min;
+        atom.MaxRMSD = AtomStatistics[i].max;
+        atom.RMSF = static_cast<float>(AtomStatistics[i].mean);
 
         // update atoms Min and Max RMSD
         MinAtomsRMSD = (atom.MinRMSD < MinAtomsRMSD) ? atom.MinRMSD : MinAtomsRMSD;
@@ -620,6 +2161,8 @@ void Trajectory::CookAtoms()
         MinAtomsRMSF = (atom.RMSF < MinAtomsRMSF) ? atom.RMSF : MinAtomsRMSF;
         MaxAtomsRMSF = (atom.RMSF > MaxAtomsRMSF) ? atom.RMSF : MaxAtomsRMSF;
     }
+
+    SetPrefixSums();
 }
 
 void Trajectory::SaveCookedData()
@@ -643,10 +2186,27 @@ void Trajectory::SaveCookedData()
         stream << "RESIDUE " << residue.PackedData() << "\n";
     }
 
+    // residues superpositions (compact RMSDs)
+    for (auto residue : residues)
+    {
+        if (!residue.alignments.isEmpty())
+        {
+            stream << "ALIGNMENT " << residue.number << " " << PackNumbers(residue.alignments) << " " << PackVectors(residue.reference) << "\n";
+        }
+    }
+
     // models
-    for (auto model : models)
+    for (int step = 0; step < models.size(); step++)
     {
+        auto model = models[step];
+
         stream << "NEW MODEL\n";
+        if (!boxes.isEmpty())
+        {
+            PeriodicBox box = boxes.value(step);
+            stream << "BOX " << box.lengths.x() << " " << box.lengths.y() << " " << box.lengths.z() << " "
+                   << box.angles.x() << " " << box.angles.y() << " " << box.angles.z() << "\n";
+        }
         for (auto AtomNumber : model.keys())
         {
             auto AtomPosition = PackVector(model[AtomNumber]);
@@ -655,6 +2215,21 @@ void Trajectory::SaveCookedData()
         stream << "END MODEL\n";
     }
 
+    // charges
+    for (auto atom : atoms)
+    {
+        if (atom.charge != 0)
+        {
+            stream << "CHARGE " << atom.number << " " << atom.charge << "\n";
+        }
+    }
+
+    // observables
+    for (auto observable : observables)
+    {
+        stream << "OBSERVABLE " << observable.PackedData() << "\n";
+    }
+
     // min and max values
     {
         QVector<float> values;
@@ -679,11 +2254,14 @@ void Trajectory::ClearAllData()
     // raw data
     AtomsTable.clear();
     ModelsTable.clear();
+    ModelsBoxes.clear();
 
     // cooked data
     atoms.clear();
     residues.clear();
     models.clear();
+    boxes.clear();
+    observables.clear();
 
     // lookup tables
     ConformationLookupTable.clear();
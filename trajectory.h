@@ -4,13 +4,32 @@
 #include <iostream>
 #include <QDebug>
 #include <QFile>
+#include <QElapsedTimer>
+#include <QtConcurrent>
 #include <Eigen/Dense>
 
 #include "atom.h"
 #include "residue.h"
+#include "observable.h"
 #include "utility.h"
 using namespace utility;
 
+// periodic box of a model (CRYST1 record)
+struct PeriodicBox
+{
+    QVector3D lengths; // edges a, b, c (in Angstrom), null : no box
+    QVector3D angles = {90, 90, 90}; // alpha, beta, gamma (in degrees)
+
+    bool isEmpty() const;
+
+    // edge vectors as columns, a along x and b in the xy plane
+    Eigen::Matrix3f GetMatrix() const;
+    float GetVolume() const;
+};
+
+// temporal smoothing of the models
+enum SmoothingFilter { NO_SMOOTHING, MOVING_AVERAGE, SAVITZKY_GOLAY };
+
 class Trajectory : public QObject
 {
     Q_OBJECT
@@ -23,11 +42,62 @@ public:
 
     void LoadCookedData();
 
+    // statistics mode
+    // offline : RMSF, Min and Max RMSD are computed after the fact from the RMSDs history
+    // online : streaming accumulators updated in a single pass over the models
+    bool OnlineStatistics = false;
+    // online mode only : whether the per-model RMSDs are kept
+    bool StoreRMSDs = true;
+
+    // reference conformations
+    // 1st model : each residue is superposed on its conformation in the first model
+    // average : each residue is superposed on its average conformation, refined iteratively
+    // (frames aligned to the running average until it stops moving)
+    bool AverageReference = false;
+    // mean squared displacement (in Angstrom^2) of the average between iterations at convergence
+    float AverageTolerance = 1e-5f;
+    int MaxAverageIterations = 50;
+
+    // atoms RMSD vectors : stored per atom per model, or (compact) derived on demand from
+    // the rotation and centroid of each residue in each model, a fraction of the cooked data
+    bool CompactRMSDs = false;
+
+    // RMSD and RMSF of the loaded models recomputed against the current reference
+    void Recook();
+
+    // periodic boundary imaging of the raw models, before cooking
+    // (molecules made whole, centered on the selection and wrapped into the box)
+    bool PeriodicImaging = true;
+    QString ImagingSelection = "backbone";
+    void ImageModels();
+
+    // smoothed models, derived from the source models aligned on the first one
+    // (moving average or quadratic Savitzky-Golay over an odd window of frames, edges padded)
+    // the source models are kept in memory and restored with NO_SMOOTHING,
+    // RMSD, RMSF and observables are left to the caller (Recook, ComputeObservables)
+    SmoothingFilter smoothing = NO_SMOOTHING;
+    int SmoothingWindow = 5;
+    void SetSmoothing(SmoothingFilter filter, int window);
+
     // cooked data
 
     QMap<int, Atom> atoms;
     QMap<int, Residue> residues;
     QVector<Model> models;
+    // periodic box of each model (empty : no periodic box)
+    QVector<PeriodicBox> boxes;
+
+    // atoms charges : the PDB charge column when present,
+    // otherwise the formal charges of the ionizable groups, spread over their equivalent atoms
+    void SetCharges();
+
+    // per-frame observables, cached with the cooked data
+    QVector<Observable> observables;
+    void AddObservable(QString name, ObservableType type, QVector<QVector<int>> groups);
+    // radius of gyration of the heavy atoms and end-to-end distance of the first and last CA
+    void SetDefaultObservables();
+    // all the observables in a single pass over the models
+    void ComputeObservables();
 
     // Min and Max residues RMSD
     float MinResiduesRMSD;
@@ -45,12 +115,41 @@ public:
 
     QVector<ModelData> GetVAOsData();
 
+    // residues prefix sums for the sliding window RMSF
+    void SetPrefixSums();
+
+    // atoms RMSD vectors, stored or derived (NAN without history)
+    QVector3D GetAtomRMSD(int step, int AtomNumber);
+    // all the atoms in step, in atoms order
+    QVector<QVector3D> GetAtomsRMSDs(int step);
+    // RMSF of an atom over the window of frames centered in step, summed on demand (O(window))
+    float GetAtomWindowRMSF(int step, int AtomNumber, int window);
+
+    // selection : atoms numbers matching an expression
+    // (terms joined by "and", e.g. "chain A and backbone and residue 10-50")
+    QVector<int> GetSelection(QString expression);
+
+    // selection atoms positions of each model, centered with respect to their centroid
+    QVector<QVector<Eigen::Vector3f>> GetConformations(QVector<int> selection);
+    // same on a snapshot of the models (e.g. from a background thread)
+    static QVector<QVector<Eigen::Vector3f>> GetConformations(const QVector<Model> &models, QVector<int> selection);
+
+    // selection atoms positions of a model (raw, not centered)
+    QVector<QVector3D> GetPositions(int step, QVector<int> selection);
+
+    // RMSD (in Angstrom) between two conformations after optimal superposition
+    float GetSuperpositionRMSD(QVector<Eigen::Vector3f> a, QVector<Eigen::Vector3f> b);
+
+    // optimal rotation R of conformation b onto a (R * b ~ a), both centered
+    Eigen::Matrix3f GetRotateMatrix(QVector<Eigen::Vector3f> a, QVector<Eigen::Vector3f> b);
+
 private:
     QVector<QString> paths;
 
     // raw data
     Table AtomsTable;
     QVector<Table> ModelsTable;
+    QVector<PeriodicBox> ModelsBoxes;
 
 
     QVector<Table> CookPDB(QString text);
@@ -60,7 +159,9 @@ private:
     QMap<int, QVector<QVector<Eigen::Vector3f>>> ConformationLookupTable;
     QMap<int, QVector<Eigen::Matrix3f>> RotateMatrixLookupTable;
 
-    Eigen::Matrix3f GetRotateMatrix(QVector<Eigen::Vector3f> a, QVector<Eigen::Vector3f> b);
+    // same as above, on contiguous buffers of size positions
+    Eigen::Matrix3f GetRotateMatrix(const Eigen::Vector3f *a, const Eigen::Vector3f *b, int size);
+
     float GetRMSD(QVector<Eigen::Vector3f> a, QVector<Eigen::Vector3f> b, Eigen::Matrix3f R);
     // Eigen::Vector3f GetRMSD(QVector<Eigen::Vector3f> a, QVector<Eigen::Vector3f> b, Eigen::Matrix3f R);
     float GetRMSF(QVector<Eigen::Vector3f> RMSDs);
@@ -75,12 +176,27 @@ private:
 
     void CookResidues();
     void CookAtoms();
+    void CookOnline();
+
+    QVector<Model> SourceModels;
+    // each output model costs O(atoms) whatever the window, through running sums
+    QVector<Model> GetSmoothedModels(const QVector<Model> &source, SmoothingFilter filter, int window);
+
+    // molecules (chains of bonded residues in the first model), atoms indices in traversal order
+    // molecule m owns order[MoleculeStarts[m]] ... order[MoleculeStarts[m+1]-1]
+    void GetMolecules(QVector<int> &order, QVector<int> &MoleculeStarts);
+
+    // residues reference conformations (centered), in residues order
+    QVector<QVector<Eigen::Vector3f>> GetFirstModelReferences();
+    QVector<QVector<Eigen::Vector3f>> GetAverageReferences();
 
     void SaveCookedData();
 
     void ClearAllData();
 
     friend std::ostream& operator<<(std::ostream& os, const Trajectory& trajectory);
+    // reductions test target (tests/reductions), compares the average references
+    friend class ReductionsTest;
 
 signals:
     void ProgressBarSetMaxSignal(int value);
@@ -12,6 +12,8 @@
 #include <QColor>
 #include <QLabel>
 #include <QRandomGenerator>
+#include <QThread>
+#include <QPair>
 
 #include <Eigen/Dense>
 
@@ -32,7 +34,8 @@ enum
     SILHOUETTE,
     OUTLINE,
     MARKER,
-    QUAD
+    QUAD,
+    HBOND
 };
 }
 
@@ -350,14 +353,141 @@ static QVector3D GetCentroid(QVector<QVector3D> v)
     return GetMean(v);
 }
 
+// pairwise summation, the rounding error grows as O(log n) instead of O(n)
+static double PairwiseSum(const float *values, int size)
+{
+    if (size <= 8)
+    {
+        double sum = 0;
+        for (int i = 0; i < size; i++)
+        {
+            sum += values[i];
+        }
+        return sum;
+    }
+
+    int half = size / 2;
+    return PairwiseSum(values, half) + PairwiseSum(values + half, size - half);
+}
+
 static float GetAverage(QVector<float> v)
 {
     // return GetMean<float>(v);
-    return GetMean(v);
+    // return GetMean(v);
+    return static_cast<float>(PairwiseSum(v.constData(), v.size()) / v.size());
 }
 
+// average of the values in the window of given size centered in index,
+// from the prefix sums of the values (sums[i] : sum of the first i values)
+static float GetWindowAverage(const QVector<double> &sums, int index, int window)
+{
+    int size = sums.size() - 1;
+
+    if (size <= 0)
+    {
+        return NAN;
+    }
+
+    int begin = qBound(0, index - window / 2, size - 1);
+    int end = qBound(begin + 1, begin + window, size);
+    // shift the window back when it exceeds the last value
+    begin = qMax(0, end - window);
+
+    return static_cast<float>((sums[end] - sums[begin]) / (end - begin));
+}
+
+// streaming mean, min and max
+// partial accumulators computed on disjoint frames ranges can be merged
+struct RunningStatistics
+{
+    int count = 0;
+    double mean = 0;
+    float min = FLT_MAX;
+    float max = 0;
+
+    // extrema : whether the value takes part in the search for min and max
+    void Add(float value, bool extrema = true)
+    {
+        count += 1;
+        mean += (value - mean) / count;
+
+        if (extrema)
+        {
+            min = (value < min) ? value : min;
+            max = (value > max) ? value : max;
+        }
+    }
+
+    void Merge(const RunningStatistics &other)
+    {
+        if (other.count == 0)
+        {
+            return;
+        }
+
+        int total = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        count = total;
+
+        min = (other.min < min) ? other.min : min;
+        max = (other.max > max) ? other.max : max;
+    }
+};
+
 // collections
 
+// returns the sequence 0, 1, ..., size-1
+static QVector<int> GetIndices(int size)
+{
+    QVector<int> indices(size);
+    std::iota(indices.begin(), indices.end(), 0);
+    return indices;
+}
+
+// splits the range [0, size) in contiguous chunks (begin, end), one for each thread
+static QVector<QPair<int, int>> GetChunks(int size, int count = QThread::idealThreadCount())
+{
+    QVector<QPair<int, int>> chunks;
+
+    count = qBound(1, count, qMax(1, size));
+
+    for (int i = 0; i < count; i++)
+    {
+        int begin = static_cast<int>(static_cast<qint64>(size) * i / count);
+        int end = static_cast<int>(static_cast<qint64>(size) * (i + 1) / count);
+        chunks += qMakePair(begin, end);
+    }
+
+    return chunks;
+}
+
+// deterministic reductions
+// floating point merges are not associative, so partial results merged per thread would change with
+// the threads count : the work is split in a fixed number of blocks instead (whatever the machine)
+// and the blocks partial results are merged along a fixed pairwise tree, bit-identical on any core count
+const int ReductionBlocks = 32;
+
+// splits the range [0, size) in contiguous blocks (begin, end), independent of the threads count
+static QVector<QPair<int, int>> GetReductionBlocks(int size)
+{
+    return GetChunks(size, ReductionBlocks);
+}
+
+// merges the partial results in place along a fixed pairwise tree, the result ends in partials[0]
+// merge(a, b) : accumulates b into a
+template <class T, class F>
+static void PairwiseMerge(QVector<T> &partials, F merge)
+{
+    for (int stride = 1; stride < partials.size(); stride *= 2)
+    {
+        for (int i = 0; i + stride < partials.size(); i += 2 * stride)
+        {
+            merge(partials[i], partials[i + stride]);
+        }
+    }
+}
+
 template <class T>
 static QString PackNumbers(QVector<T> collection, QString sep = ";")
 {
@@ -373,6 +503,11 @@ static QVector<int> UnpackInts(QString PackedData, QString sep = ";")
 {
     QVector<int> collection;
 
+    if (PackedData.isEmpty())
+    {
+        return collection;
+    }
+
     QStringList list = PackedData.split(sep);
     for (auto number : list)
     {
@@ -386,6 +521,11 @@ static QVector<float> UnpackFloats(QString PackedData, QString sep = ";")
 {
     QVector<float> collection;
 
+    if (PackedData.isEmpty())
+    {
+        return collection;
+    }
+
     QStringList list = PackedData.split(sep);
     for (auto number : list)
     {
@@ -436,6 +576,11 @@ static QVector<QVector3D> UnpackVectors(QString PackedData, QString InnerSep = "
 {
     QVector<QVector3D> collection;
 
+    if (PackedData.isEmpty())
+    {
+        return collection;
+    }
+
     QStringList list = PackedData.split(OuterSep);
     for (auto vector : list)
     {
@@ -483,8 +628,42 @@ struct PlaybackData
     int size;
     QTime time;
     float speed; // frames per second
+    QVector<int> order; // frames playback order (empty : sequential)
+};
+
+// modes the animation displacements come from
+enum ModeSource { PRINCIPAL_COMPONENTS, NORMAL_MODES };
+
+struct ModeAnimationData
+{
+    bool active;
+    ModeSource source;
+    int mode; // principal component or normal mode index
+    float amplitude; // in standard deviations
+    float period; // in seconds
+    QTime time;
+    bool UpdateFlag; // displacements buffer upload
 };
 
+// returns the step that follows (or precedes) the current one in playback order
+static int GetNextStep(PlaybackData playback, int increment = +1)
+{
+    if (playback.order.isEmpty())
+    {
+        return (playback.step + playback.size + increment) % playback.size;
+    }
+
+    int size = playback.order.size();
+    int index = playback.order.indexOf(playback.step);
+
+    if (index < 0)
+    {
+        return playback.order.first();
+    }
+
+    return playback.order[(index + size + increment) % size];
+}
+
 struct FrameRateData
 {
     QTime time;
@@ -518,18 +697,26 @@ struct ChemicalElement
     QString symbol;
     QString name;
     float radius; // Angstrom
+    float covalent; // Angstrom (Cordero et al.)
     QColor albedo; // Jmol
 };
 
 // map : symbol -> element
 static QMap<QString, ChemicalElement> ChemicalElements
 {
-    {"N", {"N", "Nitrogen", 1.55f, "#3050f8"}},
-    {"C", {"C", "Carbon", 1.7f, "#909090"}},
-    {"O", {"O", "Oxygen", 1.52f, "#ff0d0d"}},
-    {"H", {"H", "Hydrogen", 1.2f, "#ffffff"}},
-    {"S", {"S", "Sulfur", 1.8f, "#ffff30"}},
-    {"Ca", {"Ca", "Calcium", 2.31f, "#3dff00"}}
+    {"N", {"N", "Nitrogen", 1.55f, 0.71f, "#3050f8"}},
+    {"C", {"C", "Carbon", 1.7f, 0.76f, "#909090"}},
+    {"O", {"O", "Oxygen", 1.52f, 0.66f, "#ff0d0d"}},
+    {"H", {"H", "Hydrogen", 1.2f, 0.31f, "#ffffff"}},
+    {"S", {"S", "Sulfur", 1.8f, 1.05f, "#ffff30"}},
+    {"P", {"P", "Phosphorus", 1.8f, 1.07f, "#ff8000"}},
+    {"Ca", {"Ca", "Calcium", 2.31f, 1.76f, "#3dff00"}},
+    {"Na", {"Na", "Sodium", 2.27f, 1.66f, "#ab5cf2"}},
+    {"K", {"K", "Potassium", 2.75f, 2.03f, "#8f40d4"}},
+    {"Mg", {"Mg", "Magnesium", 1.73f, 1.41f, "#8aff00"}},
+    {"Zn", {"Zn", "Zinc", 1.39f, 1.22f, "#7d80b0"}},
+    {"Fe", {"Fe", "Iron", 1.94f, 1.32f, "#e06633"}},
+    {"Cl", {"Cl", "Chlorine", 1.75f, 1.02f, "#1ff01f"}}
 };
 
 struct AminoAcid
@@ -727,9 +914,30 @@ static QString GetColorStepCaption(ColorStep step, int width = 8, int precision
 
 // outline
 
-enum OutlineMode { RESIDUE_RMSF, RESIDUE_RMSD, ATOM_RMSF, ATOM_RMSD };
+enum OutlineMode { RESIDUE_RMSF, RESIDUE_RMSD, ATOM_RMSF, ATOM_RMSD, RESIDUE_WINDOW_RMSF, ATOM_WINDOW_RMSF, RESIDUE_CONTACTS, RESIDUE_SECONDARY_STRUCTURE, RESIDUE_SASA, RESIDUE_CROSS_CORRELATION, RESIDUE_LIGAND_DISTANCE, RESIDUE_LIGAND_RESIDENCE, RESIDUE_DIHEDRAL, RESIDUE_DIHEDRAL_VARIANCE, RESIDUE_POTENTIAL, ATOM_POTENTIAL };
 enum BoundaryValues { absolute, relative };
 
+// the outline colours are indexed by residue or atom number
+enum OutlineLevel { RESIDUE_LEVEL, ATOM_LEVEL };
+
+static OutlineLevel GetOutlineLevel(OutlineMode mode)
+{
+    switch (mode)
+    {
+    case ATOM_RMSF:
+    case ATOM_RMSD:
+    case ATOM_WINDOW_RMSF:
+    case ATOM_POTENTIAL:
+    {
+        return ATOM_LEVEL;
+    }
+    default:
+    {
+        return RESIDUE_LEVEL;
+    }
+    }
+}
+
 struct OutlineData
 {
     bool active;
@@ -743,6 +951,10 @@ struct OutlineData
     BoundaryValues boundary;
     QVector<QVector3D> colours;
 
+    int window; // sliding window size (in frames)
+    int reference; // reference residue number (0 : none)
+    int dihedral; // dihedral angle (DihedralAngle) of the dihedral modes
+
     int filter;
 
     bool OutlineTextureFlag = false;